@@ -0,0 +1,136 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+
+using namespace std;
+
+namespace {
+	// Nearest-rank percentile of sorted values
+	double percentile(const vector<double>& sorted, double p) {
+		size_t rank = (size_t)ceil(p / 100.0 * (double)sorted.size());
+		return sorted[min(max(rank, (size_t)1), sorted.size()) - 1];
+	}
+
+	string escapeJson(const string& text) {
+		string escaped;
+		for (size_t i = 0; i < text.size(); i++) {
+			if (text[i] == '"' || text[i] == '\\')
+				escaped += '\\';
+			escaped += text[i];
+		}
+		return escaped;
+	}
+}
+
+BenchmarkRecorder::BenchmarkRecorder() : shadowMapsRendered(0), lastProfileFrame(0) {}
+
+void BenchmarkRecorder::addFrame(double ms, int shadowMaps) {
+	frameTimes.push_back(ms);
+	shadowMapsRendered += shadowMaps;
+}
+
+void BenchmarkRecorder::addProfile(const ProfileFrame& frame) {
+	if (frame.index == lastProfileFrame)
+		return;
+	lastProfileFrame = frame.index;
+
+	for (size_t i = 0; i < frame.zones.size(); i++) {
+		const ProfileZone& zone = frame.zones[i];
+
+		ZoneTotal* total = nullptr;
+		for (size_t j = 0; j < zones.size(); j++) {
+			if (zones[j].name == zone.name) {
+				total = &zones[j];
+				break;
+			}
+		}
+
+		if (total == nullptr) {
+			ZoneTotal added = { zone.name, 0.0, 0.0, 0, 0 };
+			zones.push_back(added);
+			total = &zones.back();
+		}
+
+		total->cpuMs += zone.cpuMs;
+		total->count++;
+		if (zone.gpuMs >= 0.0) {
+			total->gpuMs += zone.gpuMs;
+			total->gpuCount++;
+		}
+	}
+}
+
+FrameTimeSummary BenchmarkRecorder::summary() const {
+	FrameTimeSummary result = {};
+	if (frameTimes.empty())
+		return result;
+
+	vector<double> sorted(frameTimes);
+	sort(sorted.begin(), sorted.end());
+
+	double total = 0.0;
+	for (size_t i = 0; i < sorted.size(); i++)
+		total += sorted[i];
+
+	result.average = total / (double)sorted.size();
+	result.p50 = percentile(sorted, 50.0);
+	result.p95 = percentile(sorted, 95.0);
+	result.p99 = percentile(sorted, 99.0);
+	result.min = sorted.front();
+	result.max = sorted.back();
+	return result;
+}
+
+void BenchmarkRecorder::print(ostream& out) const {
+	// The caller's formatting is restored afterwards
+	ios::fmtflags flags = out.flags();
+	streamsize precision = out.precision();
+
+	FrameTimeSummary times = summary();
+	out << fixed << setprecision(3)
+		<< "Benchmark: " << frameTimes.size() << " frames, average " << times.average << " ms, p50 " << times.p50
+		<< " ms, p95 " << times.p95 << " ms, p99 " << times.p99 << " ms, " << shadowMapsRendered << " shadow maps rendered" << endl;
+
+	for (size_t i = 0; i < zones.size(); i++) {
+		out << "  " << left << setw(18) << zones[i].name << right << " CPU " << setw(8) << zones[i].cpuMs / zones[i].count << " ms";
+		if (zones[i].gpuCount > 0)
+			out << "  GPU " << setw(8) << zones[i].gpuMs / zones[i].gpuCount << " ms";
+		out << endl;
+	}
+
+	out.flags(flags);
+	out.precision(precision);
+}
+
+bool BenchmarkRecorder::write(const string& path, const vector<pair<string, string> >& settings) const {
+	ofstream file(path, ios::trunc);
+	if (!file)
+		return false;
+
+	FrameTimeSummary times = summary();
+	file << fixed << setprecision(4) << "{\n";
+	for (size_t i = 0; i < settings.size(); i++)
+		file << "  \"" << escapeJson(settings[i].first) << "\": \"" << escapeJson(settings[i].second) << "\",\n";
+
+	file << "  \"frames\": " << frameTimes.size() << ",\n"
+		<< "  \"shadowMapsRendered\": " << shadowMapsRendered << ",\n"
+		<< "  \"frameMs\": {\"average\": " << times.average << ", \"p50\": " << times.p50 << ", \"p95\": " << times.p95
+		<< ", \"p99\": " << times.p99 << ", \"min\": " << times.min << ", \"max\": " << times.max << "},\n"
+		<< "  \"zones\": [";
+
+	for (size_t i = 0; i < zones.size(); i++) {
+		file << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << escapeJson(zones[i].name) << "\", \"cpuMs\": " << zones[i].cpuMs / zones[i].count
+			<< ", \"gpuMs\": ";
+		if (zones[i].gpuCount > 0)
+			file << zones[i].gpuMs / zones[i].gpuCount;
+		else
+			file << "null";
+		file << "}";
+	}
+
+	file << "\n  ]\n}\n";
+	return (bool)file;
+}
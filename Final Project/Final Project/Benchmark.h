@@ -0,0 +1,49 @@
+#pragma once
+
+#include "FrameProfiler.h"
+
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Frames rendered before timing starts, while caches and the driver settle
+const int BENCHMARK_WARMUP_FRAMES = 30;
+
+struct FrameTimeSummary {
+	double average;
+	double p50, p95, p99;
+	double min, max;
+};
+
+// Frame times and per-zone profiler averages gathered over a benchmark run
+class BenchmarkRecorder {
+public:
+	BenchmarkRecorder();
+
+	// shadowMapsRendered counts the maps the frame re-rendered
+	void addFrame(double ms, int shadowMapsRendered);
+
+	// Called every frame; each resolved profiler frame is counted once
+	void addProfile(const ProfileFrame& frame);
+
+	size_t frameCount() const { return frameTimes.size(); }
+	FrameTimeSummary summary() const;
+
+	void print(std::ostream& out) const;
+
+	// Results as JSON, with the run's settings written first as string fields
+	bool write(const std::string& path, const std::vector<std::pair<std::string, std::string> >& settings) const;
+
+private:
+	struct ZoneTotal {
+		std::string name;
+		double cpuMs, gpuMs;
+		int count, gpuCount; // GPU results can be missing for some frames
+	};
+
+	std::vector<double> frameTimes;
+	std::vector<ZoneTotal> zones;
+	int shadowMapsRendered; // Over every recorded frame
+	unsigned long long lastProfileFrame;
+};
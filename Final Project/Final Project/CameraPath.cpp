@@ -0,0 +1,87 @@
+#include "CameraPath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+bool loadCameraPath(const string& path, vector<CameraPose>& poses, string& error) {
+	ifstream file(path);
+	if (!file) {
+		error = path + ": cannot open file";
+		return false;
+	}
+
+	poses.clear();
+
+	string line;
+	int lineNumber = 0;
+	while (getline(file, line)) {
+		lineNumber++;
+
+		size_t comment = line.find('#');
+		if (comment != string::npos)
+			line.erase(comment);
+
+		istringstream words(line);
+		string extra;
+		CameraPose pose;
+		if (!(words >> pose.position.x)) {
+			// Blank line
+			if (line.find_first_not_of(" \t\r") == string::npos)
+				continue;
+		}
+		else if (words >> pose.position.y >> pose.position.z >> pose.yaw >> pose.pitch && !(words >> extra)) {
+			poses.push_back(pose);
+			continue;
+		}
+
+		ostringstream message;
+		message << path << ":" << lineNumber << ": expected x y z yaw pitch";
+		error = message.str();
+		return false;
+	}
+
+	if (poses.empty()) {
+		error = path + ": no camera poses";
+		return false;
+	}
+
+	return true;
+}
+
+bool saveCameraPath(const string& path, const vector<CameraPose>& poses) {
+	ofstream file(path, ios::trunc);
+	if (!file)
+		return false;
+
+	file << "# x y z yaw pitch\n";
+	for (size_t i = 0; i < poses.size(); i++) {
+		const CameraPose& pose = poses[i];
+		file << pose.position.x << " " << pose.position.y << " " << pose.position.z << " " << pose.yaw << " " << pose.pitch << "\n";
+	}
+	return (bool)file;
+}
+
+CameraPose sampleCameraPath(const vector<CameraPose>& poses, float t) {
+	if (poses.size() == 1)
+		return poses[0];
+
+	float position = min(max(t, 0.0f), 1.0f) * (float)(poses.size() - 1);
+	size_t index = min((size_t)position, poses.size() - 2);
+	float blend = position - (float)index;
+
+	const CameraPose& from = poses[index];
+	const CameraPose& to = poses[index + 1];
+
+	CameraPose pose;
+	pose.position = glm::mix(from.position, to.position, blend);
+	// Yaw turns the short way round, so a path crossing +-180 degrees does not spin back through zero
+	float yawDelta = to.yaw - from.yaw;
+	yawDelta -= 360.0f * floorf((yawDelta + 180.0f) / 360.0f);
+	pose.yaw = from.yaw + yawDelta * blend;
+	pose.pitch = glm::mix(from.pitch, to.pitch, blend);
+	return pose;
+}
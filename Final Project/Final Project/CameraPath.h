@@ -0,0 +1,22 @@
+#pragma once
+
+#include <glm/glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+// Camera position and yaw/pitch in degrees, the same angles the mouse camera uses
+struct CameraPose {
+	glm::vec3 position;
+	float yaw, pitch;
+};
+
+// Text file with one "x y z yaw pitch" pose per line, '#' starting a comment
+// On failure error holds "file:line: message"
+bool loadCameraPath(const std::string& path, std::vector<CameraPose>& poses, std::string& error);
+
+// Write poses in the format loadCameraPath reads, e.g. to replay a recorded flight
+bool saveCameraPath(const std::string& path, const std::vector<CameraPose>& poses);
+
+// Pose at t in [0, 1] along the path, interpolated linearly between neighbouring poses, yaw along the shorter arc
+CameraPose sampleCameraPath(const std::vector<CameraPose>& poses, float t);
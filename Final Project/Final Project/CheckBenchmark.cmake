@@ -0,0 +1,39 @@
+# Runs a headless benchmark and checks its results file: cmake -DPROGRAM=... -DFRAMES=... -DRESULTS=... -P CheckBenchmark.cmake
+# With -DANIMATE_NODE=<name> the node moves, so the timed frames must re-render shadow maps; without it none may be
+file(REMOVE ${RESULTS})
+
+set(arguments --headless --camera-path desk.camera --benchmark ${FRAMES} --results ${RESULTS})
+if(ANIMATE_NODE)
+	list(APPEND arguments --animate-node ${ANIMATE_NODE})
+endif()
+
+execute_process(COMMAND ${PROGRAM} ${arguments} RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+	message(FATAL_ERROR "${PROGRAM} exited with ${result}")
+endif()
+
+if(NOT EXISTS ${RESULTS})
+	message(FATAL_ERROR "No results written to ${RESULTS}")
+endif()
+file(READ ${RESULTS} json)
+
+if(NOT json MATCHES "\"frames\": ${FRAMES},")
+	message(FATAL_ERROR "${RESULTS} does not report ${FRAMES} frames")
+endif()
+
+foreach(field average p50 p95 p99)
+	if(NOT json MATCHES "\"${field}\": [0-9]+(\\.[0-9]+)?[,}]")
+		message(FATAL_ERROR "${RESULTS} has no frame time ${field}")
+	endif()
+endforeach()
+
+if(NOT json MATCHES "\"shadowMapsRendered\": ([0-9]+),")
+	message(FATAL_ERROR "${RESULTS} has no shadow map count")
+endif()
+set(shadowMaps ${CMAKE_MATCH_1})
+
+if(ANIMATE_NODE AND shadowMaps EQUAL 0)
+	message(FATAL_ERROR "No shadow maps re-rendered while ${ANIMATE_NODE} moved")
+elseif(NOT ANIMATE_NODE AND NOT shadowMaps EQUAL 0)
+	message(FATAL_ERROR "Static scene re-rendered ${shadowMaps} shadow maps")
+endif()
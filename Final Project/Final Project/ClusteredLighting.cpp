@@ -0,0 +1,67 @@
+#include "ClusteredLighting.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+	// Threads per work group of the culling program
+	const GLuint CLUSTER_GROUP_SIZE = 64;
+
+	GLuint createStorageBuffer(GLuint binding, GLsizeiptr size) {
+		GLuint buffer;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer);
+		return buffer;
+	}
+}
+
+LightClusters::LightClusters(GLuint lightBinding, GLuint clusterBinding, GLuint indexBinding) : lightBinding(lightBinding), lightCapacity(1) {
+	lightBuffer = createStorageBuffer(lightBinding, sizeof(GpuLight));
+
+	// Offset and count into the index list for each cluster
+	clusterBuffer = createStorageBuffer(clusterBinding, CLUSTER_COUNT * 2 * sizeof(GLuint));
+
+	// Counter followed by the light indices of every cluster
+	indexBuffer = createStorageBuffer(indexBinding, (1 + CLUSTER_COUNT * CLUSTER_AVERAGE_LIGHTS) * sizeof(GLuint));
+}
+
+LightClusters::~LightClusters() {
+	glDeleteBuffers(1, &lightBuffer);
+	glDeleteBuffers(1, &clusterBuffer);
+	glDeleteBuffers(1, &indexBuffer);
+}
+
+void LightClusters::setLights(const vector<GpuLight>& lights) {
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightBuffer);
+
+	if (lights.size() > lightCapacity) {
+		lightCapacity = max(lights.size(), lightCapacity * 2);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, lightCapacity * sizeof(GpuLight), nullptr, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, lightBinding, lightBuffer);
+	}
+
+	if (!lights.empty())
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, lights.size() * sizeof(GpuLight), lights.data());
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void LightClusters::build(const ShaderProgram& cullProgram) {
+	// Reset the index list counter
+	GLuint zero = 0;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, indexBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &zero);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glUseProgram(cullProgram.id());
+	glDispatchCompute((CLUSTER_COUNT + CLUSTER_GROUP_SIZE - 1) / CLUSTER_GROUP_SIZE, 1, 1);
+	glUseProgram(0);
+
+	// Fragment shaders read the lists written above
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "ShaderProgram.h"
+
+#include <GLEW/glew.h>
+
+#include <glm/glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+// View-space cluster grid: screen tiles split into exponential depth slices between the near and far planes
+const int CLUSTER_GRID_X = 16;
+const int CLUSTER_GRID_Y = 9;
+const int CLUSTER_GRID_Z = 24;
+const int CLUSTER_COUNT = CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+
+// Light indices the index list holds per cluster on average; lights past the end are dropped
+const int CLUSTER_AVERAGE_LIGHTS = 32;
+
+// Light as read by the shaders (std430 layout of the Light struct)
+struct GpuLight {
+	glm::vec4 position; // w is the range
+	glm::vec4 color;
+	glm::vec4 params; // Ambient, diffuse and specular strength, specular exponent
+	GLint shadowMap; // Cube in the shadow map array, -1 for unshadowed lights
+	GLint padding[3];
+};
+
+// Lights in a storage buffer, binned into the cluster grid by a compute pass each frame
+class LightClusters {
+public:
+	// Binding points of the light, cluster and light index buffers
+	LightClusters(GLuint lightBinding, GLuint clusterBinding, GLuint indexBinding);
+	~LightClusters();
+
+	// Upload the frame's lights, growing the buffer when there are more than before
+	void setLights(const std::vector<GpuLight>& lights);
+
+	// Run the culling program once per cluster; the frame uniforms must already be current
+	void build(const ShaderProgram& cullProgram);
+
+	// Light buffer, which keeps its name when it grows so vertex arrays can read it as instance data
+	GLuint buffer() const { return lightBuffer; }
+
+private:
+	LightClusters(const LightClusters&);
+	LightClusters& operator=(const LightClusters&);
+
+	GLuint lightBuffer;
+	GLuint clusterBuffer;
+	GLuint indexBuffer;
+	GLuint lightBinding;
+	size_t lightCapacity;
+};
@@ -0,0 +1,173 @@
+#include "FrameProfiler.h"
+
+#include <fstream>
+#include <iomanip>
+
+using namespace std;
+
+namespace {
+	ProfileCounters difference(const ProfileCounters& end, const ProfileCounters& start) {
+		ProfileCounters counters;
+		counters.draws = end.draws - start.draws;
+		counters.binds = end.binds - start.binds;
+		counters.uniforms = end.uniforms - start.uniforms;
+		return counters;
+	}
+
+	// Complete ("X") event; trace timestamps are in microseconds
+	void writeEvent(ofstream& file, const ProfileZone& zone, unsigned long long frame, int thread, double startMs, double durationMs) {
+		file << ",\n{\"name\":\"" << zone.name << "\",\"cat\":\"" << (thread == 1 ? "cpu" : "gpu") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread
+			<< ",\"ts\":" << startMs * 1000.0 << ",\"dur\":" << durationMs * 1000.0
+			<< ",\"args\":{\"frame\":" << frame << ",\"draws\":" << zone.counters.draws
+			<< ",\"binds\":" << zone.counters.binds << ",\"uniforms\":" << zone.counters.uniforms << "}}";
+	}
+}
+
+FrameProfiler::FrameProfiler() : frameIndex(0), start(chrono::steady_clock::now()) {
+	for (int i = 0; i < PROFILER_LATENCY; i++)
+		frames[i].recorded = false;
+
+	// Queried synchronously once, to place GPU timestamps on the CPU timeline
+	glGetInteger64v(GL_TIMESTAMP, &gpuStart);
+	latestFrame.index = 0;
+}
+
+FrameProfiler::~FrameProfiler() {
+	for (int i = 0; i < PROFILER_LATENCY; i++) {
+		for (size_t j = 0; j < frames[i].zones.size(); j++)
+			glDeleteQueries(2, frames[i].zones[j].queries);
+	}
+	if (!freeQueries.empty())
+		glDeleteQueries((GLsizei)freeQueries.size(), freeQueries.data());
+}
+
+double FrameProfiler::cpuMs() const {
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+GLuint FrameProfiler::allocateQuery() {
+	if (freeQueries.empty()) {
+		GLuint query;
+		glGenQueries(1, &query);
+		return query;
+	}
+
+	GLuint query = freeQueries.back();
+	freeQueries.pop_back();
+	return query;
+}
+
+void FrameProfiler::beginFrame() {
+	frameIndex++;
+	open.clear();
+
+	// This slot was last used PROFILER_LATENCY frames ago; its queries have normally landed by now
+	Frame& frame = frames[frameIndex % PROFILER_LATENCY];
+	resolve(frame, false);
+
+	frame.index = frameIndex;
+	frame.recorded = true;
+}
+
+void FrameProfiler::begin(const char* name, const ProfileCounters& counters) {
+	Frame& frame = frames[frameIndex % PROFILER_LATENCY];
+
+	PendingZone pending;
+	pending.zone.name = name;
+	pending.zone.depth = (int)open.size();
+	pending.zone.cpuStart = cpuMs();
+	pending.zone.cpuMs = -1.0;
+	pending.startCounters = counters;
+	pending.queries[0] = allocateQuery();
+	pending.queries[1] = allocateQuery();
+	glQueryCounter(pending.queries[0], GL_TIMESTAMP);
+
+	open.push_back(frame.zones.size());
+	frame.zones.push_back(pending);
+}
+
+void FrameProfiler::end(const ProfileCounters& counters) {
+	if (open.empty())
+		return;
+
+	PendingZone& pending = frames[frameIndex % PROFILER_LATENCY].zones[open.back()];
+	open.pop_back();
+
+	glQueryCounter(pending.queries[1], GL_TIMESTAMP);
+	pending.zone.cpuMs = cpuMs() - pending.zone.cpuStart;
+	pending.zone.counters = difference(counters, pending.startCounters);
+}
+
+// Copy the frame's results out and recycle its queries; without wait, zones still in flight are dropped
+void FrameProfiler::resolve(Frame& frame, bool wait) {
+	if (!frame.recorded)
+		return;
+
+	ProfileFrame resolved;
+	resolved.index = frame.index;
+
+	for (size_t i = 0; i < frame.zones.size(); i++) {
+		PendingZone& pending = frame.zones[i];
+		freeQueries.push_back(pending.queries[0]);
+		freeQueries.push_back(pending.queries[1]);
+
+		// Never ended, so its end query was never issued
+		if (pending.zone.cpuMs < 0.0)
+			continue;
+
+		ProfileZone zone = pending.zone;
+		zone.gpuStart = zone.cpuStart;
+		zone.gpuMs = -1.0;
+
+		GLint available = GL_TRUE;
+		if (!wait)
+			glGetQueryObjectiv(pending.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+		if (available == GL_TRUE) {
+			GLuint64 begin = 0, end = 0;
+			glGetQueryObjectui64v(pending.queries[0], GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(pending.queries[1], GL_QUERY_RESULT, &end);
+			zone.gpuStart = (double)((GLint64)begin - gpuStart) / 1.0e6;
+			zone.gpuMs = (double)(end - begin) / 1.0e6;
+		}
+
+		resolved.zones.push_back(zone);
+	}
+
+	frame.zones.clear();
+	frame.recorded = false;
+
+	latestFrame = resolved;
+	history.push_back(resolved);
+	if (history.size() > PROFILER_HISTORY)
+		history.pop_front();
+}
+
+void FrameProfiler::finish() {
+	// Oldest first, so the history stays in frame order
+	for (int i = 1; i <= PROFILER_LATENCY; i++)
+		resolve(frames[(frameIndex + i) % PROFILER_LATENCY], true);
+}
+
+bool FrameProfiler::exportTrace(const string& path) const {
+	ofstream file(path, ios::trunc);
+	if (!file)
+		return false;
+
+	file << fixed << setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	file << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},";
+	file << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+	for (size_t i = 0; i < history.size(); i++) {
+		for (size_t j = 0; j < history[i].zones.size(); j++) {
+			const ProfileZone& zone = history[i].zones[j];
+			writeEvent(file, zone, history[i].index, 1, zone.cpuStart, zone.cpuMs);
+			if (zone.gpuMs >= 0.0)
+				writeEvent(file, zone, history[i].index, 2, zone.gpuStart, zone.gpuMs);
+		}
+	}
+
+	file << "\n]}\n";
+	return (bool)file;
+}
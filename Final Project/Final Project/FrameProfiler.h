@@ -0,0 +1,89 @@
+#pragma once
+
+#include <GLEW/glew.h>
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+// Frames between issuing a zone's GPU queries and reading them back, so the CPU never waits on the GPU
+const int PROFILER_LATENCY = 4;
+
+// Resolved frames kept for trace export
+const size_t PROFILER_HISTORY = 600;
+
+// Work done inside a zone
+struct ProfileCounters {
+	GLuint draws;
+	GLuint binds; // Program, VAO and texture binds
+	GLuint uniforms;
+};
+
+// Times in milliseconds since the profiler was created, GPU times mapped onto the CPU clock
+struct ProfileZone {
+	const char* name;
+	int depth; // Nesting level, 0 for outermost zones
+	double cpuStart, cpuMs;
+	double gpuStart, gpuMs; // gpuMs is -1 when the result was not ready in time
+	ProfileCounters counters;
+};
+
+struct ProfileFrame {
+	unsigned long long index;
+	std::vector<ProfileZone> zones;
+};
+
+// Named, nestable zones timed on the CPU and on the GPU with pairs of timestamp queries
+class FrameProfiler {
+public:
+	FrameProfiler();
+	~FrameProfiler();
+
+	// Read back the frame issued PROFILER_LATENCY frames ago and start recording a new one
+	void beginFrame();
+
+	// name must outlive the profiler, e.g. a string literal; counters are the running totals at that point
+	void begin(const char* name, const ProfileCounters& counters);
+	void end(const ProfileCounters& counters);
+
+	// Most recent frame whose GPU results were read back
+	const ProfileFrame& latest() const { return latestFrame; }
+
+	// Wait for every outstanding query, e.g. before exporting at exit
+	void finish();
+
+	// Write the kept frames as Chrome trace event JSON (chrome://tracing or Perfetto), CPU and GPU as two threads
+	bool exportTrace(const std::string& path) const;
+
+private:
+	FrameProfiler(const FrameProfiler&);
+	FrameProfiler& operator=(const FrameProfiler&);
+
+	struct PendingZone {
+		ProfileZone zone;
+		ProfileCounters startCounters;
+		GLuint queries[2]; // Start and end timestamps
+	};
+
+	struct Frame {
+		unsigned long long index;
+		bool recorded;
+		std::vector<PendingZone> zones;
+	};
+
+	double cpuMs() const;
+	GLuint allocateQuery();
+	void resolve(Frame& frame, bool wait);
+
+	Frame frames[PROFILER_LATENCY];
+	unsigned long long frameIndex;
+	std::vector<size_t> open; // Zones begun but not ended in the current frame
+	std::vector<GLuint> freeQueries;
+	std::deque<ProfileFrame> history;
+	ProfileFrame latestFrame;
+
+	std::chrono::steady_clock::time_point start;
+	GLint64 gpuStart; // GPU timestamp taken together with start
+};
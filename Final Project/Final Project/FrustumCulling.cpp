@@ -0,0 +1,144 @@
+#include "FrustumCulling.h"
+
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#include <xmmintrin.h>
+#define FRUSTUM_CULLING_SSE 1
+#endif
+
+using namespace std;
+
+Frustum extractFrustum(const glm::mat4& viewProjection) {
+	// Rows of the matrix; glm stores columns
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+	// Clip space -w <= x, y, z <= w, one plane per inequality
+	Frustum frustum;
+	frustum.planes[0] = rows[3] + rows[0];
+	frustum.planes[1] = rows[3] - rows[0];
+	frustum.planes[2] = rows[3] + rows[1];
+	frustum.planes[3] = rows[3] - rows[1];
+	frustum.planes[4] = rows[3] + rows[2];
+	frustum.planes[5] = rows[3] - rows[2];
+
+	return frustum;
+}
+
+MeshBounds transformBounds(const MeshBounds& bounds, const glm::mat4& transform) {
+	glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+	glm::vec3 extent = (bounds.max - bounds.min) * 0.5f;
+
+	// Each world axis extent is the sum of the local extents projected onto it
+	glm::vec3 worldCenter = glm::vec3(transform * glm::vec4(center, 1.0f));
+	glm::vec3 worldExtent;
+	for (int i = 0; i < 3; i++)
+		worldExtent[i] = fabs(transform[0][i]) * extent.x + fabs(transform[1][i]) * extent.y + fabs(transform[2][i]) * extent.z;
+
+	MeshBounds result;
+	result.min = worldCenter - worldExtent;
+	result.max = worldCenter + worldExtent;
+	return result;
+}
+
+bool intersectsSphere(const MeshBounds& bounds, const glm::vec3& center, float radius) {
+	glm::vec3 closest = glm::clamp(center, bounds.min, bounds.max);
+	glm::vec3 offset = center - closest;
+	return glm::dot(offset, offset) <= radius * radius;
+}
+
+int CullingVolumes::add(const MeshBounds& bounds) {
+	// Grow four lanes at a time so the SSE loop never reads past the end
+	if (count % 4 == 0) {
+		centerX.resize(count + 4, 0.0f);
+		centerY.resize(count + 4, 0.0f);
+		centerZ.resize(count + 4, 0.0f);
+		extentX.resize(count + 4, 0.0f);
+		extentY.resize(count + 4, 0.0f);
+		extentZ.resize(count + 4, 0.0f);
+	}
+
+	count++;
+	set((int)count - 1, bounds);
+	return (int)count - 1;
+}
+
+void CullingVolumes::set(int index, const MeshBounds& bounds) {
+	centerX[index] = (bounds.min.x + bounds.max.x) * 0.5f;
+	centerY[index] = (bounds.min.y + bounds.max.y) * 0.5f;
+	centerZ[index] = (bounds.min.z + bounds.max.z) * 0.5f;
+	extentX[index] = (bounds.max.x - bounds.min.x) * 0.5f;
+	extentY[index] = (bounds.max.y - bounds.min.y) * 0.5f;
+	extentZ[index] = (bounds.max.z - bounds.min.z) * 0.5f;
+}
+
+void CullingVolumes::clear() {
+	count = 0;
+	centerX.clear();
+	centerY.clear();
+	centerZ.clear();
+	extentX.clear();
+	extentY.clear();
+	extentZ.clear();
+}
+
+// A box is outside when its center is further behind some plane than its extent reaches along the plane normal
+size_t CullingVolumes::cull(const Frustum& frustum, vector<uint8_t>& visible) const {
+	visible.resize(count);
+	size_t visibleCount = 0;
+
+#ifdef FRUSTUM_CULLING_SSE
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+	for (int p = 0; p < 6; p++) {
+		const glm::vec4& plane = frustum.planes[p];
+		planeX[p] = _mm_set1_ps(plane.x);
+		planeY[p] = _mm_set1_ps(plane.y);
+		planeZ[p] = _mm_set1_ps(plane.z);
+		planeW[p] = _mm_set1_ps(plane.w);
+		absX[p] = _mm_set1_ps(fabs(plane.x));
+		absY[p] = _mm_set1_ps(fabs(plane.y));
+		absZ[p] = _mm_set1_ps(fabs(plane.z));
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+
+	for (size_t i = 0; i < count; i += 4) {
+		__m128 cx = _mm_loadu_ps(&centerX[i]);
+		__m128 cy = _mm_loadu_ps(&centerY[i]);
+		__m128 cz = _mm_loadu_ps(&centerZ[i]);
+		__m128 ex = _mm_loadu_ps(&extentX[i]);
+		__m128 ey = _mm_loadu_ps(&extentY[i]);
+		__m128 ez = _mm_loadu_ps(&extentZ[i]);
+
+		__m128 inside = _mm_cmpeq_ps(zero, zero);
+		for (int p = 0; p < 6; p++) {
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy)), _mm_add_ps(_mm_mul_ps(planeZ[p], cz), planeW[p]));
+			__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], ex), _mm_mul_ps(absY[p], ey)), _mm_mul_ps(absZ[p], ez));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		for (size_t lane = 0; lane < 4 && i + lane < count; lane++) {
+			visible[i + lane] = (mask >> lane) & 1;
+			visibleCount += visible[i + lane];
+		}
+	}
+#else
+	for (size_t i = 0; i < count; i++) {
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; p++) {
+			const glm::vec4& plane = frustum.planes[p];
+			float distance = plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w;
+			float radius = fabs(plane.x) * extentX[i] + fabs(plane.y) * extentY[i] + fabs(plane.z) * extentZ[i];
+			inside = distance + radius >= 0.0f;
+		}
+
+		visible[i] = inside;
+		visibleCount += inside;
+	}
+#endif
+
+	return visibleCount;
+}
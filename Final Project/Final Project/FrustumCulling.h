@@ -0,0 +1,46 @@
+#pragma once
+
+#include "MeshGenerator.h"
+
+#include <glm/glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Six planes (ax + by + cz + d >= 0 inside) in world space: left, right, bottom, top, near, far
+struct Frustum {
+	glm::vec4 planes[6];
+};
+
+// Planes of a combined projection * view matrix, perspective or orthographic
+Frustum extractFrustum(const glm::mat4& viewProjection);
+
+// Box enclosing a bounding box after a transform
+MeshBounds transformBounds(const MeshBounds& bounds, const glm::mat4& transform);
+
+// True when the box and the sphere overlap
+bool intersectsSphere(const MeshBounds& bounds, const glm::vec3& center, float radius);
+
+// World-space bounding boxes stored as separate center and extent arrays so four are tested per SSE instruction
+class CullingVolumes {
+public:
+	CullingVolumes() : count(0) {}
+
+	// Append a volume and return its index
+	int add(const MeshBounds& bounds);
+	void set(int index, const MeshBounds& bounds);
+
+	size_t size() const { return count; }
+	void clear();
+
+	// Write 1 to visible[i] for volumes inside or crossing the frustum, 0 otherwise; returns the number visible
+	size_t cull(const Frustum& frustum, std::vector<uint8_t>& visible) const;
+
+private:
+	size_t count;
+
+	// Padded to a multiple of four
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+};
@@ -0,0 +1,87 @@
+#include "GBuffer.h"
+
+#include <iostream>
+
+using namespace std;
+
+namespace {
+	GLuint createAttachment(GLenum internalFormat, GLenum format, GLenum type, int width, int height) {
+		GLuint texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return texture;
+	}
+}
+
+GBuffer::GBuffer() : albedo(0), normal(0), depth(0), width(0), height(0) {
+	glGenFramebuffers(1, &fbo);
+
+	// Core profiles need a VAO bound even when no attributes are read
+	glGenVertexArrays(1, &emptyVao);
+}
+
+GBuffer::~GBuffer() {
+	deleteAttachments();
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteVertexArrays(1, &emptyVao);
+}
+
+void GBuffer::deleteAttachments() {
+	glDeleteTextures(1, &albedo);
+	glDeleteTextures(1, &normal);
+	glDeleteTextures(1, &depth);
+	albedo = normal = depth = 0;
+}
+
+void GBuffer::resize(int newWidth, int newHeight) {
+	if (newWidth == width && newHeight == height)
+		return;
+
+	width = newWidth;
+	height = newHeight;
+
+	deleteAttachments();
+	albedo = createAttachment(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, width, height);
+	normal = createAttachment(GL_RGBA16F, GL_RGBA, GL_FLOAT, width, height);
+	depth = createAttachment(GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT, width, height);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedo, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normal, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth, 0);
+
+	GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, drawBuffers);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		cout << "G-buffer framebuffer is incomplete" << endl;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void GBuffer::bindTextures(GLuint firstUnit) const {
+	GLuint textures[] = { albedo, normal, depth };
+	for (GLuint i = 0; i < 3; i++) {
+		glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void GBuffer::unbindTextures(GLuint firstUnit) const {
+	for (GLuint i = 0; i < 3; i++) {
+		glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void GBuffer::drawFullscreen() const {
+	glBindVertexArray(emptyVao);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+}
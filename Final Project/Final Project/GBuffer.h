@@ -0,0 +1,34 @@
+#pragma once
+
+#include <GLEW/glew.h>
+
+// Framebuffer the deferred path renders surface attributes into before lighting them in one full-screen pass
+// Attachment 0 is albedo (RGBA8), attachment 1 the world-space normal (RGBA16F), plus a 32-bit float depth texture
+class GBuffer {
+public:
+	GBuffer();
+	~GBuffer();
+
+	// Reallocate the attachments when the framebuffer size changes
+	void resize(int width, int height);
+
+	GLuint framebuffer() const { return fbo; }
+
+	// Bind albedo, normal and depth to three consecutive texture units, or unbind them
+	void bindTextures(GLuint firstUnit) const;
+	void unbindTextures(GLuint firstUnit) const;
+
+	// Draw one triangle covering the screen, with positions generated from gl_VertexID
+	void drawFullscreen() const;
+
+private:
+	GBuffer(const GBuffer&);
+	GBuffer& operator=(const GBuffer&);
+
+	void deleteAttachments();
+
+	GLuint fbo;
+	GLuint albedo, normal, depth;
+	GLuint emptyVao;
+	int width, height;
+};
@@ -0,0 +1,740 @@
+#include "GltfModel.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+using namespace std;
+
+namespace {
+	const uint32_t GLB_MAGIC = 0x46546C67; // "glTF"
+	const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+	const uint32_t GLB_CHUNK_BIN = 0x004E4942;
+	const int GLTF_TRIANGLES = 4;
+	const int JSON_MAX_DEPTH = 128;
+
+	// Parsed JSON; objects keep their keys and values in file order
+	struct JsonValue {
+		enum Type { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+
+		Type type;
+		double number; // Also 1 or 0 for booleans
+		string text;
+		vector<string> keys;
+		vector<JsonValue> items; // Array elements, or object values in the order of keys
+
+		JsonValue() : type(JSON_NULL), number(0.0) {}
+
+		const JsonValue* member(const string& key) const {
+			for (size_t i = 0; i < keys.size(); i++) {
+				if (keys[i] == key)
+					return &items[i];
+			}
+			return nullptr;
+		}
+	};
+
+	class JsonParser {
+	public:
+		JsonParser(const char* begin, const char* end) : p(begin), end(end) {}
+
+		bool parse(JsonValue& value) {
+			if (!parseValue(value, 0))
+				return false;
+			skipSpace();
+			return p == end;
+		}
+
+	private:
+		void skipSpace() {
+			while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+				p++;
+		}
+
+		bool literal(const char* word) {
+			size_t length = strlen(word);
+			if ((size_t)(end - p) < length || strncmp(p, word, length) != 0)
+				return false;
+			p += length;
+			return true;
+		}
+
+		bool parseValue(JsonValue& value, int depth) {
+			skipSpace();
+			if (p == end || depth > JSON_MAX_DEPTH)
+				return false;
+
+			switch (*p) {
+			case '{':
+				return parseObject(value, depth);
+			case '[':
+				return parseArray(value, depth);
+			case '"':
+				value.type = JsonValue::JSON_STRING;
+				return parseString(value.text);
+			case 't':
+				value.type = JsonValue::JSON_BOOL;
+				value.number = 1.0;
+				return literal("true");
+			case 'f':
+				value.type = JsonValue::JSON_BOOL;
+				return literal("false");
+			case 'n':
+				return literal("null");
+			default:
+				return parseNumber(value);
+			}
+		}
+
+		// The chunk is not null-terminated, so strtod reads a copy
+		bool parseNumber(JsonValue& value) {
+			const char* start = p;
+			while (p < end && strchr("+-0123456789.eE", *p) != nullptr && *p != '\0')
+				p++;
+
+			string digits(start, p);
+			char* parsed = nullptr;
+			value.type = JsonValue::JSON_NUMBER;
+			value.number = strtod(digits.c_str(), &parsed);
+			return !digits.empty() && parsed == digits.c_str() + digits.size();
+		}
+
+		bool parseHex(unsigned& code) {
+			if (end - p < 4)
+				return false;
+
+			code = 0;
+			for (int i = 0; i < 4; i++, p++) {
+				char c = *p;
+				code <<= 4;
+				if (c >= '0' && c <= '9')
+					code |= c - '0';
+				else if (c >= 'a' && c <= 'f')
+					code |= c - 'a' + 10;
+				else if (c >= 'A' && c <= 'F')
+					code |= c - 'A' + 10;
+				else
+					return false;
+			}
+			return true;
+		}
+
+		bool parseString(string& text) {
+			p++;
+			text.clear();
+
+			while (p < end && *p != '"') {
+				if (*p != '\\') {
+					text += *p++;
+					continue;
+				}
+
+				if (++p == end)
+					return false;
+
+				char escape = *p++;
+				switch (escape) {
+				case 'b': text += '\b'; break;
+				case 'f': text += '\f'; break;
+				case 'n': text += '\n'; break;
+				case 'r': text += '\r'; break;
+				case 't': text += '\t'; break;
+				case 'u': {
+					// Encode the code point as UTF-8, joining surrogate pairs
+					unsigned code;
+					if (!parseHex(code))
+						return false;
+					if (code >= 0xD800 && code < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+						unsigned low;
+						p += 2;
+						if (!parseHex(low))
+							return false;
+						code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+					}
+
+					if (code < 0x80) {
+						text += (char)code;
+					}
+					else if (code < 0x800) {
+						text += (char)(0xC0 | (code >> 6));
+						text += (char)(0x80 | (code & 0x3F));
+					}
+					else if (code < 0x10000) {
+						text += (char)(0xE0 | (code >> 12));
+						text += (char)(0x80 | ((code >> 6) & 0x3F));
+						text += (char)(0x80 | (code & 0x3F));
+					}
+					else {
+						text += (char)(0xF0 | (code >> 18));
+						text += (char)(0x80 | ((code >> 12) & 0x3F));
+						text += (char)(0x80 | ((code >> 6) & 0x3F));
+						text += (char)(0x80 | (code & 0x3F));
+					}
+					break;
+				}
+				default:
+					text += escape;
+					break;
+				}
+			}
+
+			if (p == end)
+				return false;
+			p++;
+			return true;
+		}
+
+		bool parseArray(JsonValue& value, int depth) {
+			value.type = JsonValue::JSON_ARRAY;
+			p++;
+			skipSpace();
+			if (p < end && *p == ']') {
+				p++;
+				return true;
+			}
+
+			while (true) {
+				value.items.push_back(JsonValue());
+				if (!parseValue(value.items.back(), depth + 1))
+					return false;
+
+				skipSpace();
+				if (p == end)
+					return false;
+				if (*p++ == ']')
+					return true;
+				if (p[-1] != ',')
+					return false;
+			}
+		}
+
+		bool parseObject(JsonValue& value, int depth) {
+			value.type = JsonValue::JSON_OBJECT;
+			p++;
+			skipSpace();
+			if (p < end && *p == '}') {
+				p++;
+				return true;
+			}
+
+			while (true) {
+				skipSpace();
+				value.keys.push_back(string());
+				if (p == end || *p != '"' || !parseString(value.keys.back()))
+					return false;
+
+				skipSpace();
+				if (p == end || *p++ != ':')
+					return false;
+
+				value.items.push_back(JsonValue());
+				if (!parseValue(value.items.back(), depth + 1))
+					return false;
+
+				skipSpace();
+				if (p == end)
+					return false;
+				if (*p++ == '}')
+					return true;
+				if (p[-1] != ',')
+					return false;
+			}
+		}
+
+		const char* p;
+		const char* end;
+	};
+
+	// Empty array for missing top-level lists
+	const JsonValue& list(const JsonValue& object, const char* key) {
+		static const JsonValue empty;
+		const JsonValue* value = object.member(key);
+		return value != nullptr && value->type == JsonValue::JSON_ARRAY ? *value : empty;
+	}
+
+	double number(const JsonValue* value, double fallback) {
+		return value != nullptr && value->type == JsonValue::JSON_NUMBER ? value->number : fallback;
+	}
+
+	int index(const JsonValue& object, const char* key) {
+		return (int)number(object.member(key), -1.0);
+	}
+
+	// Read count numbers of an array member into values, leaving them unchanged if it is missing or short
+	bool numbers(const JsonValue& object, const char* key, float* values, size_t count) {
+		const JsonValue* array = object.member(key);
+		if (array == nullptr || array->type != JsonValue::JSON_ARRAY || array->items.size() < count)
+			return false;
+
+		for (size_t i = 0; i < count; i++)
+			values[i] = (float)number(&array->items[i], values[i]);
+		return true;
+	}
+
+	uint32_t readU32(const unsigned char* data) {
+		uint32_t value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	string directoryOf(const string& path) {
+		size_t slash = path.find_last_of("/\\");
+		return slash == string::npos ? string() : path.substr(0, slash + 1);
+	}
+
+	// URIs are relative to the file and may be percent-encoded
+	string uriPath(const string& directory, const string& uri) {
+		string path = directory;
+		for (size_t i = 0; i < uri.size(); i++) {
+			if (uri[i] == '%' && i + 2 < uri.size()) {
+				path += (char)strtol(uri.substr(i + 1, 2).c_str(), nullptr, 16);
+				i += 2;
+			}
+			else {
+				path += uri[i];
+			}
+		}
+		return path;
+	}
+
+	// Matrix, or translation * rotation * scale
+	glm::mat4 nodeTransform(const JsonValue& node) {
+		float matrix[16];
+		if (numbers(node, "matrix", matrix, 16)) {
+			glm::mat4 local;
+			for (int i = 0; i < 16; i++)
+				local[i / 4][i % 4] = matrix[i];
+			return local;
+		}
+
+		float t[3] = { 0.0f, 0.0f, 0.0f };
+		float r[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		float s[3] = { 1.0f, 1.0f, 1.0f };
+		numbers(node, "translation", t, 3);
+		numbers(node, "rotation", r, 4);
+		numbers(node, "scale", s, 3);
+
+		float x = r[0], y = r[1], z = r[2], w = r[3];
+		glm::mat4 local(1.0f);
+		local[0] = glm::vec4(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z), 2.0f * (x * z - w * y), 0.0f) * s[0];
+		local[1] = glm::vec4(2.0f * (x * y - w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + w * x), 0.0f) * s[1];
+		local[2] = glm::vec4(2.0f * (x * z + w * y), 2.0f * (y * z - w * x), 1.0f - 2.0f * (x * x + y * y), 0.0f) * s[2];
+		local[3] = glm::vec4(t[0], t[1], t[2], 1.0f);
+		return local;
+	}
+
+	// Bytes of a buffer: the GLB binary chunk or a mapped .bin file
+	struct BufferData {
+		const unsigned char* data;
+		size_t size;
+	};
+
+	// Checked location of an accessor's elements
+	struct Accessor {
+		int view;
+		size_t offset; // Byte offset into the view
+		GLenum componentType; // glTF component types are the GL enums
+		GLint components;
+		GLboolean normalized;
+		GLsizei count;
+		GLsizei stride; // 0 when tightly packed
+	};
+
+	GLint componentCount(const string& type) {
+		if (type == "SCALAR")
+			return 1;
+		if (type == "VEC2")
+			return 2;
+		if (type == "VEC3")
+			return 3;
+		if (type == "VEC4")
+			return 4;
+		return 0;
+	}
+
+	size_t componentSize(GLenum type) {
+		switch (type) {
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE:
+			return 1;
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+			return 2;
+		case GL_UNSIGNED_INT:
+		case GL_FLOAT:
+			return 4;
+		default:
+			return 0;
+		}
+	}
+
+	// Check that every element lies inside its view and the view inside its buffer
+	bool readAccessor(const JsonValue& root, const vector<BufferData>& buffers, int accessorIndex, Accessor& accessor, string& problem) {
+		const JsonValue& accessors = list(root, "accessors");
+		const JsonValue& views = list(root, "bufferViews");
+		if (accessorIndex < 0 || accessorIndex >= (int)accessors.items.size()) {
+			problem = "accessor " + to_string(accessorIndex) + " does not exist";
+			return false;
+		}
+
+		const JsonValue& source = accessors.items[accessorIndex];
+		const JsonValue* type = source.member("type");
+		accessor.view = index(source, "bufferView");
+		accessor.offset = (size_t)number(source.member("byteOffset"), 0.0);
+		accessor.componentType = (GLenum)index(source, "componentType");
+		accessor.components = type != nullptr ? componentCount(type->text) : 0;
+		const JsonValue* normalized = source.member("normalized");
+		accessor.normalized = normalized != nullptr && normalized->type == JsonValue::JSON_BOOL && normalized->number != 0.0 ? GL_TRUE : GL_FALSE;
+		accessor.count = (GLsizei)number(source.member("count"), 0.0);
+
+		string name = "accessor " + to_string(accessorIndex);
+		if (source.member("sparse") != nullptr || accessor.view < 0) {
+			problem = name + " is sparse or has no buffer view, which is not supported";
+			return false;
+		}
+		if (accessor.view >= (int)views.items.size() || accessor.components == 0 || componentSize(accessor.componentType) == 0 || accessor.count <= 0) {
+			problem = name + " is invalid";
+			return false;
+		}
+
+		const JsonValue& view = views.items[accessor.view];
+		int buffer = index(view, "buffer");
+		size_t viewOffset = (size_t)number(view.member("byteOffset"), 0.0);
+		size_t viewLength = (size_t)number(view.member("byteLength"), 0.0);
+		size_t elementSize = componentSize(accessor.componentType) * accessor.components;
+		accessor.stride = (GLsizei)number(view.member("byteStride"), 0.0);
+
+		size_t stride = accessor.stride != 0 ? (size_t)accessor.stride : elementSize;
+		if (buffer < 0 || buffer >= (int)buffers.size() || viewOffset + viewLength > buffers[buffer].size
+			|| accessor.offset + stride * (accessor.count - 1) + elementSize > viewLength) {
+			problem = name + " reads outside its buffer";
+			return false;
+		}
+
+		return true;
+	}
+}
+
+bool loadGltf(const string& path, GltfModel& model, string& error) {
+	model = GltfModel();
+	model.bufferBytes = 0;
+
+	MappedFile file;
+	if (!file.open(path)) {
+		error = path + ": cannot open file";
+		return false;
+	}
+
+	const char* json = (const char*)file.data();
+	size_t jsonSize = file.size();
+	BufferData binary = { nullptr, 0 };
+
+	// A .glb is a 12-byte header followed by a JSON chunk and an optional binary chunk
+	if (file.size() >= 12 && readU32(file.data()) == GLB_MAGIC) {
+		size_t length = min<size_t>(readU32(file.data() + 8), file.size());
+		if (readU32(file.data() + 4) != 2) {
+			error = path + ": only GLB version 2 is supported";
+			return false;
+		}
+
+		json = nullptr;
+		for (size_t offset = 12; offset + 8 <= length;) {
+			size_t chunkLength = readU32(file.data() + offset);
+			uint32_t chunkType = readU32(file.data() + offset + 4);
+			const unsigned char* chunk = file.data() + offset + 8;
+			if (offset + 8 + chunkLength > length)
+				break;
+
+			if (chunkType == GLB_CHUNK_JSON && json == nullptr) {
+				json = (const char*)chunk;
+				jsonSize = chunkLength;
+			}
+			else if (chunkType == GLB_CHUNK_BIN && binary.data == nullptr) {
+				binary.data = chunk;
+				binary.size = chunkLength;
+			}
+			offset += 8 + chunkLength;
+		}
+
+		if (json == nullptr) {
+			error = path + ": GLB has no JSON chunk";
+			return false;
+		}
+	}
+
+	JsonValue root;
+	JsonParser parser(json, json + jsonSize);
+	if (!parser.parse(root) || root.type != JsonValue::JSON_OBJECT) {
+		error = path + ": invalid JSON";
+		return false;
+	}
+
+	const JsonValue* asset = root.member("asset");
+	const JsonValue* version = asset != nullptr ? asset->member("version") : nullptr;
+	if (version == nullptr || version->text.compare(0, 2, "2.") != 0) {
+		error = path + ": only glTF 2.0 is supported";
+		return false;
+	}
+
+	// External buffers are mapped too; every mapping only has to last until the views are uploaded
+	string directory = directoryOf(path);
+	vector<unique_ptr<MappedFile> > mappings;
+	vector<BufferData> buffers;
+	const JsonValue& bufferList = list(root, "buffers");
+	for (size_t i = 0; i < bufferList.items.size(); i++) {
+		const JsonValue* uri = bufferList.items[i].member("uri");
+		size_t byteLength = (size_t)number(bufferList.items[i].member("byteLength"), 0.0);
+		BufferData buffer = { nullptr, 0 };
+
+		if (uri == nullptr && i == 0 && binary.data != nullptr) {
+			buffer = binary;
+		}
+		else if (uri != nullptr && uri->text.compare(0, 5, "data:") != 0) {
+			mappings.push_back(unique_ptr<MappedFile>(new MappedFile()));
+			if (mappings.back()->open(uriPath(directory, uri->text))) {
+				buffer.data = mappings.back()->data();
+				buffer.size = mappings.back()->size();
+			}
+		}
+
+		if (buffer.data == nullptr || buffer.size < byteLength) {
+			error = path + ": buffer " + to_string(i) + " is missing, too short or an embedded data URI, which is not supported";
+			return false;
+		}
+		buffers.push_back(buffer);
+	}
+
+	// Base color factor and texture of the metallic-roughness model; other material properties have no input in the shaders
+	const JsonValue& textures = list(root, "textures");
+	const JsonValue& images = list(root, "images");
+	const JsonValue& materials = list(root, "materials");
+	for (size_t i = 0; i < materials.items.size(); i++) {
+		GltfMaterial material;
+		float color[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		const JsonValue* pbr = materials.items[i].member("pbrMetallicRoughness");
+		const JsonValue* baseColorTexture = pbr != nullptr ? pbr->member("baseColorTexture") : nullptr;
+		if (pbr != nullptr)
+			numbers(*pbr, "baseColorFactor", color, 4);
+		material.color = glm::vec3(color[0], color[1], color[2]);
+
+		int texture = baseColorTexture != nullptr ? index(*baseColorTexture, "index") : -1;
+		int image = texture >= 0 && texture < (int)textures.items.size() ? index(textures.items[texture], "source") : -1;
+		if (image >= 0 && image < (int)images.items.size()) {
+			const JsonValue* uri = images.items[image].member("uri");
+			if (uri != nullptr && uri->text.compare(0, 5, "data:") != 0)
+				material.texture = uriPath(directory, uri->text);
+			else
+				cout << path << ": image " << image << " is embedded, material " << i << " uses its base color only" << endl;
+		}
+
+		model.materials.push_back(material);
+	}
+
+	// Every buffer view a primitive reads becomes one GL buffer, filled straight from the mapping
+	const JsonValue& views = list(root, "bufferViews");
+	vector<GLuint> viewBuffers(views.items.size(), 0);
+	auto viewBuffer = [&](int view) {
+		if (viewBuffers[view] == 0) {
+			const JsonValue& source = views.items[view];
+			const BufferData& buffer = buffers[index(source, "buffer")];
+			size_t offset = (size_t)number(source.member("byteOffset"), 0.0);
+			size_t length = (size_t)number(source.member("byteLength"), 0.0);
+
+			glGenBuffers(1, &viewBuffers[view]);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, viewBuffers[view]);
+			glBufferData(GL_COPY_WRITE_BUFFER, length, buffer.data + offset, GL_STATIC_DRAW);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+			model.buffers.push_back(viewBuffers[view]);
+			model.bufferBytes += length;
+		}
+		return viewBuffers[view];
+	};
+
+	// Attribute locations of the mesh shaders
+	const char* attributeNames[] = { "POSITION", "TEXCOORD_0", "NORMAL" };
+	const GLuint attributeLocations[] = { POSITION_LOCATION, TEX_COORD_LOCATION, NORMAL_LOCATION };
+
+	// Attributes a primitive lacks stay disabled and read these constants, which are context state rather than part of the VAO:
+	// texture coordinate (0, 0), and a zero normal the mesh shaders replace with the face normal
+	glVertexAttrib2f(TEX_COORD_LOCATION, 0.0f, 0.0f);
+	glVertexAttrib3f(NORMAL_LOCATION, 0.0f, 0.0f, 0.0f);
+
+	const JsonValue& meshes = list(root, "meshes");
+	vector<vector<int> > meshPrimitives(meshes.items.size());
+	for (size_t i = 0; i < meshes.items.size(); i++) {
+		const JsonValue& primitiveList = list(meshes.items[i], "primitives");
+		for (size_t j = 0; j < primitiveList.items.size(); j++) {
+			const JsonValue& source = primitiveList.items[j];
+			const JsonValue* attributes = source.member("attributes");
+			string name = "mesh " + to_string(i) + " primitive " + to_string(j);
+
+			if (number(source.member("mode"), GLTF_TRIANGLES) != GLTF_TRIANGLES) {
+				cout << path << ": skipping " << name << ", which is not a triangle list" << endl;
+				continue;
+			}
+
+			// Check every accessor before creating anything for the primitive
+			Accessor accessors[3];
+			bool present[3];
+			string problem;
+			for (int k = 0; k < 3; k++) {
+				int accessor = attributes != nullptr ? index(*attributes, attributeNames[k]) : -1;
+				present[k] = accessor >= 0;
+				if (present[k] && !readAccessor(root, buffers, accessor, accessors[k], problem)) {
+					deleteGltfModel(model);
+					error = path + ": " + name + " " + attributeNames[k] + ": " + problem;
+					return false;
+				}
+			}
+
+			float minimum[3], maximum[3];
+			const JsonValue* positions = present[0] ? &list(root, "accessors").items[index(*attributes, "POSITION")] : nullptr;
+			if (positions == nullptr || accessors[0].components != 3 || !numbers(*positions, "min", minimum, 3) || !numbers(*positions, "max", maximum, 3)) {
+				deleteGltfModel(model);
+				error = path + ": " + name + " has no VEC3 POSITION with min and max";
+				return false;
+			}
+
+			Accessor indices = Accessor();
+			int indexAccessor = index(source, "indices");
+			if (indexAccessor >= 0 && (!readAccessor(root, buffers, indexAccessor, indices, problem) || indices.components != 1
+				|| indices.componentType == GL_BYTE || indices.componentType == GL_SHORT || indices.componentType == GL_FLOAT)) {
+				deleteGltfModel(model);
+				error = path + ": " + name + " indices: " + (problem.empty() ? "not unsigned integers" : problem);
+				return false;
+			}
+
+			GltfPrimitive primitive;
+			primitive.material = index(source, "material");
+			if (primitive.material >= (int)model.materials.size())
+				primitive.material = -1;
+			primitive.bounds.min = glm::vec3(minimum[0], minimum[1], minimum[2]);
+			primitive.bounds.max = glm::vec3(maximum[0], maximum[1], maximum[2]);
+
+			glGenVertexArrays(1, &primitive.vao); // Create VAO
+			glBindVertexArray(primitive.vao); // Bind VAO
+
+			// Specify attribute location and layout to GPU, in the accessors' own types
+			for (int k = 0; k < 3; k++) {
+				if (!present[k])
+					continue;
+
+				glBindBuffer(GL_ARRAY_BUFFER, viewBuffer(accessors[k].view));
+				glVertexAttribPointer(attributeLocations[k], accessors[k].components, accessors[k].componentType, accessors[k].normalized,
+					accessors[k].stride, (GLvoid*)accessors[k].offset);
+				glEnableVertexAttribArray(attributeLocations[k]);
+			}
+
+			if (indexAccessor >= 0) {
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, viewBuffer(indices.view)); // Select EBO
+				primitive.indexType = indices.componentType;
+				primitive.indexCount = indices.count;
+				primitive.indexOffset = indices.offset;
+			}
+			else {
+				// Unindexed primitives get sequential indices so every primitive draws the same way
+				vector<GLuint> sequence(accessors[0].count);
+				for (size_t k = 0; k < sequence.size(); k++)
+					sequence[k] = (GLuint)k;
+
+				GLuint ebo;
+				glGenBuffers(1, &ebo); // Create EBO
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo); // Select EBO
+				glBufferData(GL_ELEMENT_ARRAY_BUFFER, sequence.size() * sizeof(GLuint), sequence.data(), GL_STATIC_DRAW);
+				model.buffers.push_back(ebo);
+				model.bufferBytes += sequence.size() * sizeof(GLuint);
+
+				primitive.indexType = GL_UNSIGNED_INT;
+				primitive.indexCount = (GLsizei)sequence.size();
+				primitive.indexOffset = 0;
+			}
+
+			glBindVertexArray(0); // Unbind VAO
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+			meshPrimitives[i].push_back((int)model.primitives.size());
+			model.primitives.push_back(primitive);
+		}
+	}
+
+	// Nodes of the default scene, depth first so parents come before their children; a node reached twice is skipped
+	const JsonValue& nodes = list(root, "nodes");
+	const JsonValue& scenes = list(root, "scenes");
+	int sceneIndex = max(index(root, "scene"), 0);
+	vector<int> roots;
+	if (sceneIndex < (int)scenes.items.size()) {
+		const JsonValue& sceneNodes = list(scenes.items[sceneIndex], "nodes");
+		for (size_t i = 0; i < sceneNodes.items.size(); i++)
+			roots.push_back((int)number(&sceneNodes.items[i], -1.0));
+	}
+	else {
+		// Without scenes every node that is nobody's child is a root
+		vector<bool> child(nodes.items.size(), false);
+		for (size_t i = 0; i < nodes.items.size(); i++) {
+			const JsonValue& children = list(nodes.items[i], "children");
+			for (size_t j = 0; j < children.items.size(); j++) {
+				int node = (int)number(&children.items[j], -1.0);
+				if (node >= 0 && node < (int)child.size())
+					child[node] = true;
+			}
+		}
+		for (size_t i = 0; i < child.size(); i++) {
+			if (!child[i])
+				roots.push_back((int)i);
+		}
+	}
+
+	vector<bool> visited(nodes.items.size(), false);
+	vector<pair<int, int> > stack; // glTF node and the index of its parent in model.nodes
+	for (size_t i = roots.size(); i-- > 0;)
+		stack.push_back(make_pair(roots[i], -1));
+
+	while (!stack.empty()) {
+		int node = stack.back().first;
+		int parent = stack.back().second;
+		stack.pop_back();
+		if (node < 0 || node >= (int)nodes.items.size() || visited[node])
+			continue;
+		visited[node] = true;
+
+		const JsonValue& source = nodes.items[node];
+		GltfNode entry;
+		entry.parent = parent;
+		entry.local = nodeTransform(source);
+		int placed = (int)model.nodes.size();
+		model.nodes.push_back(entry);
+
+		int mesh = index(source, "mesh");
+		if (mesh >= 0 && mesh < (int)meshPrimitives.size()) {
+			for (size_t i = 0; i < meshPrimitives[mesh].size(); i++) {
+				GltfInstance instance = { placed, meshPrimitives[mesh][i] };
+				model.instances.push_back(instance);
+			}
+		}
+
+		const JsonValue& children = list(source, "children");
+		for (size_t i = children.items.size(); i-- > 0;)
+			stack.push_back(make_pair((int)number(&children.items[i], -1.0), placed));
+	}
+
+	return true;
+}
+
+void deleteGltfModel(GltfModel& model) {
+	for (size_t i = 0; i < model.primitives.size(); i++)
+		glDeleteVertexArrays(1, &model.primitives[i].vao);
+	if (!model.buffers.empty())
+		glDeleteBuffers((GLsizei)model.buffers.size(), model.buffers.data());
+
+	model.primitives.clear();
+	model.buffers.clear();
+	model.instances.clear();
+	model.nodes.clear();
+	model.materials.clear();
+	model.bufferBytes = 0;
+}
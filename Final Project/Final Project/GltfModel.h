@@ -0,0 +1,57 @@
+#pragma once
+
+#include "MeshGenerator.h"
+
+#include <GLEW/glew.h>
+
+#include <glm/glm/glm.hpp>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Triangles of one glTF mesh primitive, drawn with its own VAO over the model's buffers
+struct GltfPrimitive {
+	GLuint vao;
+	GLenum indexType;
+	GLsizei indexCount;
+	size_t indexOffset; // Byte offset into the element buffer
+	int material; // Index into the model's materials, -1 for the glTF default material
+	MeshBounds bounds; // From the POSITION accessor's min and max
+};
+
+// Base color factor and texture, which become the objectColor and myTexture shading inputs
+struct GltfMaterial {
+	glm::vec3 color;
+	std::string texture; // Image file, empty when untextured or the image is embedded
+};
+
+// Node transform, parents listed before their children like SceneGraph
+struct GltfNode {
+	int parent; // -1 for a root of the model
+	glm::mat4 local;
+};
+
+// Primitive placed by a node
+struct GltfInstance {
+	int node;
+	int primitive;
+};
+
+// Geometry of a .gltf or .glb file uploaded to GL buffers
+struct GltfModel {
+	std::vector<GLuint> buffers; // One per buffer view the primitives read, uploaded straight from the mapped file
+	std::vector<GltfPrimitive> primitives;
+	std::vector<GltfMaterial> materials;
+	std::vector<GltfNode> nodes;
+	std::vector<GltfInstance> instances;
+	size_t bufferBytes;
+};
+
+// Load a .gltf with external .bin buffers or a .glb and upload its triangle primitives (GL thread only)
+// Vertex attributes are read where the accessors point, in their stored component types; on failure error holds "file: message"
+// Primitives without TEXCOORD_0 or NORMAL read a constant (0, 0) or zero normal, which the mesh shaders light with the face normal
+bool loadGltf(const std::string& path, GltfModel& model, std::string& error);
+
+// Release the model's GL objects
+void deleteGltfModel(GltfModel& model);
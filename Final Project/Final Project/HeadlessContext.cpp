@@ -0,0 +1,136 @@
+#include "HeadlessContext.h"
+
+#ifdef HEADLESS_EGL
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <SOIL2/SOIL2.h>
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+HeadlessContext::HeadlessContext() : display(nullptr), context(nullptr) {}
+
+HeadlessContext::~HeadlessContext() {
+#ifdef HEADLESS_EGL
+	if (context != nullptr) {
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(display, context);
+	}
+	if (display != nullptr)
+		eglTerminate(display);
+#endif
+}
+
+bool HeadlessContext::create() {
+#ifdef HEADLESS_EGL
+	// Surfaceless needs no display server or pbuffer; fall back to the default display otherwise
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+	if (getPlatformDisplay != nullptr)
+		eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	if (eglDisplay == EGL_NO_DISPLAY)
+		eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, nullptr, nullptr)) {
+		cout << "Failed to initialize EGL" << endl;
+		return false;
+	}
+	display = eglDisplay;
+
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		cout << "EGL does not support desktop OpenGL" << endl;
+		return false;
+	}
+
+	// Rendering goes to framebuffer objects, so no config or surface is needed
+	EGLint attributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 5,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext eglContext = eglCreateContext(eglDisplay, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+	if (eglContext == EGL_NO_CONTEXT) {
+		cout << "Failed to create an OpenGL 4.5 core context (EGL error 0x" << hex << eglGetError() << dec << ")" << endl;
+		return false;
+	}
+	context = eglContext;
+
+	if (!eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext)) {
+		cout << "Failed to make the headless context current" << endl;
+		return false;
+	}
+
+	return true;
+#else
+	cout << "Headless rendering needs a build with HEADLESS_EGL defined" << endl;
+	return false;
+#endif
+}
+
+OffscreenTarget::OffscreenTarget(int width, int height) : width(width), height(height) {
+	glGenRenderbuffers(1, &color);
+	glBindRenderbuffer(GL_RENDERBUFFER, color);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+	glGenRenderbuffers(1, &depth);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		cout << "Offscreen framebuffer is incomplete" << endl;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+OffscreenTarget::~OffscreenTarget() {
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteRenderbuffers(1, &color);
+	glDeleteRenderbuffers(1, &depth);
+}
+
+bool OffscreenTarget::save(const string& path) const {
+	size_t rowSize = (size_t)width * 4;
+	vector<unsigned char> pixels(rowSize * height);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+	// GL rows start at the bottom, image files at the top
+	vector<unsigned char> row(rowSize);
+	for (int y = 0; y < height / 2; y++) {
+		unsigned char* top = &pixels[y * rowSize];
+		unsigned char* bottom = &pixels[(height - 1 - y) * rowSize];
+		memcpy(row.data(), top, rowSize);
+		memcpy(top, bottom, rowSize);
+		memcpy(bottom, row.data(), rowSize);
+	}
+
+	int type = SOIL_SAVE_TYPE_PNG;
+	size_t dot = path.find_last_of('.');
+	string extension = dot == string::npos ? string() : path.substr(dot);
+	if (extension == ".bmp")
+		type = SOIL_SAVE_TYPE_BMP;
+	else if (extension == ".tga")
+		type = SOIL_SAVE_TYPE_TGA;
+
+	if (!SOIL_save_image(path.c_str(), type, width, height, 4, pixels.data())) {
+		cout << "Failed to write " << path << ": " << SOIL_last_result() << endl;
+		return false;
+	}
+	return true;
+}
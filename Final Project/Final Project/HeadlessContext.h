@@ -0,0 +1,42 @@
+#pragma once
+
+#include <GLEW/glew.h>
+
+#include <string>
+
+// OpenGL 4.5 core context with no window or display, e.g. Mesa llvmpipe on a build machine
+// Uses EGL's surfaceless platform; only available when built with HEADLESS_EGL and linked against libEGL
+class HeadlessContext {
+public:
+	HeadlessContext();
+	~HeadlessContext();
+
+	// Create the context and make it current; prints the reason and returns false on failure
+	bool create();
+
+private:
+	HeadlessContext(const HeadlessContext&);
+	HeadlessContext& operator=(const HeadlessContext&);
+
+	void* display;
+	void* context;
+};
+
+// Color and depth renderbuffers standing in for the window's default framebuffer
+class OffscreenTarget {
+public:
+	OffscreenTarget(int width, int height);
+	~OffscreenTarget();
+
+	GLuint framebuffer() const { return fbo; }
+
+	// Read the color buffer back and write it top row first as .png, .bmp or .tga, chosen by the extension
+	bool save(const std::string& path) const;
+
+private:
+	OffscreenTarget(const OffscreenTarget&);
+	OffscreenTarget& operator=(const OffscreenTarget&);
+
+	int width, height;
+	GLuint fbo, color, depth;
+};
@@ -0,0 +1,184 @@
+#include "IndirectDraw.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+IndirectDrawList::IndirectDrawList() : layers(0), layeredTexture(0) {
+	mesh = Mesh();
+
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &dataAlignment);
+
+	// Renders into one layer at a time; core profiles need a VAO bound even when no attributes are read
+	glGenFramebuffers(1, &layerFbo);
+	glGenVertexArrays(1, &emptyVao);
+}
+
+IndirectDrawList::~IndirectDrawList() {
+	deleteMesh(mesh);
+	glDeleteTextures(1, &layeredTexture);
+	glDeleteFramebuffers(1, &layerFbo);
+	glDeleteVertexArrays(1, &emptyVao);
+}
+
+int IndirectDrawList::addMesh(const MeshData& data) {
+	// Indices stay local to the mesh; baseVertex offsets them at draw time
+	MeshRange range;
+	range.indexCount = (GLuint)data.indices.size();
+	range.firstIndex = (GLuint)geometry.indices.size();
+	range.baseVertex = (GLint)geometry.vertices.size();
+	meshes.push_back(range);
+
+	geometry.vertices.insert(geometry.vertices.end(), data.vertices.begin(), data.vertices.end());
+	geometry.indices.insert(geometry.indices.end(), data.indices.begin(), data.indices.end());
+
+	return (int)meshes.size() - 1;
+}
+
+int IndirectDrawList::addMaterial(const BatchMaterial& material, int textureLayers) {
+	// A texture is given its layers by the first material that uses it
+	size_t source = 0;
+	while (source < sources.size() && sources[source].texture != material.texture)
+		source++;
+
+	if (source == sources.size()) {
+		TextureSource entry;
+		entry.texture = material.texture;
+		entry.textureArray = material.textureArray;
+		entry.firstLayer = layers;
+		entry.layers = material.textureArray ? textureLayers : 1;
+		sources.push_back(entry);
+		layers += entry.layers;
+	}
+
+	Material entry;
+	entry.layer = sources[source].firstLayer;
+	entry.arrayLayers = material.textureArray ? sources[source].layers : 0;
+	entry.color = material.color;
+	materials.push_back(entry);
+
+	return (int)materials.size() - 1;
+}
+
+void IndirectDrawList::upload() {
+	deleteMesh(mesh);
+	mesh = uploadMesh(geometry);
+
+	// The CPU copy is no longer needed
+	geometry = MeshData();
+
+	// Full mip chain for every layer; the contents come from updateTextures()
+	int levels = 1;
+	while ((INDIRECT_TEXTURE_SIZE >> levels) > 0)
+		levels++;
+
+	glDeleteTextures(1, &layeredTexture);
+	glGenTextures(1, &layeredTexture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, layeredTexture);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, GL_RGBA8, INDIRECT_TEXTURE_SIZE, INDIRECT_TEXTURE_SIZE, max(layers, 1));
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void IndirectDrawList::updateTextures(const vector<GLuint>& changed, const ShaderProgram& program) {
+	GLint sourceLayerLoc = program.uniform("sourceLayer");
+	bool updated = false;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, layerFbo);
+	glViewport(0, 0, INDIRECT_TEXTURE_SIZE, INDIRECT_TEXTURE_SIZE);
+	glUseProgram(program.id());
+	glBindVertexArray(emptyVao);
+
+	for (size_t i = 0; i < sources.size(); i++) {
+		const TextureSource& source = sources[i];
+		if (find(changed.begin(), changed.end(), source.texture) == changed.end())
+			continue;
+
+		// The source's own mipmaps filter it down to the layer size
+		GLenum target = source.textureArray ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+		glActiveTexture(source.textureArray ? GL_TEXTURE1 : GL_TEXTURE0);
+		glBindTexture(target, source.texture);
+
+		for (int layer = 0; layer < source.layers; layer++) {
+			glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, layeredTexture, 0, source.firstLayer + layer);
+			glUniform1i(sourceLayerLoc, source.textureArray ? layer : -1);
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+		}
+
+		glBindTexture(target, 0);
+		updated = true;
+	}
+
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 0, 0, 0);
+	glBindVertexArray(0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glActiveTexture(GL_TEXTURE0);
+
+	if (updated) {
+		glBindTexture(GL_TEXTURE_2D_ARRAY, layeredTexture);
+		glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	}
+}
+
+void IndirectDrawList::clear() {
+	commands.clear();
+	drawData.clear();
+}
+
+void IndirectDrawList::add(int meshIndex, int materialIndex, const glm::mat4& model, const glm::mat3& normalMatrix) {
+	const MeshRange& range = meshes[meshIndex];
+	const Material& material = materials[materialIndex];
+
+	DrawElementsIndirectCommand command;
+	command.count = range.indexCount;
+	command.instanceCount = 1;
+	command.firstIndex = range.firstIndex;
+	command.baseVertex = range.baseVertex;
+	command.baseInstance = 0;
+	commands.push_back(command);
+
+	// Every mesh shares the buffer's quantization
+	DrawData data;
+	data.model = model * mesh.decode.position;
+	for (int i = 0; i < 3; i++)
+		data.normalMatrix[i] = glm::vec4(normalMatrix[i], 0.0f);
+	data.color = glm::vec4(material.color, 1.0f);
+	data.texCoordTransform = mesh.decode.texCoord;
+	data.layer = material.layer;
+	data.arrayLayers = material.arrayLayers;
+	data.padding[0] = data.padding[1] = 0;
+	drawData.push_back(data);
+}
+
+void IndirectDrawList::submit(GLuint dataBinding, StreamBuffer& stream) {
+	if (commands.empty())
+		return;
+
+	// Commands followed by the draw data in one allocation, so both come from the same buffer
+	GLsizeiptr commandSize = commands.size() * sizeof(DrawElementsIndirectCommand);
+	GLsizeiptr dataOffset = (commandSize + dataAlignment - 1) / dataAlignment * dataAlignment;
+	GLsizeiptr dataSize = drawData.size() * sizeof(DrawData);
+
+	void* data;
+	GLintptr offset = stream.allocate(dataOffset + dataSize, dataAlignment, &data);
+	memcpy(data, commands.data(), commandSize);
+	memcpy((unsigned char*)data + dataOffset, drawData.data(), dataSize);
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, stream.buffer());
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, dataBinding, stream.buffer(), offset + dataOffset, dataSize);
+
+	// Bind Texture
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, layeredTexture);
+
+	glBindVertexArray(mesh.vao); // Bind VAO
+
+	glMultiDrawElementsIndirect(GL_TRIANGLES, mesh.indexType, (GLvoid*)offset, (GLsizei)commands.size(), 0);
+
+	glBindVertexArray(0); // Unbind VAO
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	// Unbind Texture
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
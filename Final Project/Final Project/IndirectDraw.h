@@ -0,0 +1,105 @@
+#pragma once
+
+#include "MeshGenerator.h"
+#include "ShaderProgram.h"
+#include "StaticBatch.h"
+#include "StreamBuffer.h"
+
+#include <GLEW/glew.h>
+
+#include <glm/glm/glm.hpp>
+
+#include <vector>
+
+// Side of the square layers the scene textures are resampled into for the indirect shaders
+const int INDIRECT_TEXTURE_SIZE = 512;
+
+// Command layout read by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+// Per-draw data fetched in the shaders with gl_DrawID (std430 layout of the DrawData struct)
+struct DrawData {
+	glm::mat4 model;
+	glm::vec4 normalMatrix[3]; // mat3 columns padded to vec4
+	glm::vec4 color;
+	glm::vec4 texCoordTransform; // Scale and offset decoding the shared buffer's texture coordinates
+	GLint layer; // First layer of the material's texture in the layered texture
+	GLint arrayLayers; // Layers the texture coordinate's whole part selects between for array textures, 0 for 2D textures
+	GLint padding[2];
+};
+
+// Meshes share one vertex/index buffer and every draw of a frame is submitted with one glMultiDrawElementsIndirect
+// Samplers may only be indexed with dynamically uniform values, so every scene texture is resampled into layers of one
+// GL_TEXTURE_2D_ARRAY that the draws index by layer: one layer per 2D texture and one per layer of an array texture
+class IndirectDrawList {
+public:
+	IndirectDrawList();
+	~IndirectDrawList();
+
+	// Register shared geometry and materials before upload(); both return the index to draw with
+	// textureLayers is the layer count of an array texture, 1 for a 2D texture
+	int addMesh(const MeshData& mesh);
+	int addMaterial(const BatchMaterial& material, int textureLayers);
+
+	// Upload the shared vertex/index buffer and allocate the layered texture
+	void upload();
+
+	// Resample these textures into their layers and rebuild the mipmaps; call whenever a texture's resident levels change
+	// The program draws a full-screen triangle sampling unit 0 (sampler2D source) or unit 1 (sampler2DArray sourceArray at
+	// sourceLayer, -1 for 2D sources); leaves the default framebuffer bound (GL thread only)
+	void updateTextures(const std::vector<GLuint>& changed, const ShaderProgram& program);
+
+	// Build the frame's draws
+	void clear();
+	void add(int mesh, int material, const glm::mat4& model, const glm::mat3& normalMatrix);
+	size_t size() const { return commands.size(); }
+
+	// Write the commands and draw data into the stream buffer, bind the data to dataBinding and draw them all
+	// The layered texture is bound to unit 0
+	void submit(GLuint dataBinding, StreamBuffer& stream);
+
+private:
+	IndirectDrawList(const IndirectDrawList&);
+	IndirectDrawList& operator=(const IndirectDrawList&);
+
+	struct MeshRange {
+		GLuint indexCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+	};
+
+	struct Material {
+		GLint layer;
+		GLint arrayLayers;
+		glm::vec3 color;
+	};
+
+	// Scene texture and the layers it fills
+	struct TextureSource {
+		GLuint texture;
+		bool textureArray;
+		int firstLayer;
+		int layers;
+	};
+
+	MeshData geometry;
+	Mesh mesh;
+	std::vector<MeshRange> meshes;
+	std::vector<Material> materials;
+	std::vector<TextureSource> sources;
+	int layers;
+	GLuint layeredTexture;
+	GLuint layerFbo;
+	GLuint emptyVao;
+
+	std::vector<DrawElementsIndirectCommand> commands;
+	std::vector<DrawData> drawData;
+
+	GLint dataAlignment; // Offset alignment of storage buffer bindings
+};
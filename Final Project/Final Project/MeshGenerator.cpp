@@ -0,0 +1,237 @@
+#include "MeshGenerator.h"
+
+#include <cmath>
+
+using namespace std;
+
+namespace {
+	const float PI = 3.14159265358979f;
+
+	// Append a vertex and return its index
+	GLuint addVertex(MeshData& data, glm::vec3 position, glm::vec2 texCoord, glm::vec3 normal) {
+		MeshVertex vertex;
+		vertex.position = position;
+		vertex.texCoord = texCoord;
+		vertex.normal = normal;
+
+		data.vertices.push_back(vertex);
+		return (GLuint)data.vertices.size() - 1;
+	}
+
+	void addTriangle(MeshData& data, GLuint a, GLuint b, GLuint c) {
+		data.indices.push_back(a);
+		data.indices.push_back(b);
+		data.indices.push_back(c);
+	}
+
+	// Quad facing uAxis x vAxis, with texture coordinates running along each axis
+	void addQuad(MeshData& data, glm::vec3 center, glm::vec3 uAxis, glm::vec3 vAxis) {
+		glm::vec3 normal = glm::normalize(glm::cross(uAxis, vAxis));
+
+		GLuint v0 = addVertex(data, center - uAxis - vAxis, glm::vec2(0.0f, 0.0f), normal);
+		GLuint v1 = addVertex(data, center + uAxis - vAxis, glm::vec2(1.0f, 0.0f), normal);
+		GLuint v2 = addVertex(data, center + uAxis + vAxis, glm::vec2(1.0f, 1.0f), normal);
+		GLuint v3 = addVertex(data, center - uAxis + vAxis, glm::vec2(0.0f, 1.0f), normal);
+
+		addTriangle(data, v0, v1, v2);
+		addTriangle(data, v0, v2, v3);
+	}
+
+	// Angle of segment edge i; edges sit half a segment either side of +Z so segment 0 faces +Z
+	float edgeAngle(int i, int segments) {
+		return (i - 0.5f) * 2.0f * PI / segments;
+	}
+
+	glm::vec3 ringPoint(float angle, float y) {
+		return glm::vec3(sinf(angle), y, cosf(angle));
+	}
+
+	// Flat disc of radius 1 at height y with planar texture coordinates
+	void addDisc(MeshData& data, int segments, float y, bool facingUp) {
+		glm::vec3 normal = glm::vec3(0.0f, facingUp ? 1.0f : -1.0f, 0.0f);
+		GLuint center = addVertex(data, glm::vec3(0.0f, y, 0.0f), glm::vec2(0.5f, 0.5f), normal);
+
+		GLuint first = (GLuint)data.vertices.size();
+		for (int i = 0; i < segments; i++) {
+			glm::vec3 position = ringPoint(edgeAngle(i, segments), y);
+			addVertex(data, position, glm::vec2(0.5f + 0.5f * position.x, 0.5f + 0.5f * position.z), normal);
+		}
+
+		for (int i = 0; i < segments; i++) {
+			GLuint current = first + i;
+			GLuint next = first + (i + 1) % segments;
+
+			if (facingUp)
+				addTriangle(data, center, current, next);
+			else
+				addTriangle(data, center, next, current);
+		}
+	}
+}
+
+MeshData generatePlane(int divisions) {
+	MeshData data;
+	divisions = divisions < 1 ? 1 : divisions;
+
+	for (int z = 0; z <= divisions; z++) {
+		for (int x = 0; x <= divisions; x++) {
+			float u = (float)x / divisions;
+			float v = (float)z / divisions;
+			addVertex(data, glm::vec3(u - 0.5f, 0.0f, v - 0.5f), glm::vec2(u, v), glm::vec3(0.0f, 1.0f, 0.0f));
+		}
+	}
+
+	GLuint row = divisions + 1;
+	for (int z = 0; z < divisions; z++) {
+		for (int x = 0; x < divisions; x++) {
+			GLuint corner = z * row + x;
+			addTriangle(data, corner, corner + row + 1, corner + 1);
+			addTriangle(data, corner, corner + row, corner + row + 1);
+		}
+	}
+
+	return data;
+}
+
+MeshData generateBox() {
+	MeshData data;
+
+	addQuad(data, glm::vec3(0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -0.5f), glm::vec3(0.0f, 0.5f, 0.0f));  // Right
+	addQuad(data, glm::vec3(-0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.5f), glm::vec3(0.0f, 0.5f, 0.0f));  // Left
+	addQuad(data, glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -0.5f));  // Top
+	addQuad(data, glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.5f));  // Bottom
+	addQuad(data, glm::vec3(0.0f, 0.0f, 0.5f), glm::vec3(0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.5f, 0.0f));   // Front
+	addQuad(data, glm::vec3(0.0f, 0.0f, -0.5f), glm::vec3(-0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.5f, 0.0f)); // Back
+
+	return data;
+}
+
+MeshData generateCylinder(int segments, float uRepeat, bool caps) {
+	MeshData data;
+	segments = segments < 3 ? 3 : segments;
+
+	// Side: one column of shared vertices per edge, with the seam duplicated for texture coordinates
+	for (int i = 0; i <= segments; i++) {
+		float angle = edgeAngle(i, segments);
+		float u = uRepeat * i / segments;
+		glm::vec3 normal = ringPoint(angle, 0.0f);
+
+		addVertex(data, ringPoint(angle, 0.0f), glm::vec2(u, 0.0f), normal);
+		addVertex(data, ringPoint(angle, 1.0f), glm::vec2(u, 1.0f), normal);
+	}
+
+	for (int i = 0; i < segments; i++) {
+		GLuint bottom = i * 2;
+		GLuint top = bottom + 1;
+		GLuint nextBottom = bottom + 2;
+		GLuint nextTop = bottom + 3;
+
+		addTriangle(data, bottom, nextBottom, nextTop);
+		addTriangle(data, bottom, nextTop, top);
+	}
+
+	if (caps) {
+		addDisc(data, segments, 0.0f, false);
+		addDisc(data, segments, 1.0f, true);
+	}
+
+	return data;
+}
+
+MeshData generateCone(int segments, float uRepeat, bool faceted, bool base) {
+	MeshData data;
+	segments = segments < 3 ? 3 : segments;
+	glm::vec3 apex = glm::vec3(0.0f, 1.0f, 0.0f);
+
+	if (faceted) {
+		// Each face has its own three vertices so the normal stays flat
+		for (int i = 0; i < segments; i++) {
+			glm::vec3 left = ringPoint(edgeAngle(i, segments), 0.0f);
+			glm::vec3 right = ringPoint(edgeAngle(i + 1, segments), 0.0f);
+			glm::vec3 normal = glm::normalize(glm::cross(right - left, apex - left));
+			float u0 = uRepeat * i / segments;
+			float u1 = uRepeat * (i + 1) / segments;
+
+			GLuint a = addVertex(data, left, glm::vec2(u0, 0.0f), normal);
+			GLuint b = addVertex(data, right, glm::vec2(u1, 0.0f), normal);
+			GLuint c = addVertex(data, apex, glm::vec2(0.5f * (u0 + u1), 1.0f), normal);
+			addTriangle(data, a, b, c);
+		}
+	}
+	else {
+		// Base ring is shared between segments; the apex is split per segment so its normal follows the face
+		for (int i = 0; i <= segments; i++) {
+			float angle = edgeAngle(i, segments);
+			addVertex(data, ringPoint(angle, 0.0f), glm::vec2(uRepeat * i / segments, 0.0f), glm::normalize(ringPoint(angle, 1.0f)));
+		}
+
+		for (int i = 0; i < segments; i++) {
+			float angle = edgeAngle(i, segments) + PI / segments;
+			GLuint tip = addVertex(data, apex, glm::vec2(uRepeat * (i + 0.5f) / segments, 1.0f), glm::normalize(ringPoint(angle, 1.0f)));
+			addTriangle(data, i, i + 1, tip);
+		}
+	}
+
+	if (base)
+		addDisc(data, segments, 0.0f, false);
+
+	return data;
+}
+
+MeshBounds computeBounds(const MeshData& data) {
+	MeshBounds bounds;
+	bounds.min = bounds.max = data.vertices.empty() ? glm::vec3(0.0f) : data.vertices[0].position;
+
+	for (size_t i = 1; i < data.vertices.size(); i++) {
+		bounds.min = glm::min(bounds.min, data.vertices[i].position);
+		bounds.max = glm::max(bounds.max, data.vertices[i].position);
+	}
+
+	return bounds;
+}
+
+Mesh uploadMesh(const MeshData& data, const VertexLayout& layout) {
+	Mesh mesh;
+	mesh.vertexCount = (GLsizei)data.vertices.size();
+	mesh.indexCount = (GLsizei)data.indices.size();
+
+	VertexFormat format = vertexFormat(layout);
+	vector<unsigned char> vertices;
+	mesh.decode = packVertices(data.vertices, layout, vertices);
+	mesh.vertexStride = format.stride;
+
+	glGenVertexArrays(1, &mesh.vao); // Create VAO
+	glGenBuffers(1, &mesh.vbo); // Create VBO
+	glGenBuffers(1, &mesh.ebo); // Create EBO
+
+	glBindVertexArray(mesh.vao); // Bind VAO
+
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo); // Select VBO
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo); // Select EBO
+	glBufferData(GL_ARRAY_BUFFER, vertices.size(), vertices.data(), GL_STATIC_DRAW); // Load vertex attributes
+
+	// Load element indices, halving their size when every vertex is addressable with 16 bits
+	if (data.vertices.size() <= 65536) {
+		vector<GLushort> shortIndices(data.indices.begin(), data.indices.end());
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(GLushort), shortIndices.data(), GL_STATIC_DRAW);
+		mesh.indexType = GL_UNSIGNED_SHORT;
+	}
+	else {
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, data.indices.size() * sizeof(GLuint), data.indices.data(), GL_STATIC_DRAW);
+		mesh.indexType = GL_UNSIGNED_INT;
+	}
+
+	// Specify attribute location and layout to GPU
+	setVertexAttributes(format);
+
+	glBindVertexArray(0); // Unbind VAO
+
+	return mesh;
+}
+
+void deleteMesh(Mesh& mesh) {
+	glDeleteVertexArrays(1, &mesh.vao);
+	glDeleteBuffers(1, &mesh.vbo);
+	glDeleteBuffers(1, &mesh.ebo);
+	mesh.vao = mesh.vbo = mesh.ebo = 0;
+}
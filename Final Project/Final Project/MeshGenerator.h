@@ -0,0 +1,53 @@
+#pragma once
+
+#include "VertexFormat.h"
+
+#include <GLEW/glew.h>
+
+#include <glm/glm/glm.hpp>
+
+#include <vector>
+
+// Indexed triangle list built on the CPU
+struct MeshData {
+	std::vector<MeshVertex> vertices;
+	std::vector<GLuint> indices;
+};
+
+// Axis-aligned bounding box
+struct MeshBounds {
+	glm::vec3 min, max;
+};
+
+// Mesh uploaded to its own VAO, VBO and EBO
+struct Mesh {
+	GLuint vao, vbo, ebo;
+	GLsizei vertexCount;
+	GLsizei indexCount;
+	GLenum indexType; // GL_UNSIGNED_SHORT when every vertex fits in 16 bits, otherwise GL_UNSIGNED_INT
+	GLsizei vertexStride;
+	VertexDecode decode; // Position decode goes in front of the model matrix, texture coordinate decode to the vertex shader
+};
+
+// Unit square in the XZ plane facing +Y, split into divisions x divisions quads
+MeshData generatePlane(int divisions = 1);
+
+// Unit cube centered on the origin with one quad per face
+MeshData generateBox();
+
+// Cylinder of radius 1 from y = 0 to y = 1 with the first segment centered on +Z
+// Side texture coordinates run from u = 0 to uRepeat around the circumference
+MeshData generateCylinder(int segments, float uRepeat = 1.0f, bool caps = true);
+
+// Cone of radius 1 from y = 0 to an apex at y = 1 with the first segment centered on +Z
+// Faceted cones give each side its own flat normal, so four segments make a square pyramid
+MeshData generateCone(int segments, float uRepeat = 1.0f, bool faceted = false, bool base = true);
+
+// Bounding box of the mesh's vertices
+MeshBounds computeBounds(const MeshData& data);
+
+// Upload mesh data into static buffers, packing the vertices into the given layout
+Mesh uploadMesh(const MeshData& data, const VertexLayout& layout = PACKED_VERTEX_LAYOUT);
+
+// Release the mesh's GL objects
+void deleteMesh(Mesh& mesh);
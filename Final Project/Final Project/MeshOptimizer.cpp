@@ -0,0 +1,301 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+using namespace std;
+
+namespace {
+	// Cache modelled while reordering, an LRU larger than the FIFO it is measured against as Forsyth suggests
+	const int FORSYTH_CACHE_SIZE = 32;
+	const float CACHE_DECAY_POWER = 1.5f;
+	const float LAST_TRIANGLE_SCORE = 0.75f;
+	const float VALENCE_BOOST_SCALE = 2.0f;
+	const float VALENCE_BOOST_POWER = 0.5f;
+
+	// Byte-wise hash and equality, so only exact duplicates merge
+	struct VertexHash {
+		size_t operator()(const MeshVertex& vertex) const {
+			const unsigned char* bytes = (const unsigned char*)&vertex;
+			uint32_t hash = 2166136261u;
+			for (size_t i = 0; i < sizeof(MeshVertex); i++)
+				hash = (hash ^ bytes[i]) * 16777619u;
+			return hash;
+		}
+	};
+
+	struct VertexEqual {
+		bool operator()(const MeshVertex& a, const MeshVertex& b) const {
+			return memcmp(&a, &b, sizeof(MeshVertex)) == 0;
+		}
+	};
+
+	void deduplicateVertices(MeshData& data) {
+		unordered_map<MeshVertex, GLuint, VertexHash, VertexEqual> unique;
+		vector<MeshVertex> vertices;
+		vector<GLuint> remap(data.vertices.size());
+
+		for (size_t i = 0; i < data.vertices.size(); i++) {
+			auto found = unique.insert(make_pair(data.vertices[i], (GLuint)vertices.size()));
+			if (found.second)
+				vertices.push_back(data.vertices[i]);
+			remap[i] = found.first->second;
+		}
+
+		for (size_t i = 0; i < data.indices.size(); i++)
+			data.indices[i] = remap[data.indices[i]];
+		data.vertices.swap(vertices);
+	}
+
+	// Forsyth's score: vertices just used or about to be finished are worth drawing next
+	float vertexScore(int cachePosition, int remainingTriangles) {
+		if (remainingTriangles == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if (cachePosition >= 0) {
+			// The last triangle's vertices score lower than the next few, so a strip does not turn back on itself
+			if (cachePosition < 3)
+				score = LAST_TRIANGLE_SCORE;
+			else
+				score = powf(1.0f - (float)(cachePosition - 3) / (FORSYTH_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+		}
+
+		return score + VALENCE_BOOST_SCALE * powf((float)remainingTriangles, -VALENCE_BOOST_POWER);
+	}
+
+	// Greedily emit the triangle whose vertices score highest, rescoring only those near the cache
+	void optimizeVertexCache(MeshData& data) {
+		size_t triangleCount = data.indices.size() / 3;
+		size_t vertexCount = data.vertices.size();
+		if (triangleCount == 0)
+			return;
+
+		// Triangles using each vertex
+		vector<int> remaining(vertexCount, 0);
+		for (size_t i = 0; i < data.indices.size(); i++)
+			remaining[data.indices[i]]++;
+
+		vector<size_t> firstTriangle(vertexCount + 1, 0);
+		for (size_t v = 0; v < vertexCount; v++)
+			firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+
+		vector<GLuint> vertexTriangles(data.indices.size());
+		vector<size_t> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+		for (size_t i = 0; i < data.indices.size(); i++)
+			vertexTriangles[filled[data.indices[i]]++] = (GLuint)(i / 3);
+
+		vector<int> cachePosition(vertexCount, -1);
+		vector<float> score(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++)
+			score[v] = vertexScore(-1, remaining[v]);
+
+		vector<float> triangleScore(triangleCount);
+		vector<bool> emitted(triangleCount, false);
+		for (size_t t = 0; t < triangleCount; t++)
+			triangleScore[t] = score[data.indices[t * 3]] + score[data.indices[t * 3 + 1]] + score[data.indices[t * 3 + 2]];
+
+		vector<GLuint> cache, nextCache;
+		vector<GLuint> indices;
+		indices.reserve(data.indices.size());
+		size_t scan = 0;
+
+		for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+			// Best triangle touching the cache, or the next one not drawn when the cache has nothing left to offer
+			size_t best = triangleCount;
+			for (size_t i = 0; i < cache.size(); i++) {
+				GLuint v = cache[i];
+				for (size_t j = firstTriangle[v]; j < firstTriangle[v + 1]; j++) {
+					GLuint t = vertexTriangles[j];
+					if (!emitted[t] && (best == triangleCount || triangleScore[t] > triangleScore[best]))
+						best = t;
+				}
+			}
+
+			if (best == triangleCount) {
+				while (emitted[scan])
+					scan++;
+				best = scan;
+			}
+
+			emitted[best] = true;
+			const GLuint* triangle = &data.indices[best * 3];
+
+			// The triangle's vertices move to the front; the rest shift back and the oldest fall out
+			nextCache.assign(triangle, triangle + 3);
+			for (size_t i = 0; i < cache.size(); i++) {
+				if (cache[i] != triangle[0] && cache[i] != triangle[1] && cache[i] != triangle[2])
+					nextCache.push_back(cache[i]);
+			}
+
+			for (int i = 0; i < 3; i++) {
+				indices.push_back(triangle[i]);
+				remaining[triangle[i]]--;
+			}
+
+			for (size_t i = 0; i < nextCache.size(); i++) {
+				GLuint v = nextCache[i];
+				cachePosition[v] = i < FORSYTH_CACHE_SIZE ? (int)i : -1;
+				score[v] = vertexScore(cachePosition[v], remaining[v]);
+			}
+
+			// Rescore the triangles around every vertex whose score changed
+			for (size_t i = 0; i < nextCache.size(); i++) {
+				GLuint v = nextCache[i];
+				for (size_t j = firstTriangle[v]; j < firstTriangle[v + 1]; j++) {
+					GLuint t = vertexTriangles[j];
+					if (!emitted[t])
+						triangleScore[t] = score[data.indices[t * 3]] + score[data.indices[t * 3 + 1]] + score[data.indices[t * 3 + 2]];
+				}
+			}
+
+			if (nextCache.size() > FORSYTH_CACHE_SIZE)
+				nextCache.resize(FORSYTH_CACHE_SIZE);
+			cache.swap(nextCache);
+		}
+
+		data.indices.swap(indices);
+	}
+
+	// Split the cache-ordered triangles where the cache starts cold and sort the runs so those facing away from the
+	// mesh's center come first; they tend to hide the inner ones, which then fail the depth test
+	void optimizeOverdraw(MeshData& data) {
+		size_t triangleCount = data.indices.size() / 3;
+		if (triangleCount == 0)
+			return;
+
+		// A triangle that misses on all three vertices shares nothing with the run before it, so runs can move freely
+		vector<size_t> runStarts;
+		vector<unsigned> cacheTime(data.vertices.size(), 0);
+		unsigned time = VERTEX_CACHE_SIZE + 1;
+
+		for (size_t t = 0; t < triangleCount; t++) {
+			int misses = 0;
+			for (int i = 0; i < 3; i++) {
+				GLuint v = data.indices[t * 3 + i];
+				if (time - cacheTime[v] > (unsigned)VERTEX_CACHE_SIZE) {
+					cacheTime[v] = time++;
+					misses++;
+				}
+			}
+
+			if (misses == 3 || t == 0)
+				runStarts.push_back(t);
+		}
+		runStarts.push_back(triangleCount);
+
+		// Area-weighted centroid and facing of each run
+		struct Run {
+			size_t first, count;
+			glm::vec3 centroid, normal;
+			float area;
+			float key;
+		};
+
+		vector<Run> runs;
+		glm::vec3 meshCentroid(0.0f);
+		float meshArea = 0.0f;
+
+		for (size_t r = 0; r + 1 < runStarts.size(); r++) {
+			Run run;
+			run.first = runStarts[r];
+			run.count = runStarts[r + 1] - runStarts[r];
+			run.centroid = run.normal = glm::vec3(0.0f);
+			run.area = 0.0f;
+
+			for (size_t t = run.first; t < run.first + run.count; t++) {
+				const glm::vec3& a = data.vertices[data.indices[t * 3]].position;
+				const glm::vec3& b = data.vertices[data.indices[t * 3 + 1]].position;
+				const glm::vec3& c = data.vertices[data.indices[t * 3 + 2]].position;
+				glm::vec3 normal = glm::cross(b - a, c - a);
+				float area = glm::length(normal) * 0.5f;
+
+				run.centroid += (a + b + c) * (area / 3.0f);
+				run.normal += normal;
+				run.area += area;
+			}
+
+			meshCentroid += run.centroid;
+			meshArea += run.area;
+			if (run.area > 0.0f)
+				run.centroid /= run.area;
+			runs.push_back(run);
+		}
+
+		if (meshArea > 0.0f)
+			meshCentroid /= meshArea;
+
+		for (size_t r = 0; r < runs.size(); r++) {
+			float length = glm::length(runs[r].normal);
+			runs[r].key = length > 0.0f ? glm::dot(runs[r].centroid - meshCentroid, runs[r].normal / length) : 0.0f;
+		}
+
+		stable_sort(runs.begin(), runs.end(), [](const Run& a, const Run& b) { return a.key > b.key; });
+
+		vector<GLuint> indices;
+		indices.reserve(data.indices.size());
+		for (size_t r = 0; r < runs.size(); r++)
+			indices.insert(indices.end(), data.indices.begin() + runs[r].first * 3, data.indices.begin() + (runs[r].first + runs[r].count) * 3);
+		data.indices.swap(indices);
+	}
+
+	// Number vertices in the order the index buffer first reaches them, dropping any it never uses
+	void optimizeVertexFetch(MeshData& data) {
+		const GLuint UNUSED = 0xFFFFFFFFu;
+		vector<GLuint> remap(data.vertices.size(), UNUSED);
+		vector<MeshVertex> vertices;
+		vertices.reserve(data.vertices.size());
+
+		for (size_t i = 0; i < data.indices.size(); i++) {
+			GLuint& index = data.indices[i];
+			if (remap[index] == UNUSED) {
+				remap[index] = (GLuint)vertices.size();
+				vertices.push_back(data.vertices[index]);
+			}
+			index = remap[index];
+		}
+
+		data.vertices.swap(vertices);
+	}
+}
+
+VertexCacheStats analyzeVertexCache(const MeshData& data, int cacheSize) {
+	VertexCacheStats stats = {};
+	if (data.indices.empty() || data.vertices.empty())
+		return stats;
+
+	// A vertex is still cached if fewer than cacheSize misses happened since it was loaded
+	vector<unsigned> cacheTime(data.vertices.size(), 0);
+	unsigned time = cacheSize + 1;
+	size_t misses = 0;
+
+	for (size_t i = 0; i < data.indices.size(); i++) {
+		GLuint v = data.indices[i];
+		if (time - cacheTime[v] > (unsigned)cacheSize) {
+			cacheTime[v] = time++;
+			misses++;
+		}
+	}
+
+	stats.acmr = (float)misses / (data.indices.size() / 3);
+	stats.atvr = (float)misses / data.vertices.size();
+	return stats;
+}
+
+MeshOptimizeReport optimizeMesh(MeshData& data) {
+	MeshOptimizeReport report;
+	report.verticesBefore = data.vertices.size();
+	report.before = analyzeVertexCache(data);
+
+	deduplicateVertices(data);
+	optimizeVertexCache(data);
+	optimizeOverdraw(data);
+	optimizeVertexFetch(data);
+
+	report.verticesAfter = data.vertices.size();
+	report.after = analyzeVertexCache(data);
+	return report;
+}
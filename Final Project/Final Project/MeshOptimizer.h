@@ -0,0 +1,27 @@
+#pragma once
+
+#include "MeshGenerator.h"
+
+#include <cstddef>
+
+// Entries in the simulated post-transform cache, a FIFO like most hardware
+const int VERTEX_CACHE_SIZE = 16;
+
+// How often the vertex shader runs for an index buffer
+struct VertexCacheStats {
+	float acmr; // Average cache miss ratio: vertices transformed per triangle, 3 at worst
+	float atvr; // Average transformed vertex ratio: vertices transformed per vertex, 1 at best
+};
+
+// Vertex counts and cache efficiency before and after optimizeMesh
+struct MeshOptimizeReport {
+	size_t verticesBefore, verticesAfter;
+	VertexCacheStats before, after;
+};
+
+// Simulate drawing the mesh through a FIFO cache of cacheSize entries
+VertexCacheStats analyzeVertexCache(const MeshData& data, int cacheSize = VERTEX_CACHE_SIZE);
+
+// Merge identical vertices, reorder triangles for the vertex cache (Forsyth), order runs of triangles from the outside in
+// to cut overdraw, then renumber vertices in the order they are first used so fetches walk the buffer forwards
+MeshOptimizeReport optimizeMesh(MeshData& data);
@@ -0,0 +1,83 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+	// Stands for "nothing known to be bound"
+	const GLuint UNKNOWN = 0xFFFFFFFF;
+
+	bool byKey(const RenderPacket& a, const RenderPacket& b) {
+		return a.key < b.key;
+	}
+}
+
+uint64_t makeSortKey(uint32_t program, uint32_t vertexArray, uint32_t texture, uint32_t material, float depth) {
+	// Non-negative floats order the same as their bit patterns; drop the lowest mantissa bits
+	float clamped = max(depth, 0.0f);
+	uint32_t depthBits;
+	memcpy(&depthBits, &clamped, sizeof(depthBits));
+
+	return (uint64_t)(program & 0xF) << 60
+		| (uint64_t)(vertexArray & 0xFF) << 52
+		| (uint64_t)(texture & 0xFFF) << 40
+		| (uint64_t)(material & 0xFFF) << 28
+		| (depthBits >> 4);
+}
+
+void RenderQueue::sort() {
+	stable_sort(packets.begin(), packets.end(), byKey);
+}
+
+RenderStateCache::RenderStateCache() {
+	invalidate();
+	resetStats();
+}
+
+void RenderStateCache::invalidate() {
+	program = UNKNOWN;
+	vertexArray = UNKNOWN;
+	for (int i = 0; i < UNITS; i++) {
+		targets[i] = 0;
+		textures[i] = UNKNOWN;
+	}
+}
+
+void RenderStateCache::resetStats() {
+	changes.programs = changes.vertexArrays = changes.textures = 0;
+}
+
+void RenderStateCache::useProgram(GLuint id) {
+	if (id == program)
+		return;
+
+	glUseProgram(id);
+	program = id;
+	changes.programs++;
+}
+
+void RenderStateCache::bindVertexArray(GLuint id) {
+	if (id == vertexArray)
+		return;
+
+	glBindVertexArray(id);
+	vertexArray = id;
+	changes.vertexArrays++;
+}
+
+void RenderStateCache::bindTexture(GLuint unit, GLenum target, GLuint id) {
+	if (unit < UNITS && targets[unit] == target && textures[unit] == id)
+		return;
+
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(target, id);
+	glActiveTexture(GL_TEXTURE0);
+
+	if (unit < UNITS) {
+		targets[unit] = target;
+		textures[unit] = id;
+	}
+	changes.textures++;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <GLEW/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Sort key with the most expensive state in the highest bits: program (4), VAO (8), texture (12), material (12)
+// The low 28 bits hold the view depth so draws sharing all state run front to back
+// Fields are small ranks assigned by the caller, not GL object names
+uint64_t makeSortKey(uint32_t program, uint32_t vertexArray, uint32_t texture, uint32_t material, float depth);
+
+// Everything needed to issue one draw call
+struct RenderPacket {
+	uint64_t key;
+	GLuint program;
+	GLuint vertexArray;
+	GLenum textureTarget; // GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY
+	GLuint texture; // 0 for untextured draws
+	int material; // Caller's index of the color and texture mode written with the draw's uniforms
+	int object; // Caller's index of the object drawn, -1 for none
+	GLenum indexType;
+	GLsizei indexCount;
+	size_t indexOffset; // Byte offset into the index buffer
+};
+
+// Draw packets collected over a frame and sorted by key before submission
+class RenderQueue {
+public:
+	void clear() { packets.clear(); }
+	void push(const RenderPacket& packet) { packets.push_back(packet); }
+
+	// Order by key, keeping push order between equal keys
+	void sort();
+
+	size_t size() const { return packets.size(); }
+	const RenderPacket& operator[](size_t i) const { return packets[i]; }
+
+private:
+	std::vector<RenderPacket> packets;
+};
+
+// State changes issued during a frame
+struct StateChangeStats {
+	GLuint programs;
+	GLuint vertexArrays;
+	GLuint textures;
+
+	GLuint total() const { return programs + vertexArrays + textures; }
+};
+
+// Binds GL state only when it differs from what is bound and counts each change
+class RenderStateCache {
+public:
+	RenderStateCache();
+
+	// Forget the bound state, e.g. after code that binds without the cache, and zero the counts when starting a frame
+	void invalidate();
+	void resetStats();
+
+	void useProgram(GLuint program);
+	void bindVertexArray(GLuint vertexArray);
+	void bindTexture(GLuint unit, GLenum target, GLuint texture);
+
+	const StateChangeStats& stats() const { return changes; }
+
+private:
+	static const int UNITS = 2;
+
+	GLuint program;
+	GLuint vertexArray;
+	GLenum targets[UNITS];
+	GLuint textures[UNITS];
+
+	StateChangeStats changes;
+};
@@ -0,0 +1,469 @@
+#include "SceneFile.h"
+
+#include "MappedFile.h"
+
+#include <glm/glm/glm.hpp>
+#include <glm/glm/gtc/matrix_transform.hpp>
+#include <glm/glm/gtc/type_ptr.hpp>
+
+#include <sys/stat.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+
+using namespace std;
+
+static const char SCENE_MAGIC[4] = { 'S', 'C', 'N', 'B' };
+static const uint32_t SCENE_VERSION = 3;
+
+// Compiled scenes are the header followed by the string table (padded to 4 bytes) and each record
+// array in declaration order, in native byte order
+struct SceneBinaryHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t stringBytes;
+	uint32_t textureCount;
+	uint32_t materialCount;
+	uint32_t meshCount;
+	uint32_t nodeCount;
+	uint32_t objectCount;
+	uint32_t lightCount;
+};
+
+typedef unordered_map<string, uint32_t> NameTable;
+
+static bool toFloat(const string& token, float& value) {
+	char* end;
+	value = strtof(token.c_str(), &end);
+	return end != token.c_str() && *end == '\0';
+}
+
+static bool toInt(const string& token, int& value) {
+	char* end;
+	value = (int)strtol(token.c_str(), &end, 10);
+	return end != token.c_str() && *end == '\0';
+}
+
+// Read count floats starting at tokens[first]
+static bool toFloats(const vector<string>& tokens, size_t first, size_t count, float* values) {
+	if (first + count > tokens.size())
+		return false;
+
+	for (size_t i = 0; i < count; i++) {
+		if (!toFloat(tokens[first + i], values[i]))
+			return false;
+	}
+	return true;
+}
+
+static uint32_t addString(SceneDescription& scene, const string& text) {
+	uint32_t offset = (uint32_t)scene.strings.size();
+	scene.strings.insert(scene.strings.end(), text.begin(), text.end());
+	scene.strings.push_back('\0');
+	return offset;
+}
+
+// Register a new name, returning an error message if it is already taken
+static string addName(NameTable& names, const string& kind, const string& name, uint32_t index) {
+	if (!names.insert(make_pair(name, index)).second)
+		return kind + " '" + name + "' is already defined";
+	return "";
+}
+
+static string findName(const NameTable& names, const string& kind, const string& name, uint32_t& index) {
+	NameTable::const_iterator found = names.find(name);
+	if (found == names.end())
+		return "unknown " + kind + " '" + name + "'";
+
+	index = found->second;
+	return "";
+}
+
+// Parent node name, or "-" for the root
+static string findParent(const NameTable& nodes, const string& name, int32_t& parent) {
+	if (name == "-") {
+		parent = -1;
+		return "";
+	}
+
+	uint32_t index;
+	string problem = findName(nodes, "node", name, index);
+	parent = (int32_t)index;
+	return problem;
+}
+
+// Compose translate/rotate/scale operations left to right, the same way chained glm calls do
+static string parseTransform(const vector<string>& tokens, size_t first, float* local) {
+	glm::mat4 matrix = glm::mat4(1.0f);
+
+	for (size_t i = first; i < tokens.size();) {
+		const string& operation = tokens[i];
+		float values[4];
+
+		if (operation == "translate" && toFloats(tokens, i + 1, 3, values)) {
+			matrix = glm::translate(matrix, glm::vec3(values[0], values[1], values[2]));
+			i += 4;
+		}
+		else if (operation == "rotate" && toFloats(tokens, i + 1, 4, values)) {
+			matrix = glm::rotate(matrix, glm::radians(values[0]), glm::vec3(values[1], values[2], values[3]));
+			i += 5;
+		}
+		else if (operation == "scale" && toFloats(tokens, i + 1, 3, values)) {
+			matrix = glm::scale(matrix, glm::vec3(values[0], values[1], values[2]));
+			i += 4;
+		}
+		else {
+			return "bad transform at '" + operation + "'";
+		}
+	}
+
+	memcpy(local, glm::value_ptr(matrix), sizeof(float) * 16);
+	return "";
+}
+
+static string parseMesh(const vector<string>& tokens, SceneMeshRecord& mesh) {
+	const string& type = tokens[2];
+	size_t next = 3;
+
+	mesh.segments = 1;
+	mesh.uRepeat = 1.0f;
+	mesh.flags = 0;
+
+	if (type == "plane")
+		mesh.type = SCENE_MESH_PLANE;
+	else if (type == "box")
+		mesh.type = SCENE_MESH_BOX;
+	else if (type == "cylinder")
+		mesh.type = SCENE_MESH_CYLINDER;
+	else if (type == "cone")
+		mesh.type = SCENE_MESH_CONE;
+	else
+		return "unknown mesh type '" + type + "'";
+
+	// Planes take an optional division count; cylinders and cones need a segment count and may repeat u
+	if (mesh.type == SCENE_MESH_PLANE) {
+		if (next < tokens.size() && !toInt(tokens[next++], mesh.segments))
+			return "bad plane divisions";
+	}
+	else if (mesh.type != SCENE_MESH_BOX) {
+		if (next >= tokens.size() || !toInt(tokens[next++], mesh.segments))
+			return "missing segment count";
+		if (next < tokens.size() && toFloat(tokens[next], mesh.uRepeat))
+			next++;
+	}
+
+	for (; next < tokens.size(); next++) {
+		if (tokens[next] == "faceted" && mesh.type == SCENE_MESH_CONE)
+			mesh.flags |= SCENE_MESH_FACETED;
+		else if (tokens[next] == "nocaps" && mesh.type == SCENE_MESH_CYLINDER)
+			mesh.flags |= SCENE_MESH_NO_CAPS;
+		else if (tokens[next] == "nobase" && mesh.type == SCENE_MESH_CONE)
+			mesh.flags |= SCENE_MESH_NO_CAPS;
+		else
+			return "unexpected '" + tokens[next] + "'";
+	}
+
+	return "";
+}
+
+// Check every cross reference so a damaged compiled file cannot index out of range
+static bool validateScene(const SceneDescription& scene) {
+	if (scene.strings.empty() || scene.strings.back() != '\0')
+		return false;
+
+	for (size_t i = 0; i < scene.textures.size(); i++) {
+		if (scene.textures[i].path >= scene.strings.size())
+			return false;
+	}
+	for (size_t i = 0; i < scene.materials.size(); i++) {
+		if (scene.materials[i].texture >= scene.textures.size())
+			return false;
+	}
+	for (size_t i = 0; i < scene.nodes.size(); i++) {
+		// Parents precede their children; -1 marks a root
+		if (scene.nodes[i].parent < -1 || scene.nodes[i].parent >= (int32_t)i)
+			return false;
+		if (scene.nodes[i].name != SCENE_UNNAMED && scene.nodes[i].name >= scene.strings.size())
+			return false;
+	}
+	for (size_t i = 0; i < scene.objects.size(); i++) {
+		const SceneObjectRecord& object = scene.objects[i];
+		if (object.node >= scene.nodes.size() || object.mesh >= scene.meshes.size() || object.material >= scene.materials.size())
+			return false;
+	}
+	return true;
+}
+
+static bool compiledSceneIsCurrent(const string& path, const string& compiled) {
+	struct stat textInfo, compiledInfo;
+	if (stat(compiled.c_str(), &compiledInfo) != 0)
+		return false;
+
+	// A compiled scene shipped without its text is always current
+	if (stat(path.c_str(), &textInfo) != 0)
+		return true;
+
+	return compiledInfo.st_mtime >= textInfo.st_mtime;
+}
+
+template <typename T>
+static const unsigned char* readRecords(const unsigned char* cursor, uint32_t count, vector<T>& records) {
+	records.resize(count);
+	if (count > 0)
+		memcpy(records.data(), cursor, count * sizeof(T));
+	return cursor + count * sizeof(T);
+}
+
+template <typename T>
+static void writeRecords(ofstream& file, const vector<T>& records) {
+	if (!records.empty())
+		file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(T));
+}
+
+string compiledScenePath(const string& path) {
+	size_t dot = path.find_last_of('.');
+	size_t slash = path.find_last_of("/\\");
+	if (dot == string::npos || (slash != string::npos && dot < slash))
+		return path + ".sceneb";
+	return path.substr(0, dot) + ".sceneb";
+}
+
+bool parseSceneText(const string& path, SceneDescription& scene, string& error) {
+	ifstream file(path);
+	if (!file) {
+		error = path + ": cannot open file";
+		return false;
+	}
+
+	scene = SceneDescription();
+	NameTable textureNames, materialNames, meshNames, nodeNames;
+
+	string line;
+	int lineNumber = 0;
+	while (getline(file, line)) {
+		lineNumber++;
+
+		size_t comment = line.find('#');
+		if (comment != string::npos)
+			line.erase(comment);
+
+		vector<string> tokens;
+		istringstream words(line);
+		string word;
+		while (words >> word)
+			tokens.push_back(word);
+
+		if (tokens.empty())
+			continue;
+
+		const string& keyword = tokens[0];
+		string problem;
+
+		if (keyword == "texture" && (tokens.size() == 3 || (tokens.size() == 4 && tokens[3] == "rgba"))) {
+			SceneTextureRecord texture;
+			texture.path = addString(scene, tokens[2]);
+			texture.layers = 0;
+			texture.channels = tokens.size() == 4 ? 4 : 3;
+
+			problem = addName(textureNames, "texture", tokens[1], (uint32_t)scene.textures.size());
+			scene.textures.push_back(texture);
+		}
+		else if (keyword == "texture_array" && tokens.size() == 4) {
+			SceneTextureRecord texture;
+			int layers = 0;
+			texture.path = addString(scene, tokens[2]);
+			texture.channels = 3;
+
+			if (!toInt(tokens[3], layers) || layers < 1)
+				problem = "bad layer count";
+			texture.layers = (uint32_t)layers;
+
+			if (problem.empty())
+				problem = addName(textureNames, "texture", tokens[1], (uint32_t)scene.textures.size());
+			scene.textures.push_back(texture);
+		}
+		else if (keyword == "material" && tokens.size() == 6) {
+			SceneMaterialRecord material;
+			problem = findName(textureNames, "texture", tokens[2], material.texture);
+			if (problem.empty() && !toFloats(tokens, 3, 3, material.color))
+				problem = "bad material color";
+
+			if (problem.empty())
+				problem = addName(materialNames, "material", tokens[1], (uint32_t)scene.materials.size());
+			scene.materials.push_back(material);
+		}
+		else if (keyword == "mesh" && tokens.size() >= 3) {
+			SceneMeshRecord mesh;
+			problem = parseMesh(tokens, mesh);
+
+			if (problem.empty())
+				problem = addName(meshNames, "mesh", tokens[1], (uint32_t)scene.meshes.size());
+			scene.meshes.push_back(mesh);
+		}
+		else if (keyword == "node" && tokens.size() >= 3) {
+			SceneNodeRecord node;
+			problem = findParent(nodeNames, tokens[2], node.parent);
+			if (problem.empty())
+				problem = parseTransform(tokens, 3, node.local);
+
+			if (problem.empty())
+				problem = addName(nodeNames, "node", tokens[1], (uint32_t)scene.nodes.size());
+			node.name = addString(scene, tokens[1]);
+			scene.nodes.push_back(node);
+		}
+		else if (keyword == "object" && tokens.size() >= 4) {
+			// Each object gets its own unnamed node under its parent
+			SceneNodeRecord node;
+			SceneObjectRecord object;
+			problem = findParent(nodeNames, tokens[1], node.parent);
+			if (problem.empty())
+				problem = findName(meshNames, "mesh", tokens[2], object.mesh);
+			if (problem.empty())
+				problem = findName(materialNames, "material", tokens[3], object.material);
+			if (problem.empty())
+				problem = parseTransform(tokens, 4, node.local);
+
+			node.name = SCENE_UNNAMED;
+			object.node = (uint32_t)scene.nodes.size();
+			scene.nodes.push_back(node);
+			scene.objects.push_back(object);
+		}
+		else if (keyword == "light" && (tokens.size() == 11 || tokens.size() == 12)) {
+			SceneLightRecord light;
+			float values[11];
+			values[10] = SCENE_DEFAULT_LIGHT_RANGE;
+			if (toFloats(tokens, 1, tokens.size() - 1, values) && values[10] > 0.0f) {
+				memcpy(light.position, values, sizeof(light.position));
+				memcpy(light.color, values + 3, sizeof(light.color));
+				light.ambient = values[6];
+				light.diffuse = values[7];
+				light.specular = values[8];
+				light.shininess = values[9];
+				light.range = values[10];
+				scene.lights.push_back(light);
+			}
+			else {
+				problem = "bad light values";
+			}
+		}
+		else {
+			problem = "cannot parse '" + keyword + "' line";
+		}
+
+		if (!problem.empty()) {
+			error = path + ":" + to_string(lineNumber) + ": " + problem;
+			return false;
+		}
+	}
+
+	// Keep the string table valid for scenes without textures
+	if (scene.strings.empty())
+		scene.strings.push_back('\0');
+
+	return true;
+}
+
+bool loadSceneBinary(const string& path, SceneDescription& scene) {
+	MappedFile file;
+	if (!file.open(path) || file.size() < sizeof(SceneBinaryHeader))
+		return false;
+
+	SceneBinaryHeader header;
+	memcpy(&header, file.data(), sizeof(header));
+	if (memcmp(header.magic, SCENE_MAGIC, sizeof(SCENE_MAGIC)) != 0 || header.version != SCENE_VERSION)
+		return false;
+
+	size_t paddedStrings = (header.stringBytes + 3) & ~3u;
+	size_t expected = sizeof(header) + paddedStrings
+		+ header.textureCount * sizeof(SceneTextureRecord)
+		+ header.materialCount * sizeof(SceneMaterialRecord)
+		+ header.meshCount * sizeof(SceneMeshRecord)
+		+ header.nodeCount * sizeof(SceneNodeRecord)
+		+ header.objectCount * sizeof(SceneObjectRecord)
+		+ header.lightCount * sizeof(SceneLightRecord);
+	if (file.size() != expected)
+		return false;
+
+	const unsigned char* cursor = file.data() + sizeof(header);
+	scene.strings.assign(cursor, cursor + header.stringBytes);
+	cursor += paddedStrings;
+
+	cursor = readRecords(cursor, header.textureCount, scene.textures);
+	cursor = readRecords(cursor, header.materialCount, scene.materials);
+	cursor = readRecords(cursor, header.meshCount, scene.meshes);
+	cursor = readRecords(cursor, header.nodeCount, scene.nodes);
+	cursor = readRecords(cursor, header.objectCount, scene.objects);
+	readRecords(cursor, header.lightCount, scene.lights);
+
+	return validateScene(scene);
+}
+
+bool saveSceneBinary(const string& path, const SceneDescription& scene) {
+	ofstream file(path, ios::binary | ios::trunc);
+	if (!file)
+		return false;
+
+	SceneBinaryHeader header;
+	memcpy(header.magic, SCENE_MAGIC, sizeof(SCENE_MAGIC));
+	header.version = SCENE_VERSION;
+	header.stringBytes = (uint32_t)scene.strings.size();
+	header.textureCount = (uint32_t)scene.textures.size();
+	header.materialCount = (uint32_t)scene.materials.size();
+	header.meshCount = (uint32_t)scene.meshes.size();
+	header.nodeCount = (uint32_t)scene.nodes.size();
+	header.objectCount = (uint32_t)scene.objects.size();
+	header.lightCount = (uint32_t)scene.lights.size();
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	const char padding[4] = { 0, 0, 0, 0 };
+	writeRecords(file, scene.strings);
+	file.write(padding, ((header.stringBytes + 3) & ~3u) - header.stringBytes);
+
+	writeRecords(file, scene.textures);
+	writeRecords(file, scene.materials);
+	writeRecords(file, scene.meshes);
+	writeRecords(file, scene.nodes);
+	writeRecords(file, scene.objects);
+	writeRecords(file, scene.lights);
+
+	return file.good();
+}
+
+bool loadScene(const string& path, SceneDescription& scene) {
+	chrono::steady_clock::time_point loadStart = chrono::steady_clock::now();
+	string compiled = compiledScenePath(path);
+
+	if (compiledSceneIsCurrent(path, compiled) && loadSceneBinary(compiled, scene)) {
+		double loadMs = chrono::duration<double, milli>(chrono::steady_clock::now() - loadStart).count();
+		cout << "Loaded " << compiled << " in " << loadMs << " ms" << endl;
+		return true;
+	}
+
+	string error;
+	if (!parseSceneText(path, scene, error)) {
+		cout << error << endl;
+		return false;
+	}
+
+	double parseMs = chrono::duration<double, milli>(chrono::steady_clock::now() - loadStart).count();
+	cout << "Parsed " << path << " in " << parseMs << " ms" << endl;
+
+	// Cache the compiled form for the next run
+	if (!saveSceneBinary(compiled, scene))
+		cout << "Failed to write " << compiled << endl;
+
+	return true;
+}
+
+int findSceneNode(const SceneDescription& scene, const string& name) {
+	for (size_t i = 0; i < scene.nodes.size(); i++) {
+		if (scene.nodes[i].name != SCENE_UNNAMED && name == scene.string(scene.nodes[i].name))
+			return (int)i;
+	}
+	return -1;
+}
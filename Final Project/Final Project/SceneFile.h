@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Records are plain data so the compiled form can be copied straight out of a mapped file
+enum SceneMeshType : uint32_t {
+	SCENE_MESH_PLANE,
+	SCENE_MESH_BOX,
+	SCENE_MESH_CYLINDER,
+	SCENE_MESH_CONE
+};
+
+const uint32_t SCENE_MESH_FACETED = 0x1; // Cones: flat normal per side
+const uint32_t SCENE_MESH_NO_CAPS = 0x2; // Cylinders: no end caps, cones: no base
+
+// Image file, or a printf-style pattern numbered from 1 when layers > 0 (2D array texture)
+struct SceneTextureRecord {
+	uint32_t path; // Offset into the string table
+	uint32_t layers;
+	uint32_t channels; // 3 for RGB, 4 for RGBA
+};
+
+struct SceneMaterialRecord {
+	uint32_t texture;
+	float color[3];
+};
+
+// Parameters for the mesh generator
+struct SceneMeshRecord {
+	uint32_t type;
+	int32_t segments; // Segments around cylinders and cones, divisions of planes
+	float uRepeat;
+	uint32_t flags;
+};
+
+const uint32_t SCENE_UNNAMED = 0xffffffff; // Name of the node each object gets
+
+// Transform relative to the parent node (-1 for a root), column-major like glm
+struct SceneNodeRecord {
+	int32_t parent;
+	float local[16];
+	uint32_t name; // Offset into the string table, or SCENE_UNNAMED
+};
+
+struct SceneObjectRecord {
+	uint32_t node;
+	uint32_t mesh;
+	uint32_t material;
+};
+
+// Point light with its ambient, diffuse and specular strengths, specular exponent and the distance it reaches
+struct SceneLightRecord {
+	float position[3];
+	float color[3];
+	float ambient, diffuse, specular, shininess;
+	float range;
+};
+
+const float SCENE_DEFAULT_LIGHT_RANGE = 50.0f;
+
+// Everything needed to build a scene, in the order the records reference each other
+struct SceneDescription {
+	std::vector<char> strings;
+	std::vector<SceneTextureRecord> textures;
+	std::vector<SceneMaterialRecord> materials;
+	std::vector<SceneMeshRecord> meshes;
+	std::vector<SceneNodeRecord> nodes;
+	std::vector<SceneObjectRecord> objects;
+	std::vector<SceneLightRecord> lights;
+
+	const char* string(uint32_t offset) const { return &strings[offset]; }
+};
+
+// Path of the compiled scene for a text scene (foo.scene -> foo.sceneb)
+std::string compiledScenePath(const std::string& path);
+
+// Parse the text format; on failure error holds "file:line: message"
+bool parseSceneText(const std::string& path, SceneDescription& scene, std::string& error);
+
+// Read or write the compiled binary form
+bool loadSceneBinary(const std::string& path, SceneDescription& scene);
+bool saveSceneBinary(const std::string& path, const SceneDescription& scene);
+
+// Load a text scene through its compiled form, recompiling when the text is newer
+bool loadScene(const std::string& path, SceneDescription& scene);
+
+// Index of the node declared with this name, or -1
+int findSceneNode(const SceneDescription& scene, const std::string& name);
@@ -0,0 +1,44 @@
+#include "SceneGraph.h"
+
+using namespace std;
+
+int SceneGraph::createNode(int parent, const glm::mat4& local) {
+	Node node;
+	node.parent = parent;
+	node.local = local;
+	node.world = glm::mat4(1.0f);
+	node.normal = glm::mat3(1.0f);
+	node.dirty = true;
+	node.changed = false;
+
+	nodes.push_back(node);
+	return (int)nodes.size() - 1;
+}
+
+void SceneGraph::setLocal(int node, const glm::mat4& local) {
+	if (nodes[node].local == local)
+		return;
+
+	nodes[node].local = local;
+	nodes[node].dirty = true;
+}
+
+int SceneGraph::update() {
+	int updated = 0;
+
+	for (size_t i = 0; i < nodes.size(); i++) {
+		Node& node = nodes[i];
+		bool parentChanged = node.parent >= 0 && nodes[node.parent].changed;
+
+		node.changed = node.dirty || parentChanged;
+		if (!node.changed)
+			continue;
+
+		node.world = node.parent >= 0 ? nodes[node.parent].world * node.local : node.local;
+		node.normal = glm::transpose(glm::inverse(glm::mat3(node.world)));
+		node.dirty = false;
+		updated++;
+	}
+
+	return updated;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glm/glm/glm.hpp>
+
+#include <vector>
+
+// Flat parent/child transform hierarchy with cached world and normal matrices
+// Nodes are stored in creation order, so a parent is always updated before its children
+class SceneGraph {
+public:
+	// Add a node below parent (-1 for a root) and return its index
+	int createNode(int parent = -1, const glm::mat4& local = glm::mat4(1.0f));
+
+	// Replace a node's transform relative to its parent; marks it dirty if the matrix changed
+	void setLocal(int node, const glm::mat4& local);
+
+	// Recompute world and normal matrices of dirty nodes and their descendants
+	// Returns the number of nodes recomputed
+	int update();
+
+	const glm::mat4& local(int node) const { return nodes[node].local; }
+	const glm::mat4& world(int node) const { return nodes[node].world; }
+
+	// Inverse transpose of the world matrix's upper 3x3, for transforming normals
+	const glm::mat3& normalMatrix(int node) const { return nodes[node].normal; }
+
+	int parent(int node) const { return nodes[node].parent; }
+	int size() const { return (int)nodes.size(); }
+
+private:
+	struct Node {
+		int parent;
+		glm::mat4 local;
+		glm::mat4 world;
+		glm::mat3 normal;
+		bool dirty;   // Local transform changed since the last update
+		bool changed; // World matrix was recomputed during the last update
+	};
+
+	std::vector<Node> nodes;
+};
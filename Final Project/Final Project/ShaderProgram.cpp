@@ -0,0 +1,318 @@
+#include "ShaderProgram.h"
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+namespace {
+	// Cache file layout: header, then the driver's program binary
+	const uint32_t CACHE_MAGIC = 0x43505053; // "SPPC"
+
+	struct CacheHeader {
+		uint32_t magic;
+		uint32_t format; // Driver-specific binary format from glGetProgramBinary
+		uint64_t key; // Guards against a renamed or colliding file
+	};
+
+	string cacheDirectory = "shadercache";
+	ShaderCacheStats cacheStats = {};
+
+	double elapsedMs(chrono::steady_clock::time_point start) {
+		return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	}
+
+	// 64-bit FNV-1a
+	void hashBytes(uint64_t& hash, const void* data, size_t size) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++) {
+			hash ^= bytes[i];
+			hash *= 0x100000001b3ull;
+		}
+	}
+
+	void hashString(uint64_t& hash, const char* text) {
+		// Include the terminator so "ab" + "c" and "a" + "bc" hash differently
+		hashBytes(hash, text != nullptr ? text : "", text != nullptr ? strlen(text) + 1 : 1);
+	}
+
+	// Binaries are only valid for the driver that produced them
+	uint64_t programKey(const GLenum* types, const string* sources, int count) {
+		uint64_t hash = 0xcbf29ce484222325ull;
+		hashString(hash, reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+		hashString(hash, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+		hashString(hash, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+		for (int i = 0; i < count; i++) {
+			hashBytes(hash, &types[i], sizeof(types[i]));
+			hashString(hash, sources[i].c_str());
+		}
+		return hash;
+	}
+
+	// Key as 16 hex digits, the name of its cache file and how logs refer to the program
+	string keyName(uint64_t key) {
+		ostringstream name;
+		name << hex << setw(16) << setfill('0') << key;
+		return name.str();
+	}
+
+	string cachePath(uint64_t key) {
+		return cacheDirectory + "/" + keyName(key) + ".bin";
+	}
+
+	void makeDirectory(const string& path) {
+#ifdef _WIN32
+		_mkdir(path.c_str());
+#else
+		mkdir(path.c_str(), 0755);
+#endif
+	}
+
+	const char* stageName(GLenum type) {
+		switch (type) {
+		case GL_VERTEX_SHADER: return "vertex";
+		case GL_FRAGMENT_SHADER: return "fragment";
+		case GL_COMPUTE_SHADER: return "compute";
+		default: return "unknown";
+		}
+	}
+
+	// Create and compile shaders, reporting errors and warnings with the program's cache key
+	GLuint compileShader(const string& source, GLenum type, uint64_t key) {
+		// Create shader object
+		GLuint shaderID = glCreateShader(type);
+		const char* src = source.c_str();
+
+		// Attach source code to shader object
+		glShaderSource(shaderID, 1, &src, nullptr);
+
+		// Compile shader
+		glCompileShader(shaderID);
+
+		GLint compiled = GL_FALSE, logLength = 0;
+		glGetShaderiv(shaderID, GL_COMPILE_STATUS, &compiled);
+		glGetShaderiv(shaderID, GL_INFO_LOG_LENGTH, &logLength);
+		if (compiled != GL_TRUE || logLength > 1) {
+			vector<GLchar> log(logLength > 0 ? logLength : 1, '\0');
+			glGetShaderInfoLog(shaderID, (GLsizei)log.size(), nullptr, log.data());
+			cout << (compiled == GL_TRUE ? "Warnings in " : "Failed to compile ") << stageName(type)
+				<< " shader of program " << keyName(key) << ": " << log.data() << endl;
+		}
+
+		// Return ID of compiled shader
+		return shaderID;
+	}
+}
+
+void setShaderCacheDirectory(const string& directory) {
+	cacheDirectory = directory;
+}
+
+const ShaderCacheStats& shaderCacheStats() {
+	return cacheStats;
+}
+
+ShaderProgram::ShaderProgram(const string& vertexSource, const string& fragmentSource) {
+	const GLenum types[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	const string sources[] = { vertexSource, fragmentSource };
+	build(types, sources, 2);
+}
+
+ShaderProgram::ShaderProgram(const string& computeSource) {
+	const GLenum types[] = { GL_COMPUTE_SHADER };
+	build(types, &computeSource, 1);
+}
+
+ShaderProgram::~ShaderProgram() {
+	glDeleteProgram(program);
+}
+
+// Load the program from the cache, or compile and link it and store the result
+void ShaderProgram::build(const GLenum* types, const string* sources, int count) {
+	GLint binaryFormats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormats);
+	bool cached = !cacheDirectory.empty() && binaryFormats > 0;
+
+	uint64_t key = programKey(types, sources, count);
+	string path = cached ? cachePath(key) : string();
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	if (cached && loadBinary(path, key)) {
+		reflectUniforms();
+		cacheStats.loaded++;
+		cacheStats.loadMs += elapsedMs(start);
+		return;
+	}
+
+	start = chrono::steady_clock::now();
+
+	// Create program object
+	program = glCreateProgram();
+	if (cached)
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+	// Compile each stage and attach it to the program object
+	vector<GLuint> shaders;
+	for (int i = 0; i < count; i++) {
+		shaders.push_back(compileShader(sources[i], types[i], key));
+		glAttachShader(program, shaders.back());
+	}
+
+	bool linked = link();
+
+	// Delete compiled shaders
+	for (size_t i = 0; i < shaders.size(); i++) {
+		glDetachShader(program, shaders[i]);
+		glDeleteShader(shaders[i]);
+	}
+
+	double ms = elapsedMs(start);
+	cacheStats.compiled++;
+	cacheStats.compileMs += ms;
+	cout << "Compiled shader program " << keyName(key) << " in " << ms << " ms" << endl;
+
+	if (linked && cached)
+		saveBinary(path, key);
+}
+
+// True if the cached binary exists and the driver accepted it; program is left valid either way
+bool ShaderProgram::loadBinary(const string& path, uint64_t key) {
+	program = 0;
+
+	ifstream file(path, ios::binary | ios::ate);
+	if (!file)
+		return false;
+
+	streamoff size = file.tellg();
+	CacheHeader header;
+	if (size <= (streamoff)sizeof(header))
+		return false;
+
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (header.magic != CACHE_MAGIC || header.key != key)
+		return false;
+
+	vector<char> binary((size_t)size - sizeof(header));
+	if (!file.read(binary.data(), binary.size()))
+		return false;
+
+	program = glCreateProgram();
+	glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (linked == GL_TRUE)
+		return true;
+
+	cout << "Cached shader program " << keyName(key) << " was rejected by the driver, recompiling" << endl;
+	cacheStats.rejected++;
+	glDeleteProgram(program);
+	program = 0;
+	return false;
+}
+
+void ShaderProgram::saveBinary(const string& path, uint64_t key) const {
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	CacheHeader header = { CACHE_MAGIC, 0, key };
+	vector<char> binary(length);
+	glGetProgramBinary(program, length, nullptr, &header.format, binary.data());
+
+	makeDirectory(cacheDirectory);
+	ofstream file(path, ios::binary | ios::trunc);
+	if (!file)
+		return;
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(binary.data(), binary.size());
+}
+
+// Link program to create executable, then reflect its uniforms
+bool ShaderProgram::link() {
+	glLinkProgram(program);
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (linked != GL_TRUE) {
+		GLint logLength = 0;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
+		vector<GLchar> log(logLength > 0 ? logLength : 1, '\0');
+		glGetProgramInfoLog(program, (GLsizei)log.size(), nullptr, log.data());
+		cout << "Failed to link shader program: " << log.data() << endl;
+		return false;
+	}
+
+	reflectUniforms();
+	return true;
+}
+
+GLint ShaderProgram::uniform(const string& name) const {
+	unordered_map<string, GLint>::const_iterator found = uniforms.find(name);
+	return found == uniforms.end() ? -1 : found->second;
+}
+
+// Look up every active uniform once so the render loop never calls glGetUniformLocation
+void ShaderProgram::reflectUniforms() {
+	GLint count = 0, maxLength = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+	vector<GLchar> name(maxLength > 0 ? maxLength : 1);
+	for (GLint i = 0; i < count; i++) {
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(program, i, (GLsizei)name.size(), &length, &size, &type, name.data());
+
+		// Uniform block members have no location of their own
+		GLint location = glGetUniformLocation(program, name.data());
+		if (location < 0)
+			continue;
+
+		// Arrays are reported as "name[0]"; store them under the bare name too
+		string uniformName(name.data(), length);
+		uniforms[uniformName] = location;
+		if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+			uniforms[uniformName.substr(0, uniformName.size() - 3)] = location;
+	}
+}
+
+UniformBuffer::UniformBuffer(GLuint binding, GLsizeiptr size) : contents(size), valid(false) {
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+}
+
+UniformBuffer::~UniformBuffer() {
+	glDeleteBuffers(1, &buffer);
+}
+
+bool UniformBuffer::update(const void* data) {
+	if (valid && memcmp(contents.data(), data, contents.size()) == 0)
+		return false;
+
+	memcpy(contents.data(), data, contents.size());
+	valid = true;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, (GLsizeiptr)contents.size(), contents.data());
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	return true;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <GLEW/glew.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Linked vertex/fragment or compute program with uniform locations reflected once at link time
+// Programs are loaded from the binary cache when the driver accepts the stored blob, otherwise compiled
+class ShaderProgram {
+public:
+	ShaderProgram(const std::string& vertexSource, const std::string& fragmentSource);
+	explicit ShaderProgram(const std::string& computeSource);
+	~ShaderProgram();
+
+	GLuint id() const { return program; }
+
+	// Location of an active uniform, or -1 if the program has no such uniform
+	GLint uniform(const std::string& name) const;
+
+private:
+	ShaderProgram(const ShaderProgram&);
+	ShaderProgram& operator=(const ShaderProgram&);
+
+	void build(const GLenum* types, const std::string* sources, int count);
+	bool loadBinary(const std::string& path, uint64_t key);
+	void saveBinary(const std::string& path, uint64_t key) const;
+	bool link();
+	void reflectUniforms();
+
+	GLuint program;
+	std::unordered_map<std::string, GLint> uniforms;
+};
+
+// Programs loaded from the cache or compiled since startup, and the time each path took
+struct ShaderCacheStats {
+	int loaded;
+	int compiled;
+	int rejected; // Cached binaries the driver refused, usually after a driver update
+	double loadMs;
+	double compileMs;
+};
+
+// Directory holding one binary per program, keyed by the sources and the driver; empty disables the cache
+// Set before creating any programs
+void setShaderCacheDirectory(const std::string& directory);
+
+const ShaderCacheStats& shaderCacheStats();
+
+// Uniform buffer on a fixed binding point that is only re-uploaded when its contents change
+class UniformBuffer {
+public:
+	UniformBuffer(GLuint binding, GLsizeiptr size);
+	~UniformBuffer();
+
+	// Upload size bytes from data if they differ from the last upload; returns true if the buffer was written
+	bool update(const void* data);
+
+private:
+	UniformBuffer(const UniformBuffer&);
+	UniformBuffer& operator=(const UniformBuffer&);
+
+	GLuint buffer;
+	std::vector<unsigned char> contents;
+	bool valid;
+};
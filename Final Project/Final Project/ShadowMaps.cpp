@@ -0,0 +1,74 @@
+#include "ShadowMaps.h"
+
+#include <glm/glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+	// Light's near plane; the far plane is its range
+	const float SHADOW_NEAR_PLANE = 0.05f;
+
+	// Cube map face order with the up vectors GL expects for each face
+	const glm::vec3 FACE_DIRECTIONS[6] = {
+		glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+	};
+	const glm::vec3 FACE_UPS[6] = {
+		glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)
+	};
+}
+
+ShadowMaps::ShadowMaps(int resolution, int count) : size(resolution), dirty(count, true) {
+	// Keep at least one layer so the sampler always has a complete texture
+	int layers = max(count, 1) * 6;
+
+	glGenTextures(1, &cubeArray);
+	glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, cubeArray);
+	glTexImage3D(GL_TEXTURE_CUBE_MAP_ARRAY, 0, GL_DEPTH_COMPONENT32F, size, size, layers, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, 0);
+
+	// Depth only
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+ShadowMaps::~ShadowMaps() {
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteTextures(1, &cubeArray);
+}
+
+glm::mat4 ShadowMaps::beginFace(int map, int face, const glm::vec3& position, float range) {
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cubeArray, 0, map * 6 + face);
+
+	if (face == 0 && glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		cout << "Shadow map framebuffer is incomplete" << endl;
+
+	glViewport(0, 0, size, size);
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, SHADOW_NEAR_PLANE, range);
+	glm::mat4 view = glm::lookAt(position, position + FACE_DIRECTIONS[face], FACE_UPS[face]);
+	return projection * view;
+}
+
+void ShadowMaps::endMap(int map) {
+	dirty[map] = false;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <GLEW/glew.h>
+
+#include <glm/glm/glm.hpp>
+
+#include <vector>
+
+// Depth cube maps for point lights in one cube map array, each kept until its light or a caster in its range moves
+// Depth holds the distance from the light divided by its range
+class ShadowMaps {
+public:
+	ShadowMaps(int resolution, int count);
+	~ShadowMaps();
+
+	int count() const { return (int)dirty.size(); }
+	int resolution() const { return size; }
+
+	// GL_TEXTURE_CUBE_MAP_ARRAY with depth comparison enabled, for samplerCubeArrayShadow
+	GLuint texture() const { return cubeArray; }
+
+	void invalidate(int map) { dirty[map] = true; }
+	bool needsUpdate(int map) const { return dirty[map]; }
+
+	// Attach one face of a map to the shadow framebuffer and clear it; returns the face's view-projection matrix
+	glm::mat4 beginFace(int map, int face, const glm::vec3& position, float range);
+
+	// Mark a map as current and restore the default framebuffer
+	void endMap(int map);
+
+private:
+	ShadowMaps(const ShadowMaps&);
+	ShadowMaps& operator=(const ShadowMaps&);
+
+	GLuint fbo;
+	GLuint cubeArray;
+	int size;
+	std::vector<bool> dirty;
+};
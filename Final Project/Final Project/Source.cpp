@@ -1,6 +1,18 @@
-#include <GLEW\glew.h>
-#include <GLFW\glfw3.h>
+#include <GLEW/glew.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 // GLM Library
 #include <glm/glm/glm.hpp>
@@ -9,6 +21,27 @@
 
 #include <SOIL2/SOIL2.h>
 
+#include "Benchmark.h"
+#include "CameraPath.h"
+#include "ClusteredLighting.h"
+#include "FrameProfiler.h"
+#include "FrustumCulling.h"
+#include "GBuffer.h"
+#include "GltfModel.h"
+#include "HeadlessContext.h"
+#include "IndirectDraw.h"
+#include "MeshGenerator.h"
+#include "MeshOptimizer.h"
+#include "RenderQueue.h"
+#include "SceneFile.h"
+#include "SceneGraph.h"
+#include "ShadowMaps.h"
+#include "ShaderProgram.h"
+#include "StaticBatch.h"
+#include "StreamBuffer.h"
+#include "TextOverlay.h"
+#include "TextureLoader.h"
+
 using namespace std;
 
 int width, height;
@@ -35,6 +68,12 @@ glm::mat4 getProjection();
 // Reset camera function prototype
 void resetCamera();
 
+// Point the camera along rawYaw and rawPitch
+void aimCamera();
+
+// Seconds since startup, with or without GLFW
+double secondsSinceStart();
+
 // Define Camera Attributes
 glm::vec3 cameraPos = glm::vec3(0.0f, 3.0f, 12.0f);
 glm::vec3 cameraTarget = glm::vec3(0.0f, 0.0f, 0.0f);
@@ -61,486 +100,573 @@ bool firstMouseMove = true;
 // Define camera speed
 GLfloat speedModifier = 10.0f;
 
-// Light Source Position
-glm::vec3 lightPosition1(0.0f, 6.0f, 3.0f);
-glm::vec3 lightPosition2(6.0f, 6.0f, -5.0f);
-glm::vec3 lightPosition3(-6.0f, 6.0f, 0.0f);
+// Near and far clip planes of both projections
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 100.0f;
+
+// Per-frame uniforms shared by every shader program (std140 layout of the FrameData block)
+struct FrameUniforms {
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 inverseProjection;
+	glm::mat4 inverseView;
+	glm::vec4 viewPos;
+	glm::vec4 screenSize; // Framebuffer width and height
+	glm::vec4 clusterDepth; // Near plane, far plane, and depth slices per unit of log(depth / near)
+	GLint lightCount;
+	GLint padding[3];
+};
+
+// GLSL declaration of FrameUniforms
+const string frameDataBlock =
+	"layout(std140, binding = 0) uniform FrameData {\n"
+	"mat4 view;\n"
+	"mat4 projection;\n"
+	"mat4 inverseProjection;\n"
+	"mat4 inverseView;\n"
+	"vec4 viewPos;\n"
+	"vec4 screenSize;\n"
+	"vec4 clusterDepth;\n"
+	"int lightCount;\n"
+	"};\n";
+
+// Per-draw transform and material, written to the stream buffer and bound by offset (std140 layout of the DrawUniforms block)
+struct DrawUniforms {
+	glm::mat4 model;
+	glm::vec4 normalMatrix[3]; // mat3 columns padded to vec4
+	glm::vec4 color;
+	glm::vec4 texCoordTransform; // Scale and offset decoding the mesh's texture coordinates
+	GLint useTextureArray;
+	GLint padding[3];
+};
+
+// GLSL declaration of DrawUniforms
+const string drawUniformsBlock =
+	"layout(std140, binding = 1) uniform DrawUniforms {\n"
+	"mat4 model;\n"
+	"mat3 normalMatrix;\n"
+	"vec4 objectColor;\n"
+	"vec4 texCoordTransform;\n"
+	"int useTextureArray;\n"
+	"};\n";
+
+// GLSL declaration of the light buffers LightClusters binds: every light, each cluster's range of the index list,
+// and the index list itself
+const string lightDataBlock =
+	"const uint CLUSTER_GRID_X = " + to_string(CLUSTER_GRID_X) + "u;\n"
+	"const uint CLUSTER_GRID_Y = " + to_string(CLUSTER_GRID_Y) + "u;\n"
+	"const uint CLUSTER_GRID_Z = " + to_string(CLUSTER_GRID_Z) + "u;\n"
+	"struct Light {\n"
+	"vec4 position;\n"
+	"vec4 color;\n"
+	"vec4 params;\n"
+	"int shadowMap;\n"
+	"};\n"
+	"layout(std430, binding = 2) readonly buffer LightBuffer {\n"
+	"Light lights[];\n"
+	"};\n"
+	"layout(std430, binding = 3) buffer ClusterBuffer {\n"
+	"uvec2 clusters[];\n"
+	"};\n"
+	"layout(std430, binding = 4) buffer LightIndexBuffer {\n"
+	"uint lightIndexCount;\n"
+	"uint lightIndices[];\n"
+	"};\n";
+
+// Sum of the ambient, diffuse and specular terms of the lights in the fragment's cluster
+// Shadowed lights compare the distance to the light against their cube map, biased more on surfaces at grazing angles
+const string lightingFunction =
+	"uniform samplerCubeArrayShadow shadowMaps;\n"
+	"vec3 lighting(vec3 norm, vec3 fragPos) {\n"
+	"vec3 viewDir = normalize(viewPos.xyz - fragPos);\n"
+	"// Find the cluster from the screen tile and the depth slice\n"
+	"float depth = max(-(view * vec4(fragPos, 1.0)).z, clusterDepth.x);\n"
+	"uint slice = min(uint(log(depth / clusterDepth.x) * clusterDepth.z), CLUSTER_GRID_Z - 1u);\n"
+	"uvec2 tile = min(uvec2(gl_FragCoord.xy / screenSize.xy * vec2(CLUSTER_GRID_X, CLUSTER_GRID_Y)), uvec2(CLUSTER_GRID_X - 1u, CLUSTER_GRID_Y - 1u));\n"
+	"uvec2 cluster = clusters[tile.x + tile.y * CLUSTER_GRID_X + slice * CLUSTER_GRID_X * CLUSTER_GRID_Y];\n"
+	"// Ambient, diffuse and specular with each light's own strengths, fading out at its range\n"
+	"vec3 ambient = vec3(0.0);\n"
+	"vec3 diffuse = vec3(0.0);\n"
+	"vec3 specular = vec3(0.0);\n"
+	"for (uint i = 0u; i < cluster.y; i++) {\n"
+	"Light light = lights[lightIndices[cluster.x + i]];\n"
+	"vec3 toLight = light.position.xyz - fragPos;\n"
+	"float distance = max(length(toLight), 0.0001);\n"
+	"float falloff = clamp(1.0 - pow(distance / light.position.w, 4.0), 0.0, 1.0);\n"
+	"vec3 radiance = falloff * falloff * light.color.rgb;\n"
+	"vec3 lightDir = toLight / distance;\n"
+	"vec3 reflectDir = reflect(-lightDir, norm);\n"
+	"float lit = 1.0;\n"
+	"if (light.shadowMap >= 0) {\n"
+	"float bias = 0.02 + 0.05 * (1.0 - max(dot(norm, lightDir), 0.0));\n"
+	"lit = texture(shadowMaps, vec4(-lightDir, float(light.shadowMap)), (distance - bias) / light.position.w);\n"
+	"}\n"
+	"ambient += light.params.x * radiance;\n"
+	"diffuse += lit * max(dot(norm, lightDir), 0.0) * light.params.y * radiance;\n"
+	"specular += lit * pow(max(dot(viewDir, reflectDir), 0.0), light.params.w) * light.params.z * radiance;\n"
+	"}\n"
+	"return ambient + diffuse + specular;\n"
+	"}\n";
+
+// Interpolated normal, or the face normal from the position's screen derivatives where the mesh has none
+// (glTF primitives without NORMAL read a zero normal); the derivatives are taken outside the branch
+const string surfaceNormalFunction =
+	"vec3 surfaceNormal(vec3 normal, vec3 position) {\n"
+	"vec3 faceNormal = normalize(cross(dFdx(position), dFdy(position)));\n"
+	"return dot(normal, normal) > 0.0 ? normalize(normal) : faceNormal;\n"
+	"}\n";
+
+// GLSL declaration of DrawData and the buffer IndirectDrawList::submit binds it to
+const string drawDataBlock =
+	"struct DrawData {\n"
+	"mat4 model;\n"
+	"mat3 normalMatrix;\n"
+	"vec4 color;\n"
+	"vec4 texCoordTransform;\n"
+	"int layer;\n"
+	"int arrayLayers;\n"
+	"};\n"
+	"layout(std430, binding = 1) readonly buffer DrawBuffer {\n"
+	"DrawData draws[];\n"
+	"};\n";
+
+// Texel of a draw's texture from the indirect array texture; array textures pick their layer with the coordinate's whole
+// part, clamped so it cannot reach another texture's layers
+const string drawTextureFunction =
+	"vec4 drawTexture(DrawData draw) {\n"
+	"vec2 texCoord = oTexCoord;\n"
+	"float layer = float(draw.layer);\n"
+	"if (draw.arrayLayers > 0) {\n"
+	"texCoord.x = fract(oTexCoord.x);\n"
+	"layer += clamp(floor(oTexCoord.x), 0.0, float(draw.arrayLayers - 1));\n"
+	"}\n"
+	"return textureGrad(drawTextures, vec3(texCoord, layer), dFdx(oTexCoord), dFdy(oTexCoord));\n"
+	"}\n";
+
+// Submit the scene as one glMultiDrawElementsIndirect with per-draw data in a storage buffer (--indirect, M to toggle)
+bool useIndirectDraws = false;
+bool indirectDrawsSupported = false;
+
+// Render surfaces into a G-buffer and light them in one full-screen pass (--deferred, G to toggle)
+bool deferredShading = false;
+
+// Keep each shadow map until its light or a caster in range moves (--no-shadow-cache to re-render every frame)
+bool shadowCaching = true;
+
+// Lights that cast shadows, resolution of each cube face
+const int MAX_SHADOWED_LIGHTS = 4;
+const int SHADOW_MAP_SIZE = 1024;
+
+// Lift a named scene node up and down so the shadow maps of lights in range are re-rendered as it moves (--animate-node name)
+// Its objects are drawn one by one instead of from the static batch
+string animatedNodeName;
+const float ANIMATED_NODE_LIFT = 1.0f;
+const float ANIMATED_NODE_SPEED = 2.0f; // Radians per second
+
+// Sort the render queue by state and depth before submitting (--unsorted to draw in scene order)
+bool sortDraws = true;
+
+// Extra lights orbiting over the desk (--lights N)
+int extraLights = 0;
+
+// Circle a light moves around; lights with zero speed stay where the scene put them
+struct LightOrbit {
+	glm::vec3 center;
+	float radius;
+	float speed; // Radians per second
+	float phase;
+};
+
+// Skip objects outside the view frustum (--no-culling to draw everything)
+bool frustumCulling = true;
+
+// Scene description to load (--scene path)
+string sceneFile = "desk.scene";
+
+// Override the segment count of the scene's cylinders (--cylinder-segments N)
+int cylinderSegments = 0;
+
+// Reorder generated meshes for the vertex cache and overdraw (--no-mesh-optimization to keep the generators' order)
+bool optimizeMeshes = true;
+
+// glTF or GLB files added at the root of the scene (--model path, repeatable)
+vector<string> modelFiles;
+
+// Per-frame render statistics
+struct RenderStats {
+	GLuint drawCalls;
+	GLuint uniformUpdates;
+	GLuint stateChanges; // Program, VAO and texture changes
+	GLuint culled; // Volumes outside the view frustum
+	double cullMs;
+	GLuint shadowMapsRendered;
+	double shadowMs; // CPU time spent re-rendering shadow maps
+	double shadowMsTotal; // Since startup, for the amortized cost per frame
+	GLuint frames;
+	double submitMs; // CPU time spent submitting the frame
+};
+RenderStats frameStats;
+
+// Decode textures on the main thread instead of the worker pool (--serial-textures)
+bool serialTextureLoading = false;
+
+// Load baked .dds textures when they are up to date (--no-baked-textures to always decode the .jpg)
+bool useBakedTextures = true;
+
+// Megabytes of texture memory to keep resident, 0 for no limit (--texture-budget MB)
+size_t textureBudgetMB = 0;
+
+// Print which texture levels are resident and their memory (R)
+bool textureReportRequested = false;
+
+// Time-to-first-frame has not been reported yet
+bool firstFrame = true;
+
+// Play a camera path, one pose per frame, instead of taking mouse and keyboard input (--camera-path file)
+string cameraPathFile;
+
+// Render the camera path offscreen without a window and write each frame to an image (--headless)
+bool headless = false;
+
+// Frame image files, with the frame number from 0 in place of the %d (--output pattern), and their size (--size WxH)
+string headlessOutput = "frame%d.png";
+int headlessWidth = 800, headlessHeight = 600;
+
+// Show per-zone CPU and GPU times over the frame (--profile, toggled with O)
+bool showProfiler = false;
+
+// Chrome trace written with T, and at exit when given on the command line (--trace path)
+string traceFile = "trace.json";
+bool traceOnExit = false;
+bool traceRequested = false;
+
+// Time this many frames spread evenly along the camera path with vsync off, then exit (--benchmark N)
+int benchmarkFrames = 0;
+
+// Machine-readable benchmark results (--results path)
+string benchmarkResults = "benchmark.json";
+
+// Record the camera every frame and write it as a camera path at exit (--record-path file)
+string recordPathFile;
+
+// Camera path frames advance the clock by a fixed step so moving lights are in the same place every run
+const double FIXED_FRAME_TIME = 1.0 / 60.0;
+
+// Color and texture mode written with each draw that uses the material
+struct QueueMaterial {
+	glm::vec3 color;
+	bool textureArray;
+};
+
+// Transform of a packet drawn in its own object space instead of from the world-space batch
+struct QueueObject {
+	glm::mat4 model;
+	glm::mat3 normalMatrix;
+	VertexDecode decode;
+};
+
+// glTF primitive placed by a model node
+struct ModelDraw {
+	const GltfPrimitive* primitive;
+	int node; // Scene graph node
+	int material; // Render queue material
+	GLuint texture;
+	uint32_t textureRank; // Position in the scene textures from 1, 0 for the white texture
+};
+
+// Geometry drawn into the shadow maps at its node's current transform
+struct ShadowCaster {
+	GLuint vao;
+	GLenum indexType;
+	GLsizei indexCount;
+	size_t indexOffset;
+	int node;
+	VertexDecode decode;
+	MeshBounds bounds; // In the mesh's own space
+	int volume; // Culling volume that follows the caster
+};
+
+// Per-draw uniforms for the stream buffer; written field by field since the mapped memory must not be read
+// The mesh's position decode goes in front of the model matrix; the normal matrix stays that of the model alone
+void writeDrawUniforms(DrawUniforms* uniforms, const glm::mat4& model, const glm::mat3& normalMatrix, const VertexDecode& decode, const glm::vec3& color, bool textureArray) {
+	uniforms->model = model * decode.position;
+	for (int i = 0; i < 3; i++)
+		uniforms->normalMatrix[i] = glm::vec4(normalMatrix[i], 0.0f);
+	uniforms->color = glm::vec4(color, 1.0f);
+	uniforms->texCoordTransform = decode.texCoord;
+	uniforms->useTextureArray = textureArray;
+}
 
-// Nut Texture List
-GLuint nutTexList[24];
+// Distance between records in the stream buffer so each starts at a valid binding offset
+GLsizeiptr drawUniformsStride(GLint alignment) {
+	return (sizeof(DrawUniforms) + alignment - 1) / alignment * alignment;
+}
 
-// Draw primitive(s)
-void draw(GLsizei indices) {
-	GLenum mode = GL_TRIANGLES;
+// Distance of a point in front of the camera
+float viewDepth(const glm::vec3& point) {
+	return glm::dot(point - cameraPos, cameraFront);
+}
 
-	glDrawElements(mode, indices, GL_UNSIGNED_BYTE, nullptr);
+// Uniform random number in [low, high]
+float randomRange(float low, float high) {
+	return low + (high - low) * (float)rand() / (float)RAND_MAX;
 }
 
-// Create and compile shaders
-static GLuint compileShader(const string& source, GLuint type) {
-	// Create shader object
-	GLuint shaderID = glCreateShader(type);
-	const char* src = source.c_str();
+// Draw the queue in order, binding only the state that changes between packets
+// Every packet's uniforms are written to the stream buffer up front and bound by offset per draw; packets without an object are
+// batch geometry already in world space, packed with the given decode
+void draw(const RenderQueue& queue, RenderStateCache& state, const vector<QueueMaterial>& materials, const vector<QueueObject>& objects, const VertexDecode& decode, StreamBuffer& stream, GLint uniformAlignment) {
+	GLenum mode = GL_TRIANGLES;
+
+	if (queue.size() == 0)
+		return;
 
-	// Attach source code to shader object
-	glShaderSource(shaderID, 1, &src, nullptr);
+	GLsizeiptr stride = drawUniformsStride(uniformAlignment);
+	void* data;
+	GLintptr offset = stream.allocate(stride * queue.size(), uniformAlignment, &data);
 
-	// Compile shader
-	glCompileShader(shaderID);
+	for (size_t i = 0; i < queue.size(); i++) {
+		const QueueMaterial& material = materials[queue[i].material];
+		DrawUniforms* uniforms = (DrawUniforms*)((unsigned char*)data + i * stride);
+		if (queue[i].object >= 0) {
+			const QueueObject& object = objects[queue[i].object];
+			writeDrawUniforms(uniforms, object.model, object.normalMatrix, object.decode, material.color, material.textureArray);
+		}
+		else {
+			writeDrawUniforms(uniforms, glm::mat4(1.0f), glm::mat3(1.0f), decode, material.color, material.textureArray);
+		}
+	}
 
-	// Return ID of compiled shader
-	return shaderID;
-}
+	for (size_t i = 0; i < queue.size(); i++) {
+		const RenderPacket& packet = queue[i];
 
-// Create program object
-static GLuint createShaderProgram(const string& vertexShader, const string& fragmentShader) {
-	// Compile vertex shader
-	GLuint vShader = compileShader(vertexShader, GL_VERTEX_SHADER);
+		state.useProgram(packet.program);
+		state.bindVertexArray(packet.vertexArray);
 
-	// Compile fragment shader
-	GLuint fShader = compileShader(fragmentShader, GL_FRAGMENT_SHADER);
+		// Bind Texture; array textures are sampled from unit 1
+		if (packet.texture != 0)
+			state.bindTexture(packet.textureTarget == GL_TEXTURE_2D_ARRAY ? 1 : 0, packet.textureTarget, packet.texture);
 
-	// Create program object
-	GLuint shaderProgram = glCreateProgram();
+		glBindBufferRange(GL_UNIFORM_BUFFER, 1, stream.buffer(), offset + i * stride, sizeof(DrawUniforms));
+		frameStats.uniformUpdates++;
 
-	// Attach vertex and fragment shaders to program object
-	glAttachShader(shaderProgram, vShader);
-	glAttachShader(shaderProgram, fShader);
+		// Draw primitive(s)
+		glDrawElements(mode, packet.indexCount, packet.indexType, (GLvoid*)packet.indexOffset);
 
-	// Link program to create executable
-	glLinkProgram(shaderProgram);
+		frameStats.drawCalls++;
+	}
+}
 
-	// Delete compiled vertex and fragment shaders
-	glDeleteShader(vShader);
-	glDeleteShader(fShader);
+// Running totals the profiler subtracts at the start and end of each zone
+ProfileCounters profileCounters(const RenderStateCache& state) {
+	ProfileCounters counters;
+	counters.draws = frameStats.drawCalls;
+	counters.binds = state.stats().programs + state.stats().vertexArrays + state.stats().textures;
+	counters.uniforms = frameStats.uniformUpdates;
+	return counters;
+}
 
-	// Return shader program
-	return shaderProgram;
+// Table of the zones in a resolved frame, nested zones indented under their parent
+void printProfile(TextOverlay& overlay, const ProfileFrame& frame) {
+	overlay.clear();
+	overlay.print(0, 0, "Zone              CPU ms  GPU ms  Draws  Binds  Uniforms");
+
+	for (size_t i = 0; i < frame.zones.size(); i++) {
+		const ProfileZone& zone = frame.zones[i];
+		ostringstream line;
+		line << fixed << setprecision(3) << left << setw(16) << (string(zone.depth * 2, ' ') + zone.name) << right
+			<< setw(8) << zone.cpuMs << setw(8);
+		if (zone.gpuMs >= 0.0)
+			line << zone.gpuMs;
+		else
+			line << "-";
+		line << setw(7) << zone.counters.draws << setw(7) << zone.counters.binds << setw(10) << zone.counters.uniforms;
+		overlay.print(0, (int)i + 1, line.str());
+	}
 }
 
-int main(void) {
+int main(int argc, char* argv[]) {
+	// Parse command line options
+	for (int i = 1; i < argc; i++) {
+		if (string(argv[i]) == "--serial-textures")
+			serialTextureLoading = true;
+		else if (string(argv[i]) == "--no-baked-textures")
+			useBakedTextures = false;
+		else if (string(argv[i]) == "--texture-budget" && i + 1 < argc)
+			textureBudgetMB = static_cast<size_t>(atoi(argv[++i]));
+		else if (string(argv[i]) == "--no-culling")
+			frustumCulling = false;
+		else if (string(argv[i]) == "--unsorted")
+			sortDraws = false;
+		else if (string(argv[i]) == "--no-shader-cache")
+			setShaderCacheDirectory("");
+		else if (string(argv[i]) == "--no-shadow-cache")
+			shadowCaching = false;
+		else if (string(argv[i]) == "--animate-node" && i + 1 < argc)
+			animatedNodeName = argv[++i];
+		else if (string(argv[i]) == "--deferred")
+			deferredShading = true;
+		else if (string(argv[i]) == "--indirect")
+			useIndirectDraws = true;
+		else if (string(argv[i]) == "--profile")
+			showProfiler = true;
+		else if (string(argv[i]) == "--trace" && i + 1 < argc) {
+			traceFile = argv[++i];
+			traceOnExit = true;
+		}
+		else if (string(argv[i]) == "--headless")
+			headless = true;
+		else if (string(argv[i]) == "--camera-path" && i + 1 < argc)
+			cameraPathFile = argv[++i];
+		else if (string(argv[i]) == "--benchmark" && i + 1 < argc)
+			benchmarkFrames = atoi(argv[++i]);
+		else if (string(argv[i]) == "--results" && i + 1 < argc)
+			benchmarkResults = argv[++i];
+		else if (string(argv[i]) == "--record-path" && i + 1 < argc)
+			recordPathFile = argv[++i];
+		else if (string(argv[i]) == "--output" && i + 1 < argc)
+			headlessOutput = argv[++i];
+		else if (string(argv[i]) == "--size" && i + 1 < argc)
+			sscanf(argv[++i], "%dx%d", &headlessWidth, &headlessHeight);
+		else if (string(argv[i]) == "--scene" && i + 1 < argc)
+			sceneFile = argv[++i];
+		else if (string(argv[i]) == "--lights" && i + 1 < argc)
+			extraLights = atoi(argv[++i]);
+		else if (string(argv[i]) == "--cylinder-segments" && i + 1 < argc)
+			cylinderSegments = atoi(argv[++i]);
+		else if (string(argv[i]) == "--no-mesh-optimization")
+			optimizeMeshes = false;
+		else if (string(argv[i]) == "--model" && i + 1 < argc)
+			modelFiles.push_back(argv[++i]);
+	}
+
 	width = 800;
 	height = 600;
 
-	if (!glfwInit()) { exit(EXIT_FAILURE); }
-
-	//glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	//glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-
-	GLFWwindow* window = glfwCreateWindow(width, height, "Main Window", NULL, NULL);
-
-	// Set Input Callback Functions
-	glfwSetCursorPosCallback(window, cursor_position_callback);
-	glfwSetScrollCallback(window, scroll_callback);
-	glfwSetKeyCallback(window, key_callback);
-
-	// Capture mouse for input
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-	glfwMakeContextCurrent(window);
-
-	if (glewInit() != GLEW_OK) { exit(EXIT_FAILURE); }
-
-	glfwSwapInterval(1);
-
-	// Square Vertex Data
-	GLfloat squareVertices[]{
-		-0.5f,  0.0f, -0.5f, // Vert 0
-		 0.0f,  1.0f,  0.0f, // Green
-		 0.0f,  0.0f,        // UV (BL)
-		 0.0f,  1.0f,  0.0f, // Normal: Positive Y
-
-		 0.5f,  0.0f, -0.5f, // Vert 1
-		 0.0f,  0.0f,  1.0f, // Blue
-		 1.0f,  0.0f,        // UV (BR)
-		 0.0f,  1.0f,  0.0f, // Normal: Positive Y
-
-		 0.5f,  0.0f,  0.5f, // Vert 2
-		 1.0f,  0.0f,  0.0f, // Red
-		 1.0f,  1.0f,        // UV (TR)
-		 0.0f,  1.0f,  0.0f, // Normal: Positive Y
-
-		-0.5f,  0.0f,  0.5f, // Vert 3
-		 1.0f,  1.0f,  0.0f, // Yellow
-		 0.0f,  1.0f,        // UV (TL)
-		 0.0f,  1.0f,  0.0f  // Normal: Positive Y
-	};
-
-	// Square Element Indices Data
-	GLubyte squareIndices[] = {
-		0, 1, 2, // Triangle 1
-		0, 2, 3 // Triangle 2
-	};
-
-	// Laptop Base Positions
-	glm::vec3 basePositions[] = {
-		glm::vec3(0.0f, 0.0f, 0.0f),    // Bottom
-		glm::vec3(0.0f, 0.125f, -2.5f), // Back
-		glm::vec3(0.0f, 0.25f, 0.0f),   // Top
-		glm::vec3(0.0f, 0.125f, 2.5f),  // Front
-		glm::vec3(-4.0f, 0.125f, 0.0f), // Left
-		glm::vec3(4.0f, 0.125f, 0.0f)   // Right
-	};
-
-	// Laptop Base Rotations
-	glm::float32 baseRotationsX[] = {
-		 0.0f, // Bottom
-		90.0f, // Back
-		 0.0f, // Top
-		90.0f, // Front
-		 0.0f, // Left
-		 0.0f  // Right
-	};
-
-	glm::float32 baseRotationsZ[] = {
-		  0.0f, // Bottom
-		  0.0f, // Back
-		  0.0f, // Top
-		  0.0f, // Front
-		 90.0f, // Left
-		-90.0f  // Right
-	};
-
-	// Laptop Base Scaling
-	glm::vec3 baseScaling[] = {
-		glm::vec3(8.0f, 1.0f, 5.0f),  // Bottom
-		glm::vec3(8.0f, 1.0f, 0.25f), // Back
-		glm::vec3(8.0f, 1.0f, 5.0f),  // Top
-		glm::vec3(8.0f, 1.0f, 0.25f), // Front
-		glm::vec3(0.25f, 1.0f, 5.0f), // Left
-		glm::vec3(0.25f, 1.0f, 5.0f)  // Right
-	};
-
-	// Laptop Monitor Positions
-	glm::vec3 monitorPositions[] = {
-		glm::vec3(0.0f, 0.25f, -2.45f),  // Bottom
-		glm::vec3(0.0f, 2.75f, -2.5f),   // Back
-		glm::vec3(0.0f, 5.25f, -2.45f),  // Top
-		glm::vec3(0.0f, 2.75f, -2.4f),   // Front
-		glm::vec3(-4.0f, 2.75f, -2.45f), // Left
-		glm::vec3(4.0f, 2.75f, -2.45f)   // Right
-	};
-
-	// Laptop Monitor Rotations
-	glm::float32 monitorRotationsX[] = {
-		  0.0f, // Bottom
-		270.0f, // Back
-		  0.0f, // Top
-		 90.0f, // Front
-		  0.0f, // Left
-		  0.0f  // Right
-	};
-
-	glm::float32 monitorRotationsZ[] = {
-		  0.0f, // Bottom
-		  0.0f, // Back
-		  0.0f, // Top
-		  0.0f, // Front
-		 90.0f, // Left
-		-90.0f  // Right
-	};
-
-	// Laptop Monitor Scaling
-	glm::vec3 monitorScaling[] = {
-		glm::vec3(8.0f, 1.0f, 0.1f), // Bottom
-		glm::vec3(8.0f, 1.0f, 5.0f), // Back
-		glm::vec3(8.0f, 1.0f, 0.1f), // Top
-		glm::vec3(8.0f, 1.0f, 5.0f), // Front
-		glm::vec3(5.0f, 1.0f, 0.1f), // Left
-		glm::vec3(5.0f, 1.0f, 0.1f)  // Right
-	};
-
-	// Teabox Positions
-	glm::vec3 teaboxPositions[] = {
-		glm::vec3(7.0f, 0.0f, -0.5f), // Bottom
-		glm::vec3(7.0f, 0.5f, -1.0f), // Back
-		glm::vec3(7.0f, 1.0f, -0.5f), // Top
-		glm::vec3(7.0f, 0.5f, 0.0f),  // Front
-		glm::vec3(6.0f, 0.5f, -0.5f), // Left
-		glm::vec3(8.0f, 0.5f, -0.5f)  // Right
-	};
-
-	// Teabox Rotations
-	glm::float32 teaboxRotationsX[] = {
-		180.0f, // Bottom
-		270.0f, // Back
-		  0.0f, // Top
-		 90.0f, // Front
-		 90.0f, // Left
-		 90.0f  // Right
-	};
-
-	glm::float32 teaboxRotationsZ[] = {
-		  0.0f, // Bottom
-		  0.0f, // Back
-		  0.0f, // Top
-		  0.0f, // Front
-		 90.0f, // Left
-		-90.0f  // Right
-	};
-
-	// Teabox Scaling
-	glm::vec3 teaboxScaling[] = {
-		glm::vec3(2.0f, 1.0f, 1.0f), // Bottom
-		glm::vec3(2.0f, 1.0f, 1.0f), // Back
-		glm::vec3(2.0f, 1.0f, 1.0f), // Top
-		glm::vec3(2.0f, 1.0f, 1.0f), // Front
-		glm::vec3(1.0f, 1.0f, 1.0f), // Left
-		glm::vec3(1.0f, 1.0f, 1.0f)  // Right
-	};
-
-	// Tea Bottle Positions
-	glm::vec3 teaBottlePositions[] = {
-		glm::vec3(-6.0f, 0.0f, -2.5f),  // Bottom
-		glm::vec3(-6.0f, 0.75f, -3.0f),   // Back
-		glm::vec3(-6.0f, 1.5f, -2.5f),  // Top
-		glm::vec3(-6.0f, 0.75f, -2.0f),   // Front
-		glm::vec3(-6.5f, 0.75f, -2.5f), // Left
-		glm::vec3(-5.5f, 0.75f, -2.5f)   // Right
-	};
-
-	// Tea Bottle Rotations
-	glm::float32 teaBottleRotationsX[] = {
-		  0.0f, // Bottom
-		270.0f, // Back
-		  0.0f, // Top
-		 90.0f, // Front
-		  0.0f, // Left
-		  0.0f  // Right
-	};
-
-	glm::float32 teaBottleRotationsZ[] = {
-		  0.0f, // Bottom
-		  0.0f, // Back
-		  0.0f, // Top
-		  0.0f, // Front
-		 90.0f, // Left
-		-90.0f  // Right
-	};
-
-	// Tea Bottle Scaling
-	glm::vec3 teaBottleScaling[] = {
-		glm::vec3(1.0f, 1.0f, 1.0f), // Bottom
-		glm::vec3(1.0f, 1.0f, 1.5f), // Back
-		glm::vec3(1.0f, 1.0f, 1.0f), // Top
-		glm::vec3(1.0f, 1.0f, 1.5f), // Front
-		glm::vec3(1.5f, 1.0f, 1.0f), // Left
-		glm::vec3(1.5f, 1.0f, 1.0f)  // Right
-	};
-
-	// Pyramid Vertex Data
-	GLfloat pyramidVertices[]{
-		 0.5f,  0.0f,  0.5f, // Vert 0
-		 1.0f,  0.0f,  0.0f, // Red
-		 1.0f,  0.0f,        // UV (BR)
-		 0.0f,  0.447214f, 0.894427f, // Normal
-
-		-0.5f,  0.0f,  0.5f, // Vert 1
-		 1.0f,  1.0f,  0.0f, // Yellow
-		 0.0f,  0.0f,        // UV (BL)
-		 0.0f,  0.447214f, 0.894427f, // Normal
-
-		 0.0f,  1.0f,  0.0f, // Vert 3
-		 0.0f,  0.0f,  0.0f, // Black
-		 0.5f,  1.0f,        // UV (TM)
-		 0.0f,  0.447214f, 0.894427f  // Normal
-	};
-
-	// Pyramid Element Indices Data
-	GLubyte pyramidIndices[] = {
-		0, 1, 2 // Triangle 1
-	};
-
-	// Pyramid rotations: Y-axis
-	glm::float32 pyramidRotationsY[] = {
-		0.0f, 90.0f, 180.0f, 270.0f
-	};
-
-	// Cylinder Vertex Data
-	GLfloat cylinderVertices[] = {
-		// Base
-		0.0f,  0.0f, 0.0f, // Vert 0
-		1.0f,  1.0f, 1.0f, // White
-		0.5f,  1.0f,       // UV (TM)
-		0.0f, -1.0f, 0.0f, // Normal: Negative Y
-
-		-sinf(glm::radians(7.5)), 0.0f, cosf(glm::radians(7.5)), // Vert 1
-		1.0f,  1.0f, 1.0f, // White
-		0.0f,  0.0f,       // UV (BL)
-		0.0f, -1.0f, 0.0f, // Normal: Negative Y
-
-		sinf(glm::radians(7.5)), 0.0f, cosf(glm::radians(7.5)), // Vert 2
-		0.0f,  0.0f, 0.0f, // Black
-		1.0f,  0.0f,       // UV (BR)
-		0.0f, -1.0f, 0.0f, // Normal: Negative Y
-
-		// Side
-		-sinf(glm::radians(7.5)), 0.0f, cosf(glm::radians(7.5)), // Vert 3
-		1.0f,  0.0f, 0.0f, // Red
-		0.0f,  0.0f,       // UV (BL)
-		0.0f,  0.0f, 1.0f, // Normal: Positive Z
-
-		-sinf(glm::radians(7.5)), 1.0f, cosf(glm::radians(7.5)), // Vert 4
-		1.0f,  0.0f, 0.0f, // Red
-		0.0f,  1.0f,       // UV (TL)
-		0.0f,  0.0f, 1.0f, // Normal: Positive Z
-
-		sinf(glm::radians(7.5)), 0.0f, cosf(glm::radians(7.5)), // Vert 5
-		0.0f,  1.0f, 0.0f, // Green
-		1.0f,  0.0f,       // UV (BR)
-		0.0f,  0.0f, 1.0f, // Normal: Positive Z
-
-		sinf(glm::radians(7.5)), 1.0f, cosf(glm::radians(7.5)), // Vert 6
-		0.0f,  1.0f, 0.0f, // Green
-		1.0f,  1.0f,       // UV (TR)
-		0.0f,  0.0f, 1.0f, // Normal: Positive Z
-
-		// Top
-		-sinf(glm::radians(7.5)), 1.0f, cosf(glm::radians(7.5)), // Vert 7
-		1.0f,  1.0f, 1.0f, // White
-		0.0f,  1.0f,       // UV (TL)
-		0.0f,  1.0f, 0.0f, // Normal: Positive Y
-
-		sinf(glm::radians(7.5)), 1.0f, cosf(glm::radians(7.5)), // Vert 8
-		0.0f,  0.0f, 0.0f, // Black
-		1.0f,  1.0f,       // UV (TR)
-		0.0f,  1.0f, 0.0f, // Normal: Positive Y
-
-		0.0f,  1.0f, 0.0f, // Vert 9
-		1.0f,  1.0f, 1.0f, // White
-		0.5f,  0.0f,       // UV (BM)
-		0.0f,  1.0f, 0.0f  // Normal: Positive Y
-	};
-
-	// Cylinder Element Indices Data
-	GLubyte cylinderIndices[] = {
-		0, 1, 2, // Triangle 1
-		3, 4, 5, // Triangle 2
-		4, 5, 6, // Triangle 3
-		7, 8, 9  // Triangle 4
-	};
-
-	// Lamp Vertex Data
-	GLfloat lampVertices[] = {
-		-0.5f,  0.5f, 0.0f, // Vert 0
-		-0.5f, -0.5f, 0.0f, // Vert 1
-		 0.5f, -0.5f, 0.0f, // Vert 2
-		 0.5f,  0.5f, 0.0f  // Vert 3
-	};
-
-	// Lamp positions
-	glm::vec3 lampPositions[] = {
-		glm::vec3(0.0f, 0.0f, 0.5f),
-		glm::vec3(0.5f, 0.0f, 0.0f),
-		glm::vec3(0.0f, 0.0f, -0.5f),
-		glm::vec3(-0.5f, 0.0f, 0.0f),
-		glm::vec3(0.0f, 0.5f, 0.0f),
-		glm::vec3(0.0f, -0.5f, 0.0f)
-	};
-
-	// Lamp rotations
-	glm::float32 lampRotations[] = {
-		0.0f, 90.0f, 180.0f, -90.0f, -90.0f, 90.0f
-	};
-
-	GLuint squareVAO, squareVBO, squareEBO;
-	glGenVertexArrays(1, &squareVAO); // Create VAO
-	glGenBuffers(1, &squareVBO); // Create VBO
-	glGenBuffers(1, &squareEBO); // Create EBO
-
-	glBindVertexArray(squareVAO); // Bind VAO
-
-	glBindBuffer(GL_ARRAY_BUFFER, squareVBO); // Select VBO
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, squareEBO); // Select EBO
-	glBufferData(GL_ARRAY_BUFFER, sizeof(squareVertices), squareVertices, GL_STATIC_DRAW); // Load vertex attributes
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(squareIndices), squareIndices, GL_STATIC_DRAW); // Load element indices
-
-	// Specify attribute location and layout to GPU
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (GLvoid*)0);
-	glEnableVertexAttribArray(0);
-
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-	glEnableVertexAttribArray(1);
-
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (GLvoid*)(6 * sizeof(GLfloat)));
-	glEnableVertexAttribArray(2);
-
-	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (GLvoid*)(8 * sizeof(GLfloat)));
-	glEnableVertexAttribArray(3);
-
-	glBindVertexArray(0); // Unbind VAO
-
-	GLuint pyramidVAO, pyramidVBO, pyramidEBO;
-	glGenVertexArrays(1, &pyramidVAO); // Create VAO
-	glGenBuffers(1, &pyramidVBO); // Create VBO
-	glGenBuffers(1, &pyramidEBO); // Create EBO
-
-	glBindVertexArray(pyramidVAO); // Bind VAO
-
-	glBindBuffer(GL_ARRAY_BUFFER, pyramidVBO); // Select VBO
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pyramidEBO); // Select EBO
-	glBufferData(GL_ARRAY_BUFFER, sizeof(pyramidVertices), pyramidVertices, GL_STATIC_DRAW); // Load vertex attributes
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(pyramidIndices), pyramidIndices, GL_STATIC_DRAW); // Load element indices
-
-	// Specify attribute location and layout to GPU
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (GLvoid*)0);
-	glEnableVertexAttribArray(0);
-
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-	glEnableVertexAttribArray(1);
+	// Scripted camera for headless and benchmark runs
+	vector<CameraPose> cameraPoses;
+	if (!cameraPathFile.empty()) {
+		string error;
+		if (!loadCameraPath(cameraPathFile, cameraPoses, error)) {
+			cout << error << endl;
+			exit(EXIT_FAILURE);
+		}
+	}
+	else if (headless || benchmarkFrames > 0) {
+		cout << "--headless and --benchmark need a --camera-path" << endl;
+		exit(EXIT_FAILURE);
+	}
 
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (GLvoid*)(6 * sizeof(GLfloat)));
-	glEnableVertexAttribArray(2);
+	// Window, or none in headless mode
+	GLFWwindow* window = nullptr;
+	HeadlessContext headlessContext;
 
-	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (GLvoid*)(8 * sizeof(GLfloat)));
-	glEnableVertexAttribArray(3);
+	if (headless) {
+		if (headlessWidth <= 0 || headlessHeight <= 0 || !headlessContext.create()) { exit(EXIT_FAILURE); }
 
-	glBindVertexArray(0); // Unbind VAO
+		width = headlessWidth;
+		height = headlessHeight;
 
-	GLuint cylinderVAO, cylinderVBO, cylinderEBO;
-	glGenVertexArrays(1, &cylinderVAO); // Create VAO
-	glGenBuffers(1, &cylinderVBO); // Create VBO
-	glGenBuffers(1, &cylinderEBO); // Create EBO
+		// Core profile entry points are only loaded with glewExperimental
+		glewExperimental = GL_TRUE;
+	}
+	else {
+		if (!glfwInit()) { exit(EXIT_FAILURE); }
 
-	glBindVertexArray(cylinderVAO); // Bind VAO
+		//glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+		//glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 
-	glBindBuffer(GL_ARRAY_BUFFER, cylinderVBO); // Select VBO
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cylinderEBO); // Select EBO
-	glBufferData(GL_ARRAY_BUFFER, sizeof(cylinderVertices), cylinderVertices, GL_STATIC_DRAW); // Load vertex attributes
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cylinderIndices), cylinderIndices, GL_STATIC_DRAW); // Load element indices
+		window = glfwCreateWindow(width, height, "Main Window", NULL, NULL);
 
-	// Specify attribute location and layout to GPU
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (GLvoid*)0);
-	glEnableVertexAttribArray(0);
+		// Set Input Callback Functions
+		glfwSetCursorPosCallback(window, cursor_position_callback);
+		glfwSetScrollCallback(window, scroll_callback);
+		glfwSetKeyCallback(window, key_callback);
 
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-	glEnableVertexAttribArray(1);
+		// Capture mouse for input
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (GLvoid*)(6 * sizeof(GLfloat)));
-	glEnableVertexAttribArray(2);
+		glfwMakeContextCurrent(window);
+	}
 
-	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (GLvoid*)(8 * sizeof(GLfloat)));
-	glEnableVertexAttribArray(3);
+	// Without a GLX display GLEW still loads the GL entry points, but reports the missing display
+	GLenum glewStatus = glewInit();
+	if (glewStatus != GLEW_OK && !(window == nullptr && glewStatus == GLEW_ERROR_NO_GLX_DISPLAY)) { exit(EXIT_FAILURE); }
 
-	glBindVertexArray(0); // Unbind VAO
+	// Per-draw uniforms are streamed through a persistently mapped buffer
+	if (!GLEW_ARB_buffer_storage) {
+		cout << "OpenGL 4.4 or ARB_buffer_storage is required" << endl;
+		glfwTerminate();
+		exit(EXIT_FAILURE);
+	}
 
-	GLuint lampVAO, lampVBO, lampEBO;
-	glGenVertexArrays(1, &lampVAO); // Create VAO
-	glGenBuffers(1, &lampVBO); // Create VBO
-	glGenBuffers(1, &lampEBO); // Create EBO
+	// Benchmarks measure the renderer, not the display's refresh rate
+	if (window != nullptr)
+		glfwSwapInterval(benchmarkFrames > 0 ? 0 : 1);
+
+	// Frames go to the window, or to an offscreen target that is read back after each frame
+	unique_ptr<OffscreenTarget> offscreenTarget;
+	if (window == nullptr)
+		offscreenTarget.reset(new OffscreenTarget(width, height));
+	GLuint targetFramebuffer = offscreenTarget ? offscreenTarget->framebuffer() : 0;
+
+	// Load the scene description, compiling it to its binary form on first use
+	SceneDescription sceneDescription;
+	if (!loadScene(sceneFile, sceneDescription)) {
+		glfwTerminate();
+		exit(EXIT_FAILURE);
+	}
 
-	glBindVertexArray(lampVAO); // Bind VAO
+	// Node the animation moves, -1 for none
+	int animatedNode = -1;
+	if (!animatedNodeName.empty()) {
+		animatedNode = findSceneNode(sceneDescription, animatedNodeName);
+		if (animatedNode < 0) {
+			cout << "--animate-node: " << sceneFile << " has no node '" << animatedNodeName << "'" << endl;
+			glfwTerminate();
+			exit(EXIT_FAILURE);
+		}
+	}
 
-	glBindBuffer(GL_ARRAY_BUFFER, lampVBO); // Select VBO
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, lampEBO); // Select EBO
-	glBufferData(GL_ARRAY_BUFFER, sizeof(lampVertices), lampVertices, GL_STATIC_DRAW); // Load vertex attributes
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(squareIndices), squareIndices, GL_STATIC_DRAW); // Load element indices
+	// Generate meshes
+	vector<MeshData> sceneMeshes;
+	for (size_t i = 0; i < sceneDescription.meshes.size(); i++) {
+		const SceneMeshRecord& mesh = sceneDescription.meshes[i];
+		bool noCaps = (mesh.flags & SCENE_MESH_NO_CAPS) != 0;
+
+		switch (mesh.type) {
+		case SCENE_MESH_PLANE:
+			sceneMeshes.push_back(generatePlane(mesh.segments));
+			break;
+		case SCENE_MESH_BOX:
+			sceneMeshes.push_back(generateBox());
+			break;
+		case SCENE_MESH_CYLINDER:
+			sceneMeshes.push_back(generateCylinder(cylinderSegments > 0 ? cylinderSegments : mesh.segments, mesh.uRepeat, !noCaps));
+			break;
+		default:
+			sceneMeshes.push_back(generateCone(mesh.segments, mesh.uRepeat, (mesh.flags & SCENE_MESH_FACETED) != 0, !noCaps));
+			break;
+		}
+	}
 
-	// Specify attribute location and layout to GPU
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0 * sizeof(GLfloat), (GLvoid*)0);
-	glEnableVertexAttribArray(0);
+	// Optimize before anything copies the meshes into the batch and draw list
+	if (optimizeMeshes) {
+		cout << fixed << setprecision(3) << "Mesh optimization (ACMR and ATVR for a " << VERTEX_CACHE_SIZE << "-entry FIFO cache)" << endl;
+		for (size_t i = 0; i < sceneMeshes.size(); i++) {
+			MeshOptimizeReport report = optimizeMesh(sceneMeshes[i]);
+			cout << "  Mesh " << i << ": " << sceneMeshes[i].indices.size() / 3 << " triangles, " << report.verticesBefore << " -> "
+				<< report.verticesAfter << " vertices, ACMR " << report.before.acmr << " -> " << report.after.acmr << ", ATVR "
+				<< report.before.atvr << " -> " << report.after.atvr << endl;
+		}
+		cout.unsetf(ios::floatfield);
+		cout << setprecision(6);
+	}
 
-	glBindVertexArray(0); // Unbind VAO
+	// The lamp shader scales positions itself, so they are stored as half floats rather than quantized to the box
+	VertexLayout lampLayout = PACKED_VERTEX_LAYOUT;
+	lampLayout.position = GL_HALF_FLOAT;
+	Mesh lampMesh = uploadMesh(generateBox(), lampLayout);
 
 	// Enable depth buffer
 	glEnable(GL_DEPTH_TEST);
@@ -549,1033 +675,1346 @@ int main(void) {
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
 	// Load Textures
-	int keyboardTexWidth, keyboardTexHeight;
-	unsigned char* keyboardImage = SOIL_load_image("keyboardEdit.jpg", &keyboardTexWidth, &keyboardTexHeight, 0, SOIL_LOAD_RGB);
-
-	int laptop_lidTexWidth, laptop_lidTexHeight;
-	unsigned char* laptop_lidImage = SOIL_load_image("laptop_lidEdit.jpg", &laptop_lidTexWidth, &laptop_lidTexHeight, 0, SOIL_LOAD_RGB);
-
-	int laptop_rimTexWidth, laptop_rimTexHeight;
-	unsigned char* laptop_rimImage = SOIL_load_image("laptop_rim.jpg", &laptop_rimTexWidth, &laptop_rimTexHeight, 0, SOIL_LOAD_RGB);
-
-	int monitorTexWidth, monitorTexHeight;
-	unsigned char* monitorImage = SOIL_load_image("monitorEdit.jpg", &monitorTexWidth, &monitorTexHeight, 0, SOIL_LOAD_RGB);
-
-	int teabox_backTexWidth, teabox_backTexHeight;
-	unsigned char* teabox_backImage = SOIL_load_image("teabox_backEdit.jpg", &teabox_backTexWidth, &teabox_backTexHeight, 0, SOIL_LOAD_RGB);
-
-	int teabox_bottomTexWidth, teabox_bottomTexHeight;
-	unsigned char* teabox_bottomImage = SOIL_load_image("teabox_bottomEdit.jpg", &teabox_bottomTexWidth, &teabox_bottomTexHeight, 0, SOIL_LOAD_RGB);
-
-	int teabox_frontTexWidth, teabox_frontTexHeight;
-	unsigned char* teabox_frontImage = SOIL_load_image("teabox_frontEdit.jpg", &teabox_frontTexWidth, &teabox_frontTexHeight, 0, SOIL_LOAD_RGB);
-
-	int teabox_leftTexWidth, teabox_leftTexHeight;
-	unsigned char* teabox_leftImage = SOIL_load_image("teabox_leftEdit.jpg", &teabox_leftTexWidth, &teabox_leftTexHeight, 0, SOIL_LOAD_RGB);
-
-	int teabox_rightTexWidth, teabox_rightTexHeight;
-	unsigned char* teabox_rightImage = SOIL_load_image("teabox_rightEdit.jpg", &teabox_rightTexWidth, &teabox_rightTexHeight, 0, SOIL_LOAD_RGB);
-
-	int teabox_topTexWidth, teabox_topTexHeight;
-	unsigned char* teabox_topImage = SOIL_load_image("teabox_topEdit.jpg", &teabox_topTexWidth, &teabox_topTexHeight, 0, SOIL_LOAD_RGB);
-
-	int teabottle_labelTexWidth, teabottle_labelTexHeight;
-	unsigned char* teabottle_labelImage = SOIL_load_image("teabottle_labelEdit.jpg", &teabottle_labelTexWidth, &teabottle_labelTexHeight, 0, SOIL_LOAD_RGB);
-
-	int teabottle_descTexWidth, teabottle_descTexHeight;
-	unsigned char* teabottle_descImage = SOIL_load_image("teabottle_descEdit.jpg", &teabottle_descTexWidth, &teabottle_descTexHeight, 0, SOIL_LOAD_RGB);
-
-	int teabottle_nutrTexWidth, teabottle_nutrTexHeight;
-	unsigned char* teabottle_nutrImage = SOIL_load_image("teabottle_nutrEdit.jpg", &teabottle_nutrTexWidth, &teabottle_nutrTexHeight, 0, SOIL_LOAD_RGBA);
-
-	int teaTexWidth, teaTexHeight;
-	unsigned char* teaImage = SOIL_load_image("tea.jpg", &teaTexWidth, &teaTexHeight, 0, SOIL_LOAD_RGB);
+	TextureLoader textureLoader;
+	textureLoader.setUseBakedTextures(useBakedTextures);
+	textureLoader.setBudget(textureBudgetMB * 1024 * 1024);
+
+	vector<GLuint> sceneTextures;
+	for (size_t i = 0; i < sceneDescription.textures.size(); i++) {
+		const SceneTextureRecord& texture = sceneDescription.textures[i];
+		string path = sceneDescription.string(texture.path);
+		int channels = texture.channels == 4 ? SOIL_LOAD_RGBA : SOIL_LOAD_RGB;
+
+		if (texture.layers == 0) {
+			sceneTextures.push_back(textureLoader.add(path, channels));
+			continue;
+		}
 
-	int lidTexWidth, lidTexHeight;
-	unsigned char* lidImage = SOIL_load_image("lid.jpg", &lidTexWidth, &lidTexHeight, 0, SOIL_LOAD_RGB);
+		// Array layers are numbered from 1 in place of the %d in the path
+		vector<string> layerFiles;
+		size_t number = path.find("%d");
+		for (uint32_t layer = 1; layer <= texture.layers; layer++) {
+			string layerFile = path;
+			if (number != string::npos)
+				layerFile.replace(number, 2, to_string(layer));
+			layerFiles.push_back(layerFile);
+		}
+		sceneTextures.push_back(textureLoader.addArray(layerFiles, channels));
+	}
 
-	int nutsEdit1TexWidth, nutsEdit1TexHeight;
-	unsigned char* nutsEdit1Image = SOIL_load_image("nutsEdit1.jpg", &nutsEdit1TexWidth, &nutsEdit1TexHeight, 0, SOIL_LOAD_RGB);
+	// glTF models; their base color textures join the scene's so they stream and count against the budget the same way
+	vector<GltfModel> models(modelFiles.size());
+	vector<vector<GLuint> > modelTextures(modelFiles.size());
+	vector<string> modelTexturePaths;
+	size_t firstModelTexture = sceneTextures.size();
+	for (size_t i = 0; i < modelFiles.size(); i++) {
+		string error;
+		double loadStart = secondsSinceStart();
+		if (!loadGltf(modelFiles[i], models[i], error)) {
+			cout << error << endl;
+			exit(EXIT_FAILURE);
+		}
 
-	int nutsEdit2TexWidth, nutsEdit2TexHeight;
-	unsigned char* nutsEdit2Image = SOIL_load_image("nutsEdit2.jpg", &nutsEdit2TexWidth, &nutsEdit2TexHeight, 0, SOIL_LOAD_RGB);
+		cout << modelFiles[i] << ": " << models[i].primitives.size() << " primitives, " << models[i].instances.size() << " instances, "
+			<< models[i].bufferBytes / 1024 << " KB uploaded from the mapped buffers in " << (secondsSinceStart() - loadStart) * 1000.0 << " ms" << endl;
 
-	int nutsEdit3TexWidth, nutsEdit3TexHeight;
-	unsigned char* nutsEdit3Image = SOIL_load_image("nutsEdit3.jpg", &nutsEdit3TexWidth, &nutsEdit3TexHeight, 0, SOIL_LOAD_RGB);
+		for (size_t j = 0; j < models[i].materials.size(); j++) {
+			const string& path = models[i].materials[j].texture;
+			if (path.empty()) {
+				modelTextures[i].push_back(0);
+				continue;
+			}
 
-	int nutsEdit4TexWidth, nutsEdit4TexHeight;
-	unsigned char* nutsEdit4Image = SOIL_load_image("nutsEdit4.jpg", &nutsEdit4TexWidth, &nutsEdit4TexHeight, 0, SOIL_LOAD_RGB);
+			// Models sharing an image share the texture
+			size_t loaded = find(modelTexturePaths.begin(), modelTexturePaths.end(), path) - modelTexturePaths.begin();
+			if (loaded == modelTexturePaths.size()) {
+				modelTexturePaths.push_back(path);
+				sceneTextures.push_back(textureLoader.add(path, SOIL_LOAD_RGB));
+			}
+			modelTextures[i].push_back(sceneTextures[firstModelTexture + loaded]);
+		}
+	}
 
-	int nutsEdit5TexWidth, nutsEdit5TexHeight;
-	unsigned char* nutsEdit5Image = SOIL_load_image("nutsEdit5.jpg", &nutsEdit5TexWidth, &nutsEdit5TexHeight, 0, SOIL_LOAD_RGB);
+	// Untextured model materials sample a white texel so only their color shows
+	GLuint whiteTexture = 0;
+	if (!models.empty()) {
+		const GLubyte white[] = { 255, 255, 255 };
+		glGenTextures(1, &whiteTexture);
+		glBindTexture(GL_TEXTURE_2D, whiteTexture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, white);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
 
-	int nutsEdit6TexWidth, nutsEdit6TexHeight;
-	unsigned char* nutsEdit6Image = SOIL_load_image("nutsEdit6.jpg", &nutsEdit6TexWidth, &nutsEdit6TexHeight, 0, SOIL_LOAD_RGB);
+	// Decode on worker threads and upload from the render loop, or block on the serial path for comparison
+	if (serialTextureLoading) {
+		textureLoader.loadAllSerial();
+		textureLoader.printReport();
+	}
+	else {
+		textureLoader.start();
+	}
 
-	int nutsEdit7TexWidth, nutsEdit7TexHeight;
-	unsigned char* nutsEdit7Image = SOIL_load_image("nutsEdit7.jpg", &nutsEdit7TexWidth, &nutsEdit7TexHeight, 0, SOIL_LOAD_RGB);
+	// Materials
+	vector<BatchMaterial> sceneMaterials;
+	for (size_t i = 0; i < sceneDescription.materials.size(); i++) {
+		const SceneMaterialRecord& record = sceneDescription.materials[i];
+		BatchMaterial material;
+		material.texture = sceneTextures[record.texture];
+		material.color = glm::make_vec3(record.color);
+		material.textureArray = sceneDescription.textures[record.texture].layers > 0;
+		sceneMaterials.push_back(material);
+	}
 
-	int nutsEdit8TexWidth, nutsEdit8TexHeight;
-	unsigned char* nutsEdit8Image = SOIL_load_image("nutsEdit8.jpg", &nutsEdit8TexWidth, &nutsEdit8TexHeight, 0, SOIL_LOAD_RGB);
+	// Build the scene graph
+	SceneGraph scene;
+	for (size_t i = 0; i < sceneDescription.nodes.size(); i++)
+		scene.createNode(sceneDescription.nodes[i].parent, glm::make_mat4(sceneDescription.nodes[i].local));
+
+	// Model nodes follow, each model's roots at the root of the scene
+	vector<int> modelNodeBase(models.size(), 0);
+	for (size_t i = 0; i < models.size(); i++) {
+		for (size_t j = 0; j < models[i].nodes.size(); j++) {
+			const GltfNode& node = models[i].nodes[j];
+			int created = scene.createNode(node.parent >= 0 ? modelNodeBase[i] + node.parent : -1, node.local);
+			if (j == 0)
+				modelNodeBase[i] = created;
+		}
+	}
 
-	int nutsEdit9TexWidth, nutsEdit9TexHeight;
-	unsigned char* nutsEdit9Image = SOIL_load_image("nutsEdit9.jpg", &nutsEdit9TexWidth, &nutsEdit9TexHeight, 0, SOIL_LOAD_RGB);
+	// The scene's lights stay put; extra lights get random colors and circle over the desk
+	vector<SceneLightRecord> sceneLights = sceneDescription.lights;
+	vector<LightOrbit> lightOrbits(sceneLights.size(), LightOrbit());
+
+	srand(1);
+	for (int i = 0; i < extraLights; i++) {
+		LightOrbit orbit;
+		orbit.center = glm::vec3(randomRange(-9.0f, 9.0f), randomRange(0.5f, 3.0f), randomRange(-9.0f, 9.0f));
+		orbit.radius = randomRange(0.5f, 2.0f);
+		orbit.speed = randomRange(0.5f, 1.5f) * (rand() % 2 ? 1.0f : -1.0f);
+		orbit.phase = randomRange(0.0f, 6.2831853f);
+		lightOrbits.push_back(orbit);
+
+		SceneLightRecord light;
+		light.position[0] = orbit.center.x + orbit.radius;
+		light.position[1] = orbit.center.y;
+		light.position[2] = orbit.center.z;
+		light.color[0] = randomRange(0.2f, 1.0f);
+		light.color[1] = randomRange(0.2f, 1.0f);
+		light.color[2] = randomRange(0.2f, 1.0f);
+		light.ambient = 0.0f;
+		light.diffuse = 1.5f;
+		light.specular = 1.0f;
+		light.shininess = 16.0f;
+		light.range = randomRange(2.0f, 4.0f);
+		sceneLights.push_back(light);
+	}
 
-	int nutsEdit10TexWidth, nutsEdit10TexHeight;
-	unsigned char* nutsEdit10Image = SOIL_load_image("nutsEdit10.jpg", &nutsEdit10TexWidth, &nutsEdit10TexHeight, 0, SOIL_LOAD_RGB);
+	GLint lightCount = (GLint)sceneLights.size();
 
-	int nutsEdit11TexWidth, nutsEdit11TexHeight;
-	unsigned char* nutsEdit11Image = SOIL_load_image("nutsEdit11.jpg", &nutsEdit11TexWidth, &nutsEdit11TexHeight, 0, SOIL_LOAD_RGB);
+	scene.update();
 
-	int nutsEdit12TexWidth, nutsEdit12TexHeight;
-	unsigned char* nutsEdit12Image = SOIL_load_image("nutsEdit12.jpg", &nutsEdit12TexWidth, &nutsEdit12TexHeight, 0, SOIL_LOAD_RGB);
+	// Objects at or below the animated node move, so they are kept out of the batch
+	glm::mat4 animatedNodeRest = animatedNode >= 0 ? scene.local(animatedNode) : glm::mat4(1.0f);
+	vector<size_t> movingObjects;
+	for (size_t i = 0; i < sceneDescription.objects.size(); i++) {
+		int node = (int)sceneDescription.objects[i].node;
+		while (node >= 0 && node != animatedNode)
+			node = scene.parent(node);
+		if (animatedNode >= 0 && node == animatedNode)
+			movingObjects.push_back(i);
+	}
+	if (animatedNode >= 0)
+		cout << "Animating " << animatedNodeName << " with " << movingObjects.size() << " objects" << endl;
 
-	int nutsEdit13TexWidth, nutsEdit13TexHeight;
-	unsigned char* nutsEdit13Image = SOIL_load_image("nutsEdit13.jpg", &nutsEdit13TexWidth, &nutsEdit13TexHeight, 0, SOIL_LOAD_RGB);
+	// Bake every other scene object into world space once, grouped by material
+	StaticBatchBuilder sceneBatchBuilder;
+	for (size_t i = 0; i < sceneDescription.objects.size(); i++) {
+		if (find(movingObjects.begin(), movingObjects.end(), i) != movingObjects.end())
+			continue;
 
-	int nutsEdit14TexWidth, nutsEdit14TexHeight;
-	unsigned char* nutsEdit14Image = SOIL_load_image("nutsEdit14.jpg", &nutsEdit14TexWidth, &nutsEdit14TexHeight, 0, SOIL_LOAD_RGB);
+		const SceneObjectRecord& object = sceneDescription.objects[i];
+		sceneBatchBuilder.add(sceneMeshes[object.mesh], scene.world(object.node), scene.normalMatrix(object.node), sceneMaterials[object.material]);
+	}
 
-	int nutsEdit15TexWidth, nutsEdit15TexHeight;
-	unsigned char* nutsEdit15Image = SOIL_load_image("nutsEdit15.jpg", &nutsEdit15TexWidth, &nutsEdit15TexHeight, 0, SOIL_LOAD_RGB);
-
-	int nutsEdit16TexWidth, nutsEdit16TexHeight;
-	unsigned char* nutsEdit16Image = SOIL_load_image("nutsEdit16.jpg", &nutsEdit16TexWidth, &nutsEdit16TexHeight, 0, SOIL_LOAD_RGB);
-
-	int nutsEdit17TexWidth, nutsEdit17TexHeight;
-	unsigned char* nutsEdit17Image = SOIL_load_image("nutsEdit17.jpg", &nutsEdit17TexWidth, &nutsEdit17TexHeight, 0, SOIL_LOAD_RGB);
-
-	int nutsEdit18TexWidth, nutsEdit18TexHeight;
-	unsigned char* nutsEdit18Image = SOIL_load_image("nutsEdit18.jpg", &nutsEdit18TexWidth, &nutsEdit18TexHeight, 0, SOIL_LOAD_RGB);
-
-	int nutsEdit19TexWidth, nutsEdit19TexHeight;
-	unsigned char* nutsEdit19Image = SOIL_load_image("nutsEdit19.jpg", &nutsEdit19TexWidth, &nutsEdit19TexHeight, 0, SOIL_LOAD_RGB);
-
-	int nutsEdit20TexWidth, nutsEdit20TexHeight;
-	unsigned char* nutsEdit20Image = SOIL_load_image("nutsEdit20.jpg", &nutsEdit20TexWidth, &nutsEdit20TexHeight, 0, SOIL_LOAD_RGB);
-
-	int nutsEdit21TexWidth, nutsEdit21TexHeight;
-	unsigned char* nutsEdit21Image = SOIL_load_image("nutsEdit21.jpg", &nutsEdit21TexWidth, &nutsEdit21TexHeight, 0, SOIL_LOAD_RGB);
-
-	int nutsEdit22TexWidth, nutsEdit22TexHeight;
-	unsigned char* nutsEdit22Image = SOIL_load_image("nutsEdit22.jpg", &nutsEdit22TexWidth, &nutsEdit22TexHeight, 0, SOIL_LOAD_RGB);
-
-	int nutsEdit23TexWidth, nutsEdit23TexHeight;
-	unsigned char* nutsEdit23Image = SOIL_load_image("nutsEdit23.jpg", &nutsEdit23TexWidth, &nutsEdit23TexHeight, 0, SOIL_LOAD_RGB);
-
-	int nutsEdit24TexWidth, nutsEdit24TexHeight;
-	unsigned char* nutsEdit24Image = SOIL_load_image("nutsEdit24.jpg", &nutsEdit24TexWidth, &nutsEdit24TexHeight, 0, SOIL_LOAD_RGB);
-
-	int woodTexWidth, woodTexHeight;
-	unsigned char* woodImage = SOIL_load_image("wood.jpg", &woodTexWidth, &woodTexHeight, 0, SOIL_LOAD_RGB);
-
-	// Generate Textures
-	GLuint keyboardTexture;
-	glm::vec3 keyboardColor;
-	glGenTextures(1, &keyboardTexture);
-	glBindTexture(GL_TEXTURE_2D, keyboardTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, keyboardTexWidth, keyboardTexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, keyboardImage);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	keyboardColor = glm::vec3(0.1f, 0.1f, 0.09f);
-	SOIL_free_image_data(keyboardImage);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	GLuint laptop_lidTexture;
-	glm::vec3 laptop_lidColor;
-	glGenTextures(1, &laptop_lidTexture);
-	glBindTexture(GL_TEXTURE_2D, laptop_lidTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, laptop_lidTexWidth, laptop_lidTexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, laptop_lidImage);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	laptop_lidColor = glm::vec3(0.12f, 0.12f, 0.11f);
-	SOIL_free_image_data(laptop_lidImage);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	GLuint laptop_rimTexture;
-	glm::vec3 laptop_rimColor;
-	glGenTextures(1, &laptop_rimTexture);
-	glBindTexture(GL_TEXTURE_2D, laptop_rimTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, laptop_rimTexWidth, laptop_rimTexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, laptop_rimImage);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	laptop_rimColor = glm::vec3(0.08f, 0.08f, 0.07f);
-	SOIL_free_image_data(laptop_rimImage);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	GLuint monitorTexture;
-	glm::vec3 monitorColor;
-	glGenTextures(1, &monitorTexture);
-	glBindTexture(GL_TEXTURE_2D, monitorTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, monitorTexWidth, monitorTexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, monitorImage);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	monitorColor = glm::vec3(0.08f, 0.09f, 0.08f);
-	SOIL_free_image_data(monitorImage);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	GLuint teabox_backTexture;
-	glm::vec3 teabox_backColor;
-	glGenTextures(1, &teabox_backTexture);
-	glBindTexture(GL_TEXTURE_2D, teabox_backTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, teabox_backTexWidth, teabox_backTexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, teabox_backImage);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	teabox_backColor = glm::vec3(0.16f, 0.15f, 0.14f);
-	SOIL_free_image_data(teabox_backImage);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	GLuint teabox_bottomTexture;
-	glm::vec3 teabox_bottomColor;
-	glGenTextures(1, &teabox_bottomTexture);
-	glBindTexture(GL_TEXTURE_2D, teabox_bottomTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, teabox_bottomTexWidth, teabox_bottomTexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, teabox_bottomImage);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	teabox_bottomColor = glm::vec3(0.22f, 0.21f, 0.19f);
-	SOIL_free_image_data(teabox_bottomImage);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	GLuint teabox_frontTexture;
-	glm::vec3 teabox_frontColor;
-	glGenTextures(1, &teabox_frontTexture);
-	glBindTexture(GL_TEXTURE_2D, teabox_frontTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, teabox_frontTexWidth, teabox_frontTexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, teabox_frontImage);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	teabox_frontColor = glm::vec3(0.18f, 0.19f, 0.21f);
-	SOIL_free_image_data(teabox_frontImage);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	GLuint teabox_leftTexture;
-	glm::vec3 teabox_leftColor;
-	glGenTextures(1, &teabox_leftTexture);
-	glBindTexture(GL_TEXTURE_2D, teabox_leftTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, teabox_leftTexWidth, teabox_leftTexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, teabox_leftImage);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	teabox_leftColor = glm::vec3(0.25f, 0.21f, 0.18f);
-	SOIL_free_image_data(teabox_leftImage);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	GLuint teabox_rightTexture;
-	glm::vec3 teabox_rightColor;
-	glGenTextures(1, &teabox_rightTexture);
-	glBindTexture(GL_TEXTURE_2D, teabox_rightTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, teabox_rightTexWidth, teabox_rightTexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, teabox_rightImage);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	teabox_rightColor = glm::vec3(0.21f, 0.21f, 0.19f);
-	SOIL_free_image_data(teabox_rightImage);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	GLuint teabox_topTexture;
-	glm::vec3 teabox_topColor;
-	glGenTextures(1, &teabox_topTexture);
-	glBindTexture(GL_TEXTURE_2D, teabox_topTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, teabox_topTexWidth, teabox_topTexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, teabox_topImage);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	teabox_topColor = glm::vec3(0.14f, 0.12f, 0.1f);
-	SOIL_free_image_data(teabox_topImage);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	GLuint teabottle_labelTexture;
-	glm::vec3 teabottle_labelColor;
-	glGenTextures(1, &teabottle_labelTexture);
-	glBindTexture(GL_TEXTURE_2D, teabottle_labelTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, teabottle_labelTexWidth, teabottle_labelTexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, teabottle_labelImage);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	teabottle_labelColor = glm::vec3(0.17f, 0.19f, 0.22f);
-	SOIL_free_image_data(teabottle_labelImage);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	GLuint teabottle_descTexture;
-	glm::vec3 teabottle_descColor;
-	glGenTextures(1, &teabottle_descTexture);
-	glBindTexture(GL_TEXTURE_2D, teabottle_descTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, teabottle_descTexWidth, teabottle_descTexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, teabottle_descImage);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	teabottle_descColor = glm::vec3(0.09f, 0.09f, 0.07f);
-	SOIL_free_image_data(teabottle_descImage);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	GLuint teabottle_nutrTexture;
-	glm::vec3 teabottle_nutrColor;
-	glGenTextures(1, &teabottle_nutrTexture);
-	glBindTexture(GL_TEXTURE_2D, teabottle_nutrTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, teabottle_nutrTexWidth, teabottle_nutrTexHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, teabottle_nutrImage);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	teabottle_nutrColor = glm::vec3(0.14f, 0.12f, 0.10f);
-	SOIL_free_image_data(teabottle_nutrImage);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	GLuint teaTexture;
-	glm::vec3 teaColor;
-	glGenTextures(1, &teaTexture);
-	glBindTexture(GL_TEXTURE_2D, teaTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, teaTexWidth, teaTexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, teaImage);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	teaColor = glm::vec3(0.28f, 0.12f, 0.0f);
-	SOIL_free_image_data(teaImage);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	GLuint lidTexture;
-	glm::vec3 lidColor;
-	glGenTextures(1, &lidTexture);
-	glBindTexture(GL_TEXTURE_2D, lidTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, lidTexWidth, lidTexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, lidImage);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	lidColor = glm::vec3(0.18f, 0.18f, 0.18f);
-	SOIL_free_image_data(lidImage);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	GLuint nutsEdit1Texture;
-	glm::vec3 nutsEditColor;
-	glGenTextures(1, &nutsEdit1Texture);
-	glBindTexture(GL_TEXTURE_2D, nutsEdit1Texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nutsEdit1TexWidth, nutsEdit1TexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nutsEdit1Image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	nutsEditColor = glm::vec3(0.31f, 0.2f, 0.08f);
-	SOIL_free_image_data(nutsEdit1Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	nutTexList[0] = nutsEdit1Texture;
-
-	GLuint nutsEdit2Texture;
-	glGenTextures(1, &nutsEdit2Texture);
-	glBindTexture(GL_TEXTURE_2D, nutsEdit2Texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nutsEdit2TexWidth, nutsEdit2TexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nutsEdit2Image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(nutsEdit2Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	nutTexList[1] = nutsEdit2Texture;
-
-	GLuint nutsEdit3Texture;
-	glGenTextures(1, &nutsEdit3Texture);
-	glBindTexture(GL_TEXTURE_2D, nutsEdit3Texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nutsEdit3TexWidth, nutsEdit3TexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nutsEdit3Image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(nutsEdit3Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	nutTexList[2] = nutsEdit3Texture;
-
-	GLuint nutsEdit4Texture;
-	glGenTextures(1, &nutsEdit4Texture);
-	glBindTexture(GL_TEXTURE_2D, nutsEdit4Texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nutsEdit4TexWidth, nutsEdit4TexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nutsEdit4Image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(nutsEdit4Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	nutTexList[3] = nutsEdit4Texture;
-
-	GLuint nutsEdit5Texture;
-	glGenTextures(1, &nutsEdit5Texture);
-	glBindTexture(GL_TEXTURE_2D, nutsEdit5Texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nutsEdit5TexWidth, nutsEdit5TexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nutsEdit5Image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(nutsEdit5Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	nutTexList[4] = nutsEdit5Texture;
-
-	GLuint nutsEdit6Texture;
-	glGenTextures(1, &nutsEdit6Texture);
-	glBindTexture(GL_TEXTURE_2D, nutsEdit6Texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nutsEdit6TexWidth, nutsEdit6TexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nutsEdit6Image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(nutsEdit6Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	nutTexList[5] = nutsEdit6Texture;
-
-	GLuint nutsEdit7Texture;
-	glGenTextures(1, &nutsEdit7Texture);
-	glBindTexture(GL_TEXTURE_2D, nutsEdit7Texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nutsEdit7TexWidth, nutsEdit7TexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nutsEdit7Image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(nutsEdit7Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	nutTexList[6] = nutsEdit7Texture;
-
-	GLuint nutsEdit8Texture;
-	glGenTextures(1, &nutsEdit8Texture);
-	glBindTexture(GL_TEXTURE_2D, nutsEdit8Texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nutsEdit8TexWidth, nutsEdit8TexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nutsEdit8Image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(nutsEdit8Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	nutTexList[7] = nutsEdit8Texture;
-
-	GLuint nutsEdit9Texture;
-	glGenTextures(1, &nutsEdit9Texture);
-	glBindTexture(GL_TEXTURE_2D, nutsEdit9Texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nutsEdit9TexWidth, nutsEdit9TexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nutsEdit9Image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(nutsEdit9Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	nutTexList[8] = nutsEdit9Texture;
-
-	GLuint nutsEdit10Texture;
-	glGenTextures(1, &nutsEdit10Texture);
-	glBindTexture(GL_TEXTURE_2D, nutsEdit10Texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nutsEdit10TexWidth, nutsEdit10TexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nutsEdit10Image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(nutsEdit10Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	nutTexList[9] = nutsEdit10Texture;
-
-	GLuint nutsEdit11Texture;
-	glGenTextures(1, &nutsEdit11Texture);
-	glBindTexture(GL_TEXTURE_2D, nutsEdit11Texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nutsEdit11TexWidth, nutsEdit11TexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nutsEdit11Image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(nutsEdit11Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	nutTexList[10] = nutsEdit11Texture;
-
-	GLuint nutsEdit12Texture;
-	glGenTextures(1, &nutsEdit12Texture);
-	glBindTexture(GL_TEXTURE_2D, nutsEdit12Texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nutsEdit12TexWidth, nutsEdit12TexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nutsEdit12Image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(nutsEdit12Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	nutTexList[11] = nutsEdit12Texture;
-
-	GLuint nutsEdit13Texture;
-	glGenTextures(1, &nutsEdit13Texture);
-	glBindTexture(GL_TEXTURE_2D, nutsEdit13Texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nutsEdit13TexWidth, nutsEdit13TexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nutsEdit13Image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(nutsEdit13Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	nutTexList[12] = nutsEdit13Texture;
-
-	GLuint nutsEdit14Texture;
-	glGenTextures(1, &nutsEdit14Texture);
-	glBindTexture(GL_TEXTURE_2D, nutsEdit14Texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nutsEdit14TexWidth, nutsEdit14TexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nutsEdit14Image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(nutsEdit14Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	nutTexList[13] = nutsEdit14Texture;
-
-	GLuint nutsEdit15Texture;
-	glGenTextures(1, &nutsEdit15Texture);
-	glBindTexture(GL_TEXTURE_2D, nutsEdit15Texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nutsEdit15TexWidth, nutsEdit15TexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nutsEdit15Image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(nutsEdit15Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	nutTexList[14] = nutsEdit15Texture;
-
-	GLuint nutsEdit16Texture;
-	glGenTextures(1, &nutsEdit16Texture);
-	glBindTexture(GL_TEXTURE_2D, nutsEdit16Texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nutsEdit16TexWidth, nutsEdit16TexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nutsEdit16Image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(nutsEdit16Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	nutTexList[15] = nutsEdit16Texture;
-
-	GLuint nutsEdit17Texture;
-	glGenTextures(1, &nutsEdit17Texture);
-	glBindTexture(GL_TEXTURE_2D, nutsEdit17Texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nutsEdit17TexWidth, nutsEdit17TexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nutsEdit17Image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(nutsEdit17Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	nutTexList[16] = nutsEdit17Texture;
-
-	GLuint nutsEdit18Texture;
-	glGenTextures(1, &nutsEdit18Texture);
-	glBindTexture(GL_TEXTURE_2D, nutsEdit18Texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nutsEdit18TexWidth, nutsEdit18TexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nutsEdit18Image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(nutsEdit18Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	nutTexList[17] = nutsEdit18Texture;
-
-	GLuint nutsEdit19Texture;
-	glGenTextures(1, &nutsEdit19Texture);
-	glBindTexture(GL_TEXTURE_2D, nutsEdit19Texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nutsEdit19TexWidth, nutsEdit19TexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nutsEdit19Image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(nutsEdit19Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	nutTexList[18] = nutsEdit19Texture;
-
-	GLuint nutsEdit20Texture;
-	glGenTextures(1, &nutsEdit20Texture);
-	glBindTexture(GL_TEXTURE_2D, nutsEdit20Texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nutsEdit20TexWidth, nutsEdit20TexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nutsEdit20Image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(nutsEdit20Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	nutTexList[19] = nutsEdit20Texture;
-
-	GLuint nutsEdit21Texture;
-	glGenTextures(1, &nutsEdit21Texture);
-	glBindTexture(GL_TEXTURE_2D, nutsEdit21Texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nutsEdit21TexWidth, nutsEdit21TexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nutsEdit21Image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(nutsEdit21Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	nutTexList[20] = nutsEdit21Texture;
-
-	GLuint nutsEdit22Texture;
-	glGenTextures(1, &nutsEdit22Texture);
-	glBindTexture(GL_TEXTURE_2D, nutsEdit22Texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nutsEdit22TexWidth, nutsEdit22TexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nutsEdit22Image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(nutsEdit22Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	nutTexList[21] = nutsEdit22Texture;
-
-	GLuint nutsEdit23Texture;
-	glGenTextures(1, &nutsEdit23Texture);
-	glBindTexture(GL_TEXTURE_2D, nutsEdit23Texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nutsEdit23TexWidth, nutsEdit23TexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nutsEdit23Image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(nutsEdit23Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	nutTexList[22] = nutsEdit23Texture;
-
-	GLuint nutsEdit24Texture;
-	glGenTextures(1, &nutsEdit24Texture);
-	glBindTexture(GL_TEXTURE_2D, nutsEdit24Texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nutsEdit24TexWidth, nutsEdit24TexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nutsEdit24Image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(nutsEdit24Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	nutTexList[23] = nutsEdit24Texture;
-
-	GLuint woodTexture;
-	glm::vec3 woodColor;
-	glGenTextures(1, &woodTexture);
-	glBindTexture(GL_TEXTURE_2D, woodTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, woodTexWidth, woodTexHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, woodImage);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	woodColor = glm::vec3(0.27f, 0.21f, 0.13f);
-	SOIL_free_image_data(woodImage);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	StaticBatch sceneBatch = sceneBatchBuilder.build();
+	cout << "Scene vertex buffer: " << sceneBatch.mesh.vertexCount * sceneBatch.mesh.vertexStride / 1024 << " KB packed, "
+		<< sceneBatch.mesh.vertexCount * vertexFormat(FLOAT_VERTEX_LAYOUT).stride / 1024 << " KB as floats" << endl;
+
+	// The indirect path keeps each object separate and draws them all from shared buffers
+	IndirectDrawList sceneDrawList;
+	for (size_t i = 0; i < sceneMeshes.size(); i++)
+		sceneDrawList.addMesh(sceneMeshes[i]);
+	for (size_t i = 0; i < sceneMaterials.size(); i++)
+		sceneDrawList.addMaterial(sceneMaterials[i], max((int)sceneDescription.textures[sceneDescription.materials[i].texture].layers, 1));
+	sceneDrawList.upload();
+
+	// Needs gl_DrawID; the scene's textures are resampled into one array texture, so any number of them fit
+	GLint maxTextureUnits = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &maxTextureUnits);
+	indirectDrawsSupported = GLEW_ARB_multi_draw_indirect && GLEW_ARB_shader_draw_parameters;
+
+	// Shadow maps stay bound to the last texture unit, clear of every other pass
+	GLint shadowMapUnit = maxTextureUnits - 1;
+
+	if (!indirectDrawsSupported) {
+		if (useIndirectDraws)
+			cout << "Indirect draws are not supported, using the batched renderer" << endl;
+		useIndirectDraws = false;
+	}
 
 	// Vertex shader source code
 	string vertexShaderSource =
 		"#version 430 core\n"
 		"layout(location = 0) in vec3 aPos;\n"
-		"layout(location = 1) in vec3 aColor;\n"
-		"layout(location = 2) in vec2 texCoord;\n"
-		"layout(location = 3) in vec3 normal;\n"
-		"out vec3 oColor;\n"
+		"layout(location = 1) in vec2 texCoord;\n"
+		"layout(location = 2) in vec3 normal;\n"
 		"out vec2 oTexCoord;\n"
 		"out vec3 oNormal;\n"
 		"out vec3 fragPos;\n"
-		"uniform mat4 model;\n"
-		"uniform mat4 view;\n"
-		"uniform mat4 projection;\n"
+		+ frameDataBlock
+		+ drawUniformsBlock +
 		"void main() {\n"
 		"gl_Position = projection * view * model * vec4(aPos, 1.0);\n"
-		"oColor = aColor;\n"
-		"oTexCoord = texCoord;\n"
-		"oNormal = mat3(transpose(inverse(model))) * normal;\n"
+		"oTexCoord = texCoord * texCoordTransform.xy + texCoordTransform.zw;\n"
+		"oNormal = normalMatrix * normal;\n"
 		"fragPos = vec3(model * vec4(aPos, 1.0));\n"
 		"}";
 
 	// Fragment shader source code
 	string fragmentShaderSource =
 		"#version 430 core\n"
-		"in vec3 oColor;\n"
 		"in vec2 oTexCoord;\n"
 		"in vec3 oNormal;\n"
 		"in vec3 fragPos;\n"
 		"out vec4 fragColor;\n"
 		"uniform sampler2D myTexture;\n"
-		"uniform vec3 objectColor;\n"
-		"uniform vec3 lightColor1;\n"
-		"uniform vec3 lightPos1;\n"
-		"uniform vec3 lightColor2;\n"
-		"uniform vec3 lightPos2;\n"
-		"uniform vec3 lightColor3;\n"
-		"uniform vec3 lightPos3;\n"
-		"uniform vec3 viewPos;\n"
+		"uniform sampler2DArray myTextureArray;\n"
+		+ frameDataBlock
+		+ drawUniformsBlock
+		+ lightDataBlock
+		+ lightingFunction
+		+ surfaceNormalFunction +
+		"void main() {\n"
+		"vec3 result = lighting(surfaceNormal(oNormal, fragPos), fragPos) * objectColor.rgb;\n"
+		"// Array textures take one layer per repeat of u; gradients come from the unwrapped coordinates\n"
+		"vec4 texColor;\n"
+		"if (useTextureArray != 0)\n"
+		"texColor = textureGrad(myTextureArray, vec3(fract(oTexCoord.x), oTexCoord.y, floor(oTexCoord.x)), dFdx(oTexCoord), dFdy(oTexCoord));\n"
+		"else\n"
+		"texColor = texture(myTexture, oTexCoord);\n"
+		"fragColor = texColor * vec4(result, 1.0);\n"
+		"}";
+
+	// G-buffer fragment shader source code; stores albedo and normal for the deferred lighting pass
+	string gBufferFragmentShaderSource =
+		"#version 430 core\n"
+		"in vec2 oTexCoord;\n"
+		"in vec3 oNormal;\n"
+		"in vec3 fragPos;\n"
+		"layout(location = 0) out vec4 gAlbedo;\n"
+		"layout(location = 1) out vec4 gNormal;\n"
+		"uniform sampler2D myTexture;\n"
+		"uniform sampler2DArray myTextureArray;\n"
+		+ drawUniformsBlock
+		+ surfaceNormalFunction +
+		"void main() {\n"
+		"vec4 texColor;\n"
+		"if (useTextureArray != 0)\n"
+		"texColor = textureGrad(myTextureArray, vec3(fract(oTexCoord.x), oTexCoord.y, floor(oTexCoord.x)), dFdx(oTexCoord), dFdy(oTexCoord));\n"
+		"else\n"
+		"texColor = texture(myTexture, oTexCoord);\n"
+		"gAlbedo = texColor * vec4(objectColor.rgb, 1.0);\n"
+		"gNormal = vec4(surfaceNormal(oNormal, fragPos), 0.0);\n"
+		"}";
+
+	// Indirect vertex shader source code; gl_DrawID selects the draw's transform and material
+	string indirectVertexShaderSource =
+		"#version 430 core\n"
+		"#extension GL_ARB_shader_draw_parameters : require\n"
+		"layout(location = 0) in vec3 aPos;\n"
+		"layout(location = 1) in vec2 texCoord;\n"
+		"layout(location = 2) in vec3 normal;\n"
+		"out vec2 oTexCoord;\n"
+		"out vec3 oNormal;\n"
+		"out vec3 fragPos;\n"
+		"flat out int drawID;\n"
+		+ frameDataBlock
+		+ drawDataBlock +
+		"void main() {\n"
+		"DrawData draw = draws[gl_DrawIDARB];\n"
+		"fragPos = vec3(draw.model * vec4(aPos, 1.0));\n"
+		"gl_Position = projection * view * vec4(fragPos, 1.0);\n"
+		"oTexCoord = texCoord * draw.texCoordTransform.xy + draw.texCoordTransform.zw;\n"
+		"oNormal = draw.normalMatrix * normal;\n"
+		"drawID = gl_DrawIDARB;\n"
+		"}";
+
+	// Indirect fragment shader source code; every texture is a range of layers in one array texture, so the draw picks
+	// a layer instead of a sampler
+	string indirectFragmentShaderSource =
+		"#version 430 core\n"
+		"in vec2 oTexCoord;\n"
+		"in vec3 oNormal;\n"
+		"in vec3 fragPos;\n"
+		"flat in int drawID;\n"
+		"out vec4 fragColor;\n"
+		"uniform sampler2DArray drawTextures;\n"
+		+ frameDataBlock
+		+ drawDataBlock
+		+ lightDataBlock
+		+ lightingFunction
+		+ drawTextureFunction +
+		"void main() {\n"
+		"DrawData draw = draws[drawID];\n"
+		"vec3 result = lighting(normalize(oNormal), fragPos) * draw.color.rgb;\n"
+		"fragColor = drawTexture(draw) * vec4(result, 1.0);\n"
+		"}";
+
+	// Indirect G-buffer fragment shader source code
+	string indirectGBufferFragmentShaderSource =
+		"#version 430 core\n"
+		"in vec2 oTexCoord;\n"
+		"in vec3 oNormal;\n"
+		"in vec3 fragPos;\n"
+		"flat in int drawID;\n"
+		"layout(location = 0) out vec4 gAlbedo;\n"
+		"layout(location = 1) out vec4 gNormal;\n"
+		"uniform sampler2DArray drawTextures;\n"
+		+ drawDataBlock
+		+ drawTextureFunction +
 		"void main() {\n"
-		"// Ambient\n"
-		"float ambientStrength = 1.0f;\n"
-		"vec3 ambient1 = ambientStrength * lightColor1;\n"
-		"vec3 ambient2 = 0.3 * ambientStrength * lightColor2;\n"
-		"vec3 ambient3 = 0.5 * ambientStrength * lightColor3;\n"
-		"vec3 ambient = ambient1 + ambient2 + ambient3;\n"
-		"// Diffuse\n"
-		"vec3 norm = normalize(oNormal);\n"
-		"vec3 lightDir1 = normalize(lightPos1 - fragPos);\n"
-		"vec3 lightDir2 = normalize(lightPos2 - fragPos);\n"
-		"vec3 lightDir3 = normalize(lightPos3 - fragPos);\n"
-		"float diff1 = max(dot(norm, lightDir1), 0.0);\n"
-		"float diff2 = max(dot(norm, lightDir2), 0.0);\n"
-		"float diff3 = max(dot(norm, lightDir3), 0.0);\n"
-		"vec3 diffuse1 = diff1 * 4.0 * lightColor1;\n"
-		"vec3 diffuse2 = diff2 * lightColor2;\n"
-		"vec3 diffuse3 = diff3 * 2.0 * lightColor3;\n"
-		"vec3 diffuse = diffuse1 + diffuse2 + diffuse3;\n"
-		"// Specular\n"
-		"float specularStrength = 1.5f;\n"
-		"vec3 viewDir = normalize(viewPos - fragPos);\n"
-		"vec3 reflectDir1 = reflect(-lightDir1, norm);\n"
-		"vec3 reflectDir2 = reflect(-lightDir2, norm);\n"
-		"vec3 reflectDir3 = reflect(-lightDir3, norm);\n"
-		"float spec1 = pow(max(dot(viewDir, reflectDir1), 0.0), 16);\n"
-		"float spec2 = pow(max(dot(viewDir, reflectDir2), 0.0), 8);\n"
-		"float spec3 = pow(max(dot(viewDir, reflectDir3), 0.0), 16);\n"
-		"vec3 specular1 = specularStrength * spec1 * lightColor1;\n"
-		"vec3 specular2 = specularStrength  * 0.5 * spec2 * lightColor2;\n"
-		"vec3 specular3 = specularStrength * spec3 * lightColor3;\n"
-		"vec3 specular = specular1 + specular2 + specular3;\n"
-		"vec3 result = (ambient + diffuse + specular) * objectColor;\n"
-		"fragColor = texture(myTexture, oTexCoord) * vec4(result, 1.0);\n"
+		"DrawData draw = draws[drawID];\n"
+		"gAlbedo = drawTexture(draw) * vec4(draw.color.rgb, 1.0);\n"
+		"gNormal = vec4(normalize(oNormal), 0.0);\n"
 		"}";
 
-	// Lamp Vertex shader source code
+	// Deferred lighting vertex shader source code; one triangle covering the screen, from gl_VertexID
+	string deferredVertexShaderSource =
+		"#version 430 core\n"
+		"void main() {\n"
+		"vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+		"gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);\n"
+		"}";
+
+	// Texture layer fragment shader source code; resamples a scene texture into its layer of the indirect draws' array
+	// texture, drawn with the deferred lighting vertex shader's triangle
+	string textureLayerFragmentShaderSource =
+		"#version 430 core\n"
+		"out vec4 fragColor;\n"
+		"uniform sampler2D source;\n"
+		"uniform sampler2DArray sourceArray;\n"
+		"uniform int sourceLayer;\n"
+		"void main() {\n"
+		"vec2 texCoord = gl_FragCoord.xy / " + to_string(INDIRECT_TEXTURE_SIZE) + ".0;\n"
+		"fragColor = sourceLayer < 0 ? texture(source, texCoord) : texture(sourceArray, vec3(texCoord, sourceLayer));\n"
+		"}";
+
+	// Deferred lighting fragment shader source code; rebuilds each pixel's world position from the G-buffer depth
+	string deferredFragmentShaderSource =
+		"#version 430 core\n"
+		"out vec4 fragColor;\n"
+		"uniform sampler2D gAlbedo;\n"
+		"uniform sampler2D gNormal;\n"
+		"uniform sampler2D gDepth;\n"
+		+ frameDataBlock
+		+ lightDataBlock
+		+ lightingFunction +
+		"void main() {\n"
+		"ivec2 pixel = ivec2(gl_FragCoord.xy);\n"
+		"float depth = texelFetch(gDepth, pixel, 0).r;\n"
+		"if (depth == 1.0)\n"
+		"discard;\n"
+		"vec4 viewPoint = inverseProjection * vec4(gl_FragCoord.xy / screenSize.xy * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);\n"
+		"vec3 fragPos = vec3(inverseView * vec4(viewPoint.xyz / viewPoint.w, 1.0));\n"
+		"vec4 albedo = texelFetch(gAlbedo, pixel, 0);\n"
+		"vec3 norm = normalize(texelFetch(gNormal, pixel, 0).xyz);\n"
+		"fragColor = vec4(lighting(norm, fragPos) * albedo.rgb, albedo.a);\n"
+		"// Keep the scene's depth so lamps drawn afterwards are hidden behind it\n"
+		"gl_FragDepth = depth;\n"
+		"}";
+
+	// Shadow vertex shader source code
+	string shadowVertexShaderSource =
+		"#version 430 core\n"
+		"layout(location = 0) in vec3 aPos;\n"
+		"out vec3 worldPos;\n"
+		+ drawUniformsBlock +
+		"uniform mat4 lightViewProjection;\n"
+		"void main() {\n"
+		"worldPos = vec3(model * vec4(aPos, 1.0));\n"
+		"gl_Position = lightViewProjection * vec4(worldPos, 1.0);\n"
+		"}";
+
+	// Shadow fragment shader source code; depth is the distance to the light over its range
+	string shadowFragmentShaderSource =
+		"#version 430 core\n"
+		"in vec3 worldPos;\n"
+		"uniform vec4 lightPositionRange;\n"
+		"void main() {\n"
+		"gl_FragDepth = length(worldPos - lightPositionRange.xyz) / lightPositionRange.w;\n"
+		"}";
+
+	// Lamp Vertex shader source code; each instance is a small cube at a light's position, in the light's color
 	string lampVertexShaderSource =
 		"#version 430 core\n"
 		"layout(location = 0) in vec3 aPos;\n"
-		"uniform mat4 model;\n"
-		"uniform mat4 view;\n"
-		"uniform mat4 projection;\n"
+		"layout(location = 4) in vec3 lightPosition;\n"
+		"layout(location = 5) in vec3 lightColor;\n"
+		"flat out vec3 lampColor;\n"
+		+ frameDataBlock +
 		"void main() {\n"
-		"gl_Position = projection * view * model * vec4(aPos, 1.0);\n"
+		"gl_Position = projection * view * vec4(lightPosition + aPos * 0.125, 1.0);\n"
+		"lampColor = lightColor;\n"
 		"}";
 
 	// Lamp Fragment shader source code
 	string lampFragmentShaderSource =
 		"#version 430 core\n"
+		"flat in vec3 lampColor;\n"
 		"out vec4 fragColor;\n"
-		"uniform vec3 lampColor;\n"
 		"void main() {\n"
 		"fragColor = vec4(lampColor, 1.0);\n"
 		"}";
 
+	// Text overlay vertex shader source code; each instance is one character cell with its corners generated from gl_VertexID
+	string textVertexShaderSource =
+		"#version 430 core\n"
+		"layout(location = 0) in ivec3 aCell;\n"
+		+ frameDataBlock +
+		"out vec2 cellPos;\n"
+		"flat out int glyph;\n"
+		"uniform int scale;\n"
+		"const vec2 CELL_SIZE = vec2(" + to_string(TEXT_CELL_WIDTH) + ".0, " + to_string(TEXT_CELL_HEIGHT) + ".0);\n"
+		"const vec2 corners[6] = vec2[](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0));\n"
+		"void main() {\n"
+		"cellPos = corners[gl_VertexID] * CELL_SIZE;\n"
+		"glyph = aCell.z;\n"
+		"vec2 pixel = (vec2(aCell.xy) * CELL_SIZE + cellPos) * float(scale) + vec2(8.0);\n"
+		"gl_Position = vec4(pixel.x / screenSize.x * 2.0 - 1.0, 1.0 - pixel.y / screenSize.y * 2.0, 0.0, 1.0);\n"
+		"}";
+
+	// Text overlay fragment shader source code; white glyphs from the font texture over a translucent background
+	string textFragmentShaderSource =
+		"#version 430 core\n"
+		"in vec2 cellPos;\n"
+		"flat in int glyph;\n"
+		"out vec4 fragColor;\n"
+		"uniform sampler2D font;\n"
+		"void main() {\n"
+		"ivec2 pixel = ivec2(cellPos) - ivec2(0, 1);\n"
+		"float ink = 0.0;\n"
+		"if (pixel.x < 5 && pixel.y >= 0 && pixel.y < 7)\n"
+		"ink = texelFetch(font, ivec2(glyph * 5 + pixel.x, pixel.y), 0).r;\n"
+		"fragColor = mix(vec4(0.0, 0.0, 0.0, 0.6), vec4(1.0), ink);\n"
+		"}";
+
+	// Light culling compute shader source code; one invocation per cluster collects the lights whose range reaches its box
+	string lightCullComputeShaderSource =
+		"#version 430 core\n"
+		"layout(local_size_x = 64) in;\n"
+		+ frameDataBlock
+		+ lightDataBlock +
+		"const uint CLUSTER_CAPACITY = " + to_string(CLUSTER_COUNT * CLUSTER_AVERAGE_LIGHTS) + "u;\n"
+		"// View-space point at depth z on the line through a screen position; straight through the eye or parallel for ortho\n"
+		"vec3 pointAtDepth(vec2 ndc, float z) {\n"
+		"vec4 nearPoint = inverseProjection * vec4(ndc, -1.0, 1.0);\n"
+		"vec4 farPoint = inverseProjection * vec4(ndc, 1.0, 1.0);\n"
+		"vec3 a = nearPoint.xyz / nearPoint.w;\n"
+		"vec3 b = farPoint.xyz / farPoint.w;\n"
+		"return mix(a, b, (-z - a.z) / (b.z - a.z));\n"
+		"}\n"
+		"bool touches(uint light, vec3 boxMin, vec3 boxMax) {\n"
+		"vec3 center = (view * vec4(lights[light].position.xyz, 1.0)).xyz;\n"
+		"vec3 outside = max(max(boxMin - center, center - boxMax), 0.0);\n"
+		"return dot(outside, outside) <= lights[light].position.w * lights[light].position.w;\n"
+		"}\n"
+		"void main() {\n"
+		"uint cluster = gl_GlobalInvocationID.x;\n"
+		"if (cluster >= CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z)\n"
+		"return;\n"
+		"uvec3 id = uvec3(cluster % CLUSTER_GRID_X, cluster / CLUSTER_GRID_X % CLUSTER_GRID_Y, cluster / (CLUSTER_GRID_X * CLUSTER_GRID_Y));\n"
+		"// Bounding box of the tile between its depth slice's planes\n"
+		"vec2 ndcMin = vec2(id.xy) / vec2(CLUSTER_GRID_X, CLUSTER_GRID_Y) * 2.0 - 1.0;\n"
+		"vec2 ndcMax = vec2(id.xy + 1u) / vec2(CLUSTER_GRID_X, CLUSTER_GRID_Y) * 2.0 - 1.0;\n"
+		"float zNear = clusterDepth.x * exp(float(id.z) / clusterDepth.z);\n"
+		"float zFar = clusterDepth.x * exp(float(id.z + 1u) / clusterDepth.z);\n"
+		"vec3 boxMin = vec3(1e30);\n"
+		"vec3 boxMax = vec3(-1e30);\n"
+		"for (int i = 0; i < 4; i++) {\n"
+		"vec2 ndc = vec2((i & 1) != 0 ? ndcMax.x : ndcMin.x, (i & 2) != 0 ? ndcMax.y : ndcMin.y);\n"
+		"vec3 a = pointAtDepth(ndc, zNear);\n"
+		"vec3 b = pointAtDepth(ndc, zFar);\n"
+		"boxMin = min(boxMin, min(a, b));\n"
+		"boxMax = max(boxMax, max(a, b));\n"
+		"}\n"
+		"// Count, reserve space in the index list, then write\n"
+		"uint count = 0u;\n"
+		"for (uint i = 0u; i < uint(lightCount); i++)\n"
+		"if (touches(i, boxMin, boxMax))\n"
+		"count++;\n"
+		"uint offset = atomicAdd(lightIndexCount, count);\n"
+		"count = min(count, CLUSTER_CAPACITY - min(offset, CLUSTER_CAPACITY));\n"
+		"uint written = 0u;\n"
+		"for (uint i = 0u; i < uint(lightCount) && written < count; i++)\n"
+		"if (touches(i, boxMin, boxMax))\n"
+		"lightIndices[offset + written++] = i;\n"
+		"clusters[cluster] = uvec2(offset, count);\n"
+		"}";
+
 	// Creating shader program
-	GLuint shaderProgram = createShaderProgram(vertexShaderSource, fragmentShaderSource);
-	GLuint lampShaderProgram = createShaderProgram(lampVertexShaderSource, lampFragmentShaderSource);
+	ShaderProgram shaderProgram(vertexShaderSource, fragmentShaderSource);
+	ShaderProgram gBufferShaderProgram(vertexShaderSource, gBufferFragmentShaderSource);
+	ShaderProgram deferredShaderProgram(deferredVertexShaderSource, deferredFragmentShaderSource);
+	ShaderProgram lightCullProgram(lightCullComputeShaderSource);
+	ShaderProgram shadowShaderProgram(shadowVertexShaderSource, shadowFragmentShaderSource);
+	ShaderProgram lampShaderProgram(lampVertexShaderSource, lampFragmentShaderSource);
+	ShaderProgram textShaderProgram(textVertexShaderSource, textFragmentShaderSource);
+
+	// Array textures are sampled from texture unit 1
+	const ShaderProgram* batchPrograms[] = { &shaderProgram, &gBufferShaderProgram };
+	for (int i = 0; i < 2; i++) {
+		glUseProgram(batchPrograms[i]->id());
+		glUniform1i(batchPrograms[i]->uniform("myTextureArray"), 1);
+	}
 
-	init(window);
+	// G-buffer albedo, normal and depth on units 0 to 2
+	glUseProgram(deferredShaderProgram.id());
+	glUniform1i(deferredShaderProgram.uniform("gAlbedo"), 0);
+	glUniform1i(deferredShaderProgram.uniform("gNormal"), 1);
+	glUniform1i(deferredShaderProgram.uniform("gDepth"), 2);
+	glUseProgram(0);
+
+	// Overlay text at twice the font's size, font on unit 0
+	glUseProgram(textShaderProgram.id());
+	glUniform1i(textShaderProgram.uniform("font"), 0);
+	glUniform1i(textShaderProgram.uniform("scale"), 2);
+	glUseProgram(0);
+
+	GLint lightViewProjectionLoc = shadowShaderProgram.uniform("lightViewProjection");
+	GLint lightPositionRangeLoc = shadowShaderProgram.uniform("lightPositionRange");
+
+	// Render queue materials, one per batch range
+	vector<QueueMaterial> queueMaterials;
+	vector<uint32_t> rangeTextureRanks;
+	for (size_t i = 0; i < sceneBatch.ranges.size(); i++) {
+		const BatchMaterial& material = sceneBatch.ranges[i].material;
+		QueueMaterial queueMaterial;
+		queueMaterial.color = material.color;
+		queueMaterial.textureArray = material.textureArray;
+		queueMaterials.push_back(queueMaterial);
+
+		// Sort keys use the texture's position in the scene, starting from 1
+		rangeTextureRanks.push_back((uint32_t)(find(sceneTextures.begin(), sceneTextures.end(), material.texture) - sceneTextures.begin()) + 1);
+	}
 
-	while (!glfwWindowShouldClose(window)) {
-		// Set deltaTime
-		GLfloat currentFrame = glfwGetTime();
-		deltaTime = currentFrame - lastFrame;
-		lastFrame = currentFrame;
+	// Model materials follow, each model's list ending with the glTF default material for primitives that name none
+	vector<ModelDraw> modelDraws;
+	for (size_t i = 0; i < models.size(); i++) {
+		int firstMaterial = (int)queueMaterials.size();
+		for (size_t j = 0; j <= models[i].materials.size(); j++) {
+			QueueMaterial queueMaterial;
+			queueMaterial.color = j < models[i].materials.size() ? models[i].materials[j].color : glm::vec3(1.0f);
+			queueMaterial.textureArray = false;
+			queueMaterials.push_back(queueMaterial);
+		}
 
-		// Process input each frame
-		processInput(window);
+		for (size_t j = 0; j < models[i].instances.size(); j++) {
+			const GltfInstance& instance = models[i].instances[j];
+			const GltfPrimitive& primitive = models[i].primitives[instance.primitive];
+			int material = primitive.material >= 0 ? primitive.material : (int)models[i].materials.size();
+			GLuint texture = primitive.material >= 0 ? modelTextures[i][primitive.material] : 0;
+
+			ModelDraw modelDraw;
+			modelDraw.primitive = &primitive;
+			modelDraw.node = modelNodeBase[i] + instance.node;
+			modelDraw.material = firstMaterial + material;
+			modelDraw.texture = texture != 0 ? texture : whiteTexture;
+			modelDraw.textureRank = texture != 0 ? (uint32_t)(find(sceneTextures.begin(), sceneTextures.end(), texture) - sceneTextures.begin()) + 1 : 0;
+			modelDraws.push_back(modelDraw);
+		}
+	}
 
-		glfwGetFramebufferSize(window, &width, &height);
-		glViewport(0, 0, width, height);
+	// Scene materials for the moving objects follow
+	int firstSceneMaterial = (int)queueMaterials.size();
+	for (size_t i = 0; i < sceneMaterials.size(); i++) {
+		QueueMaterial queueMaterial;
+		queueMaterial.color = sceneMaterials[i].color;
+		queueMaterial.textureArray = sceneMaterials[i].textureArray;
+		queueMaterials.push_back(queueMaterial);
+	}
 
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	// glTF attributes are drawn as stored, normalized types already in their own units
+	const VertexDecode modelDecode = { glm::mat4(1.0f), glm::vec4(1.0f, 1.0f, 0.0f, 0.0f) };
 
-		// Use shader program executable
-		glUseProgram(shaderProgram);
+	// Culling volumes: scene objects, batch ranges, then model primitives
+	vector<MeshBounds> meshBounds;
+	for (size_t i = 0; i < sceneMeshes.size(); i++)
+		meshBounds.push_back(computeBounds(sceneMeshes[i]));
 
-		/*
-			Draw Plane
-		*/
+	CullingVolumes cullingVolumes;
+	for (size_t i = 0; i < sceneDescription.objects.size(); i++) {
+		const SceneObjectRecord& object = sceneDescription.objects[i];
+		cullingVolumes.add(transformBounds(meshBounds[object.mesh], scene.world(object.node)));
+	}
 
-		// Declare identity matrices
-		glm::mat4 modelMatrix = glm::mat4(1.0f);
-		glm::mat4 projectionMatrix = glm::mat4(1.0f);
+	size_t firstRangeVolume = cullingVolumes.size();
+	for (size_t i = 0; i < sceneBatch.ranges.size(); i++)
+		cullingVolumes.add(sceneBatch.ranges[i].bounds);
+
+	size_t firstModelVolume = cullingVolumes.size();
+	for (size_t i = 0; i < modelDraws.size(); i++)
+		cullingVolumes.add(transformBounds(modelDraws[i].primitive->bounds, scene.world(modelDraws[i].node)));
+
+	vector<uint8_t> visible;
+
+	RenderQueue renderQueue;
+	RenderQueue objectQueue;
+	vector<QueueObject> queueObjects;
+	RenderStateCache renderState;
+
+	// Indirect programs, sampling the array texture the draw list binds to unit 0, and the program filling its layers
+	unique_ptr<ShaderProgram> indirectShaderProgram;
+	unique_ptr<ShaderProgram> indirectGBufferShaderProgram;
+	unique_ptr<ShaderProgram> textureLayerProgram;
+	if (indirectDrawsSupported) {
+		indirectShaderProgram.reset(new ShaderProgram(indirectVertexShaderSource, indirectFragmentShaderSource));
+		indirectGBufferShaderProgram.reset(new ShaderProgram(indirectVertexShaderSource, indirectGBufferFragmentShaderSource));
+		textureLayerProgram.reset(new ShaderProgram(deferredVertexShaderSource, textureLayerFragmentShaderSource));
+
+		glUseProgram(indirectShaderProgram->id());
+		glUniform1i(indirectShaderProgram->uniform("shadowMaps"), shadowMapUnit);
+
+		const ShaderProgram* indirectPrograms[] = { indirectShaderProgram.get(), indirectGBufferShaderProgram.get() };
+		for (int i = 0; i < 2; i++) {
+			glUseProgram(indirectPrograms[i]->id());
+			glUniform1i(indirectPrograms[i]->uniform("drawTextures"), 0);
+		}
 
-		// Initialize transforms
-		viewMatrix = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+		glUseProgram(textureLayerProgram->id());
+		glUniform1i(textureLayerProgram->uniform("source"), 0);
+		glUniform1i(textureLayerProgram->uniform("sourceArray"), 1);
+		glUseProgram(0);
+	}
 
-		projectionMatrix = getProjection();
+	// Loader version of each scene texture when its indirect layers were last filled
+	vector<unsigned> indirectTextureVersions(sceneTextures.size(), ~0u);
 
-		// Get object color, light color, and light position location
-		GLuint objectColorLoc = glGetUniformLocation(shaderProgram, "objectColor");
-		GLuint lightColor1Loc = glGetUniformLocation(shaderProgram, "lightColor1");
-		GLuint lightPos1Loc = glGetUniformLocation(shaderProgram, "lightPos1");
-		GLuint lightColor2Loc = glGetUniformLocation(shaderProgram, "lightColor2");
-		GLuint lightPos2Loc = glGetUniformLocation(shaderProgram, "lightPos2");
-		GLuint lightColor3Loc = glGetUniformLocation(shaderProgram, "lightColor3");
-		GLuint lightPos3Loc = glGetUniformLocation(shaderProgram, "lightPos3");
-		GLuint viewPosLoc = glGetUniformLocation(shaderProgram, "viewPos");
+	GBuffer gBuffer;
 
-		// Assign light color
-		glUniform3f(lightColor1Loc, 1.0f, 1.0f, 1.0f);
-		glUniform3f(lightColor2Loc, 1.0f, 0.0f, 0.0f);
-		glUniform3f(lightColor3Loc, 0.0f, 0.0f, 1.0f);
+	const ShaderCacheStats& shaderStats = shaderCacheStats();
+	cout << "Shader programs: " << shaderStats.loaded << " from cache in " << shaderStats.loadMs << " ms, "
+		<< shaderStats.compiled << " compiled in " << shaderStats.compileMs << " ms";
+	if (shaderStats.rejected > 0)
+		cout << " (" << shaderStats.rejected << " cached binaries rejected)";
+	cout << endl;
 
-		// Set Light Position
-		glUniform3f(lightPos1Loc, lightPosition1.x, lightPosition1.y, lightPosition1.z);
-		glUniform3f(lightPos2Loc, lightPosition2.x, lightPosition2.y, lightPosition2.z);
-		glUniform3f(lightPos3Loc, lightPosition3.x, lightPosition3.y, lightPosition3.z);
+	// The scene's own lights cast shadows; the orbiting extras do not
+	vector<int> shadowLights;
+	for (GLint i = 0; i < lightCount && (int)shadowLights.size() < MAX_SHADOWED_LIGHTS; i++) {
+		if (lightOrbits[i].speed == 0.0f)
+			shadowLights.push_back(i);
+	}
 
-		// Specify View Position
-		glUniform3f(viewPosLoc, cameraPos.x, cameraPos.y, cameraPos.z);
+	ShadowMaps shadowMaps(SHADOW_MAP_SIZE, (int)shadowLights.size());
+	vector<glm::vec4> shadowLightPositions(shadowLights.size());
 
-		// Select shader and uniform variable
-		GLuint modelLoc = glGetUniformLocation(shaderProgram, "model");
-		GLuint viewLoc = glGetUniformLocation(shaderProgram, "view");
-		GLuint projectionLoc = glGetUniformLocation(shaderProgram, "projection");
+	glActiveTexture(GL_TEXTURE0 + shadowMapUnit);
+	glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, shadowMaps.texture());
+	glActiveTexture(GL_TEXTURE0);
 
-		// Pass transform to shader
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-		glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(viewMatrix));
-		glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+	const ShaderProgram* shadowedPrograms[] = { &shaderProgram, &deferredShaderProgram };
+	for (int i = 0; i < 2; i++) {
+		glUseProgram(shadowedPrograms[i]->id());
+		glUniform1i(shadowedPrograms[i]->uniform("shadowMaps"), shadowMapUnit);
+	}
+	glUseProgram(0);
+
+	// Casters are drawn per object so nodes that move are seen where they are: scene objects, then model primitives
+	vector<Mesh> casterMeshes;
+	for (size_t i = 0; i < sceneMeshes.size(); i++)
+		casterMeshes.push_back(uploadMesh(sceneMeshes[i]));
+
+	vector<ShadowCaster> shadowCasters;
+	for (size_t i = 0; i < sceneDescription.objects.size(); i++) {
+		const SceneObjectRecord& object = sceneDescription.objects[i];
+		const Mesh& mesh = casterMeshes[object.mesh];
+		ShadowCaster caster = { mesh.vao, mesh.indexType, mesh.indexCount, 0, (int)object.node, mesh.decode, meshBounds[object.mesh], (int)i };
+		shadowCasters.push_back(caster);
+	}
 
-		glBindVertexArray(squareVAO); // Bind VAO
+	size_t firstModelCaster = shadowCasters.size();
+	for (size_t i = 0; i < modelDraws.size(); i++) {
+		const GltfPrimitive& primitive = *modelDraws[i].primitive;
+		ShadowCaster caster = { primitive.vao, primitive.indexType, primitive.indexCount, primitive.indexOffset, modelDraws[i].node, modelDecode,
+			primitive.bounds, (int)(firstModelVolume + i) };
+		shadowCasters.push_back(caster);
+	}
 
-		modelMatrix = glm::scale(modelMatrix, glm::vec3(20.0f, 1.0f, 20.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
+	vector<MeshBounds> objectBounds;
+	for (size_t i = 0; i < shadowCasters.size(); i++)
+		objectBounds.push_back(transformBounds(shadowCasters[i].bounds, scene.world(shadowCasters[i].node)));
+
+	// Per-draw uniforms and indirect draw data, written each frame and bound by offset
+	StreamBuffer drawStream(1 << 18);
+	GLint uniformAlignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+	vector<size_t> casters;
+
+	// View, projection and cluster parameters shared by every program through binding point 0
+	UniformBuffer frameUniformBuffer(0, sizeof(FrameUniforms));
+	FrameUniforms frameUniforms = FrameUniforms();
+
+	// Lights on binding 2, binned into clusters on bindings 3 and 4
+	LightClusters lightClusters(2, 3, 4);
+	vector<GpuLight> gpuLights(lightCount);
+
+	// Lamps read each light's position and color as per-instance attributes of the light buffer
+	glBindVertexArray(lampMesh.vao);
+	glBindBuffer(GL_ARRAY_BUFFER, lightClusters.buffer());
+	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(GpuLight), (GLvoid*)offsetof(GpuLight, position));
+	glEnableVertexAttribArray(4);
+	glVertexAttribDivisor(4, 1);
+	glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(GpuLight), (GLvoid*)offsetof(GpuLight, color));
+	glEnableVertexAttribArray(5);
+	glVertexAttribDivisor(5, 1);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+	for (GLint i = 0; i < lightCount; i++)
+		gpuLights[i].shadowMap = -1;
+	for (size_t i = 0; i < shadowLights.size(); i++)
+		gpuLights[shadowLights[i]].shadowMap = (GLint)i;
+
+	double lastStatsUpdate = 0.0;
+
+	// Camera path frames must not depend on how far the decode threads got
+	bool playback = !cameraPoses.empty();
+	if (playback && !textureLoader.finished()) {
+		while (!textureLoader.finished()) {
+			if (textureLoader.uploadReady(1000.0) == 0)
+				this_thread::yield();
+		}
+		textureLoader.printReport();
+	}
 
-		glUniform3f(objectColorLoc, woodColor.x, woodColor.y, woodColor.z); // Set object color
-		glBindTexture(GL_TEXTURE_2D, woodTexture); // Bind Texture
+	init(window);
 
-		// Draw plane
-		draw(6);
+	// A camera path plays once; benchmarks add warm-up frames at its first pose
+	size_t playbackFrame = 0;
+	size_t playbackFrames = benchmarkFrames > 0 ? BENCHMARK_WARMUP_FRAMES + benchmarkFrames : cameraPoses.size();
 
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind Texture
+	FrameProfiler profiler;
+	TextOverlay profileOverlay;
+	BenchmarkRecorder benchmark;
+	vector<CameraPose> recordedPoses;
+	double lastFrameEnd = secondsSinceStart();
 
-		/*
-			Draw Laptop Base
-		*/
+	while (playback ? playbackFrame < playbackFrames && (window == nullptr || !glfwWindowShouldClose(window)) : !glfwWindowShouldClose(window)) {
+		// Set deltaTime
+		GLfloat currentFrame = playback ? (GLfloat)(playbackFrame * FIXED_FRAME_TIME) : (GLfloat)secondsSinceStart();
+		deltaTime = currentFrame - lastFrame;
+		lastFrame = currentFrame;
 
-		for (GLuint i = 0; i < 6; i++) {
-			modelMatrix = glm::mat4(1.0f);
-
-			modelMatrix = glm::translate(modelMatrix, basePositions[i]);
-			modelMatrix = glm::rotate(modelMatrix, glm::radians(baseRotationsX[i]), glm::vec3(1.0f, 0.0f, 0.0f));
-			modelMatrix = glm::rotate(modelMatrix, glm::radians(baseRotationsZ[i]), glm::vec3(0.0f, 0.0f, 1.0f));
-			modelMatrix = glm::scale(modelMatrix, baseScaling[i]);
-
-			glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-
-			switch (i) {
-			case 2:
-				glUniform3f(objectColorLoc, keyboardColor.x, keyboardColor.y, keyboardColor.z); // Set object color
-				glBindTexture(GL_TEXTURE_2D, keyboardTexture); // Bind Texture
-				break;
-			default:
-				glUniform3f(objectColorLoc, laptop_rimColor.x, laptop_rimColor.y, laptop_rimColor.z); // Set object color
-				glBindTexture(GL_TEXTURE_2D, laptop_rimTexture); // Bind Texture
-				break;
+		// Process input each frame, or move the camera to this frame's pose
+		if (playback) {
+			CameraPose pose;
+			if (benchmarkFrames > 0) {
+				size_t timedFrame = playbackFrame < (size_t)BENCHMARK_WARMUP_FRAMES ? 0 : playbackFrame - BENCHMARK_WARMUP_FRAMES;
+				pose = sampleCameraPath(cameraPoses, benchmarkFrames > 1 ? (float)timedFrame / (float)(benchmarkFrames - 1) : 0.0f);
+			}
+			else {
+				pose = cameraPoses[playbackFrame];
 			}
 
-			draw(6);
+			cameraPos = pose.position;
+			rawYaw = pose.yaw;
+			rawPitch = pose.pitch;
+			aimCamera();
 
-			glBindTexture(GL_TEXTURE_2D, 0); // Unbind Texture
+			if (window != nullptr && glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+				glfwSetWindowShouldClose(window, true);
+		}
+		else {
+			processInput(window);
 		}
 
-		/*
-			Draw Laptop Monitor
-		*/
+		if (!recordPathFile.empty()) {
+			CameraPose pose;
+			pose.position = cameraPos;
+			pose.yaw = rawYaw;
+			pose.pitch = glm::clamp(rawPitch, -89.0f, 89.0f);
+			recordedPoses.push_back(pose);
+		}
 
-		for (GLuint i = 0; i < 6; i++) {
-			modelMatrix = glm::mat4(1.0f);
-
-			modelMatrix = glm::translate(modelMatrix, monitorPositions[i]);
-			modelMatrix = glm::rotate(modelMatrix, glm::radians(monitorRotationsX[i]), glm::vec3(1.0f, 0.0f, 0.0f));
-			modelMatrix = glm::rotate(modelMatrix, glm::radians(monitorRotationsZ[i]), glm::vec3(0.0f, 0.0f, 1.0f));
-			modelMatrix = glm::scale(modelMatrix, monitorScaling[i]);
-
-			glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-
-			switch (i) {
-			case 1:
-				glUniform3f(objectColorLoc, laptop_lidColor.x, laptop_lidColor.y, laptop_lidColor.z); // Set object color
-				glBindTexture(GL_TEXTURE_2D, laptop_lidTexture); // Bind Texture
-				break;
-			case 3:
-				glUniform3f(objectColorLoc, monitorColor.x, monitorColor.y, monitorColor.z); // Set object color
-				glBindTexture(GL_TEXTURE_2D, monitorTexture); // Bind Texture
-				break;
-			default:
-				glUniform3f(objectColorLoc, laptop_rimColor.x, laptop_rimColor.y, laptop_rimColor.z); // Set object color
-				glBindTexture(GL_TEXTURE_2D, laptop_rimTexture); // Bind Texture
-				break;
+		profiler.beginFrame();
+
+		// Wait for the GPU to release the stream buffer region this frame writes
+		drawStream.beginFrame();
+
+		// Upload textures finished by the decode threads, and reload levels evicted from textures back in view
+		profiler.begin("Textures", profileCounters(renderState));
+		{
+			// Finer levels go first to the textures that cover the most of the screen, judged by last frame's visible ranges
+			// Textures with no visible range are the ones whose levels are dropped to stay within the budget
+			textureLoader.beginFrame();
+			vector<float> texturePriorities(sceneTextures.size(), 0.0f);
+			for (size_t i = 0; i < sceneBatch.ranges.size(); i++) {
+				if (!visible.empty() && !visible[firstRangeVolume + i])
+					continue;
+
+				const MeshBounds& bounds = sceneBatch.ranges[i].bounds;
+				float radius = glm::length(bounds.max - bounds.min) * 0.5f;
+				float distance = max(glm::length((bounds.min + bounds.max) * 0.5f - cameraPos) - radius, NEAR_PLANE);
+				float& priority = texturePriorities[rangeTextureRanks[i] - 1];
+				priority = max(priority, radius / distance);
+			}
+			for (size_t i = 0; i < movingObjects.size(); i++) {
+				if (!visible.empty() && !visible[movingObjects[i]])
+					continue;
+
+				const MeshBounds& bounds = objectBounds[movingObjects[i]];
+				float radius = glm::length(bounds.max - bounds.min) * 0.5f;
+				float distance = max(glm::length((bounds.min + bounds.max) * 0.5f - cameraPos) - radius, NEAR_PLANE);
+				const BatchMaterial& material = sceneMaterials[sceneDescription.objects[movingObjects[i]].material];
+				float& priority = texturePriorities[find(sceneTextures.begin(), sceneTextures.end(), material.texture) - sceneTextures.begin()];
+				priority = max(priority, radius / distance);
 			}
+			for (size_t i = 0; i < modelDraws.size(); i++) {
+				if (modelDraws[i].textureRank == 0 || (!visible.empty() && !visible[firstModelVolume + i]))
+					continue;
+
+				const MeshBounds& bounds = objectBounds[firstModelCaster + i];
+				float radius = glm::length(bounds.max - bounds.min) * 0.5f;
+				float distance = max(glm::length((bounds.min + bounds.max) * 0.5f - cameraPos) - radius, NEAR_PLANE);
+				float& priority = texturePriorities[modelDraws[i].textureRank - 1];
+				priority = max(priority, radius / distance);
+			}
+			for (size_t i = 0; i < sceneTextures.size(); i++)
+				textureLoader.setPriority(sceneTextures[i], texturePriorities[i]);
+
+			bool loading = !textureLoader.finished();
+			textureLoader.uploadReady(4.0);
+			if ((loading && textureLoader.finished()) || textureReportRequested)
+				textureLoader.printReport();
+			textureReportRequested = false;
+
+			// Resample the textures whose levels changed since the indirect layers were filled from them
+			if (useIndirectDraws) {
+				vector<GLuint> changed;
+				for (size_t i = 0; i < sceneTextures.size(); i++) {
+					unsigned version = textureLoader.version(sceneTextures[i]);
+					if (version != indirectTextureVersions[i]) {
+						changed.push_back(sceneTextures[i]);
+						indirectTextureVersions[i] = version;
+					}
+				}
+				if (!changed.empty()) {
+					sceneDrawList.updateTextures(changed, *textureLayerProgram);
+					renderState.invalidate();
+				}
+			}
+		}
+		profiler.end(profileCounters(renderState));
 
-			draw(6);
+		if (window != nullptr)
+			glfwGetFramebufferSize(window, &width, &height);
+		glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+		glViewport(0, 0, width, height);
 
-			glBindTexture(GL_TEXTURE_2D, 0); // Unbind Texture
-		}
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		/*
-			Draw Teabox
-		*/
+		// Start measuring CPU submission
+		frameStats.drawCalls = 0;
+		frameStats.uniformUpdates = 0;
+		double submitStart = secondsSinceStart();
 
-		for (GLuint i = 0; i < 6; i++) {
-			modelMatrix = glm::mat4(1.0f);
+		renderState.invalidate();
+		renderState.resetStats();
 
-			modelMatrix = glm::rotate(modelMatrix, glm::radians(-20.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-			modelMatrix = glm::translate(modelMatrix, teaboxPositions[i]);
-			modelMatrix = glm::rotate(modelMatrix, glm::radians(teaboxRotationsX[i]), glm::vec3(1.0f, 0.0f, 0.0f));
-			if (i == 1) {
-				modelMatrix = glm::rotate(modelMatrix, glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-			}
-			modelMatrix = glm::rotate(modelMatrix, glm::radians(teaboxRotationsZ[i]), glm::vec3(0.0f, 0.0f, 1.0f));
-			modelMatrix = glm::scale(modelMatrix, teaboxScaling[i]);
-
-			glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-
-			switch (i) {
-			case 0:
-				glUniform3f(objectColorLoc, teabox_bottomColor.x, teabox_bottomColor.y, teabox_bottomColor.z); // Set object color
-				glBindTexture(GL_TEXTURE_2D, teabox_bottomTexture); // Bind Texture
-				break;
-			case 1:
-				glUniform3f(objectColorLoc, teabox_backColor.x, teabox_backColor.y, teabox_backColor.z); // Set object color
-				glBindTexture(GL_TEXTURE_2D, teabox_backTexture); // Bind Texture
-				break;
-			case 2:
-				glUniform3f(objectColorLoc, teabox_topColor.x, teabox_topColor.y, teabox_topColor.z); // Set object color
-				glBindTexture(GL_TEXTURE_2D, teabox_topTexture); // Bind Texture
-				break;
-			case 3:
-				glUniform3f(objectColorLoc, teabox_frontColor.x, teabox_frontColor.y, teabox_frontColor.z); // Set object color
-				glBindTexture(GL_TEXTURE_2D, teabox_frontTexture); // Bind Texture
-				break;
-			case 4:
-				glUniform3f(objectColorLoc, teabox_leftColor.x, teabox_leftColor.y, teabox_leftColor.z); // Set object color
-				glBindTexture(GL_TEXTURE_2D, teabox_leftTexture); // Bind Texture
-				break;
-			case 5:
-				glUniform3f(objectColorLoc, teabox_rightColor.x, teabox_rightColor.y, teabox_rightColor.z); // Set object color
-				glBindTexture(GL_TEXTURE_2D, teabox_rightTexture); // Bind Texture
-				break;
-			}
+		profiler.begin("Submit", profileCounters(renderState));
+
+		// Declare identity matrices
+		glm::mat4 projectionMatrix = glm::mat4(1.0f);
+
+		// Initialize transforms
+		viewMatrix = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+
+		projectionMatrix = getProjection();
+
+		// Update the shared frame uniforms; nothing is uploaded while the camera and window are still
+		frameUniforms.view = viewMatrix;
+		frameUniforms.projection = projectionMatrix;
+		frameUniforms.inverseProjection = glm::inverse(projectionMatrix);
+		frameUniforms.inverseView = glm::inverse(viewMatrix);
+		frameUniforms.viewPos = glm::vec4(cameraPos, 1.0f);
+		frameUniforms.screenSize = glm::vec4((GLfloat)width, (GLfloat)height, 0.0f, 0.0f);
+		frameUniforms.clusterDepth = glm::vec4(NEAR_PLANE, FAR_PLANE, CLUSTER_GRID_Z / log(FAR_PLANE / NEAR_PLANE), 0.0f);
+		frameUniforms.lightCount = lightCount;
+		frameUniformBuffer.update(&frameUniforms);
+
+		// Move the orbiting lights
+		for (GLint i = 0; i < lightCount; i++) {
+			const LightOrbit& orbit = lightOrbits[i];
+			if (orbit.speed == 0.0f)
+				continue;
+
+			float angle = orbit.phase + orbit.speed * currentFrame;
+			sceneLights[i].position[0] = orbit.center.x + orbit.radius * cosf(angle);
+			sceneLights[i].position[2] = orbit.center.z + orbit.radius * sinf(angle);
+		}
+
+		// Upload the lights and bin them into the clusters
+		profiler.begin("Light clusters", profileCounters(renderState));
+		for (GLint i = 0; i < lightCount; i++) {
+			const SceneLightRecord& light = sceneLights[i];
+			gpuLights[i].position = glm::vec4(glm::make_vec3(light.position), light.range);
+			gpuLights[i].color = glm::vec4(glm::make_vec3(light.color), 1.0f);
+			gpuLights[i].params = glm::vec4(light.ambient, light.diffuse, light.specular, light.shininess);
+		}
+		lightClusters.setLights(gpuLights);
+		lightClusters.build(lightCullProgram);
+		profiler.end(profileCounters(renderState));
 
-			draw(6);
+		if (animatedNode >= 0) {
+			float lift = ANIMATED_NODE_LIFT * (0.5f - 0.5f * cosf(currentFrame * ANIMATED_NODE_SPEED));
+			scene.setLocal(animatedNode, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, lift, 0.0f)) * animatedNodeRest);
+		}
 
-			glBindTexture(GL_TEXTURE_2D, 0); // Unbind Texture
+		// Recompute world matrices of nodes that moved since last frame, and the volumes of what they carry
+		if (scene.update() > 0) {
+			for (size_t i = 0; i < shadowCasters.size(); i++) {
+				MeshBounds bounds = transformBounds(shadowCasters[i].bounds, scene.world(shadowCasters[i].node));
+				if (bounds.min == objectBounds[i].min && bounds.max == objectBounds[i].max)
+					continue;
+
+				// A caster moving into or out of a light's range invalidates its shadow map
+				for (size_t j = 0; j < shadowLights.size(); j++) {
+					const SceneLightRecord& light = sceneLights[shadowLights[j]];
+					glm::vec3 lightPosition = glm::make_vec3(light.position);
+					if (intersectsSphere(objectBounds[i], lightPosition, light.range) || intersectsSphere(bounds, lightPosition, light.range))
+						shadowMaps.invalidate((int)j);
+				}
+
+				objectBounds[i] = bounds;
+				cullingVolumes.set(shadowCasters[i].volume, bounds);
+			}
 		}
 
 		/*
-			Draw Tea Bottle
+			Render Shadow Maps
 		*/
 
-		for (GLuint i = 0; i < 6; i++) {
-			modelMatrix = glm::mat4(1.0f);
-
-			modelMatrix = glm::translate(modelMatrix, teaBottlePositions[i]);
-			modelMatrix = glm::rotate(modelMatrix, glm::radians(teaBottleRotationsX[i]), glm::vec3(1.0f, 0.0f, 0.0f));
-			modelMatrix = glm::rotate(modelMatrix, glm::radians(teaBottleRotationsZ[i]), glm::vec3(0.0f, 0.0f, 1.0f));
-			if (i == 1)
-				modelMatrix = glm::rotate(modelMatrix, glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-			modelMatrix = glm::scale(modelMatrix, teaBottleScaling[i]);
-
-			glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-
-			switch (i) {
-			case 0:
-				glUniform3f(objectColorLoc, teaColor.x, teaColor.y, teaColor.z); // Set object color
-				glBindTexture(GL_TEXTURE_2D, teaTexture); // Bind Texture
-				break;
-			case 1:
-				glUniform3f(objectColorLoc, teabottle_labelColor.x, teabottle_labelColor.y, teabottle_labelColor.z); // Set object color
-				glBindTexture(GL_TEXTURE_2D, teabottle_labelTexture); // Bind Texture
-				break;
-			case 2:
-				glUniform3f(objectColorLoc, teaColor.x, teaColor.y, teaColor.z); // Set object color
-				glBindTexture(GL_TEXTURE_2D, teaTexture); // Bind Texture
-				break;
-			case 3:
-				glUniform3f(objectColorLoc, teabottle_labelColor.x, teabottle_labelColor.y, teabottle_labelColor.z); // Set object color
-				glBindTexture(GL_TEXTURE_2D, teabottle_labelTexture); // Bind Texture
-				break;
-			case 4:
-				glUniform3f(objectColorLoc, teabottle_nutrColor.x, teabottle_nutrColor.y, teabottle_nutrColor.z); // Set object color
-				glBindTexture(GL_TEXTURE_2D, teabottle_nutrTexture); // Bind Texture
-				break;
-			case 5:
-				glUniform3f(objectColorLoc, teabottle_descColor.x, teabottle_descColor.y, teabottle_descColor.z); // Set object color
-				glBindTexture(GL_TEXTURE_2D, teabottle_descTexture); // Bind Texture
-				break;
-			}
+		double shadowStart = secondsSinceStart();
+		frameStats.shadowMapsRendered = 0;
+		profiler.begin("Shadow maps", profileCounters(renderState));
 
-			draw(6);
+		for (size_t i = 0; i < shadowLights.size(); i++) {
+			const SceneLightRecord& light = sceneLights[shadowLights[i]];
+			glm::vec4 positionRange = glm::vec4(glm::make_vec3(light.position), light.range);
 
-			glBindTexture(GL_TEXTURE_2D, 0); // Unbind Texture
-		}
+			// Moving the light itself invalidates its map
+			if (positionRange != shadowLightPositions[i] || !shadowCaching)
+				shadowMaps.invalidate((int)i);
+			if (!shadowMaps.needsUpdate((int)i))
+				continue;
 
-		glBindVertexArray(0);
+			shadowLightPositions[i] = positionRange;
 
-		glBindVertexArray(pyramidVAO);
+			glUseProgram(shadowShaderProgram.id());
+			glUniform4f(lightPositionRangeLoc, positionRange.x, positionRange.y, positionRange.z, positionRange.w);
+			frameStats.uniformUpdates++;
 
-		for (GLuint i = 0; i < 4; i++) {
-			modelMatrix = glm::mat4(1.0f);
+			// Write the transforms of the casters in range once for all six faces
+			casters.clear();
+			for (size_t j = 0; j < shadowCasters.size(); j++) {
+				if (intersectsSphere(objectBounds[j], glm::vec3(positionRange), light.range))
+					casters.push_back(j);
+			}
 
-			modelMatrix = glm::translate(modelMatrix, glm::vec3(-6.0f, 1.5f, -2.5f));
-			modelMatrix = glm::rotate(modelMatrix, glm::radians(pyramidRotationsY[i]), glm::vec3(0.0f, 1.0f, 0.0f));
-			modelMatrix = glm::scale(modelMatrix, glm::vec3(1.0f, 0.85f, 1.0f));
+			GLsizeiptr stride = drawUniformsStride(uniformAlignment);
+			void* data = nullptr;
+			GLintptr offset = casters.empty() ? 0 : drawStream.allocate(stride * casters.size(), uniformAlignment, &data);
+			for (size_t j = 0; j < casters.size(); j++) {
+				const ShadowCaster& caster = shadowCasters[casters[j]];
+				writeDrawUniforms((DrawUniforms*)((unsigned char*)data + j * stride), scene.world(caster.node), scene.normalMatrix(caster.node), caster.decode, glm::vec3(1.0f), false);
+			}
 
-			glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
+			for (int face = 0; face < 6; face++) {
+				glm::mat4 lightViewProjection = shadowMaps.beginFace((int)i, face, glm::vec3(positionRange), light.range);
+				glUniformMatrix4fv(lightViewProjectionLoc, 1, GL_FALSE, glm::value_ptr(lightViewProjection));
+				frameStats.uniformUpdates++;
 
-			glUniform3f(objectColorLoc, teaColor.x, teaColor.y, teaColor.z); // Set object color
-			glBindTexture(GL_TEXTURE_2D, teaTexture); // Bind Texture
+				for (size_t j = 0; j < casters.size(); j++) {
+					const ShadowCaster& caster = shadowCasters[casters[j]];
 
-			draw(3);
+					glBindVertexArray(caster.vao); // Bind VAO
+					glBindBufferRange(GL_UNIFORM_BUFFER, 1, drawStream.buffer(), offset + j * stride, sizeof(DrawUniforms));
+					frameStats.uniformUpdates++;
 
-			glBindTexture(GL_TEXTURE_2D, 0); // Unbind Texture
-		}
+					// Draw primitive(s)
+					glDrawElements(GL_TRIANGLES, caster.indexCount, caster.indexType, (GLvoid*)caster.indexOffset);
+					frameStats.drawCalls++;
+				}
+			}
 
-		glBindVertexArray(0);
+			shadowMaps.endMap((int)i);
+			frameStats.shadowMapsRendered++;
+		}
 
-		glBindVertexArray(cylinderVAO); // Bind VAO
+		if (frameStats.shadowMapsRendered > 0) {
+			glBindVertexArray(0); // Unbind VAO
+			glUseProgram(0);
+			glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+			glViewport(0, 0, width, height);
+		}
 
-		for (GLuint i = 0; i < 24; i++) {
-			glUniform3f(objectColorLoc, teaColor.x, teaColor.y, teaColor.z); // Set object color
-			glBindTexture(GL_TEXTURE_2D, teaTexture); // Bind Texture
+		profiler.end(profileCounters(renderState));
+		frameStats.shadowMs = (secondsSinceStart() - shadowStart) * 1000.0;
+		frameStats.shadowMsTotal += frameStats.shadowMs;
+		frameStats.frames++;
 
-			modelMatrix = glm::mat4(1.0f);
-			modelMatrix = glm::translate(modelMatrix, glm::vec3(-6.0f, 1.5f, -2.5f));
-			modelMatrix = glm::rotate(modelMatrix, glm::radians(i * 15.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-			modelMatrix = glm::scale(modelMatrix, glm::vec3(0.3f, 1.25f, 0.3f));
-			glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
+		// Test every volume against the view frustum
+		double cullStart = secondsSinceStart();
+		profiler.begin("Culling", profileCounters(renderState));
+		if (frustumCulling) {
+			frameStats.culled = (GLuint)(cullingVolumes.size() - cullingVolumes.cull(extractFrustum(projectionMatrix * viewMatrix), visible));
+		}
+		else {
+			visible.assign(cullingVolumes.size(), 1);
+			frameStats.culled = 0;
+		}
+		profiler.end(profileCounters(renderState));
+		frameStats.cullMs = (secondsSinceStart() - cullStart) * 1000.0;
 
-			// Draw plane
-			draw(12);
+		profiler.begin("Scene", profileCounters(renderState));
 
-			glBindTexture(GL_TEXTURE_2D, 0); // Unbind Texture
+		// Deferred shading draws the scene's surfaces into the G-buffer and lights them afterwards
+		if (deferredShading) {
+			gBuffer.resize(width, height);
+			glBindFramebuffer(GL_FRAMEBUFFER, gBuffer.framebuffer());
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		}
 
-		for (GLuint i = 0; i < 24; i++) {
-			glUniform3f(objectColorLoc, lidColor.x, lidColor.y, lidColor.z); // Set object color
-			glBindTexture(GL_TEXTURE_2D, lidTexture); // Bind Texture
+		if (useIndirectDraws) {
+			/*
+				Draw Scene Indirect
+			*/
+
+			renderState.useProgram(deferredShading ? indirectGBufferShaderProgram->id() : indirectShaderProgram->id());
+
+			// State is shared by every draw, so only depth orders them: front to back lets early depth testing reject hidden fragments
+			objectQueue.clear();
+			for (size_t i = 0; i < sceneDescription.objects.size(); i++) {
+				if (!visible[i])
+					continue;
+
+				const SceneObjectRecord& object = sceneDescription.objects[i];
+				const MeshBounds& bounds = meshBounds[object.mesh];
+				RenderPacket packet = RenderPacket();
+				packet.key = makeSortKey(0, 0, 0, 0, viewDepth(glm::vec3(scene.world(object.node) * glm::vec4((bounds.min + bounds.max) * 0.5f, 1.0f))));
+				packet.object = (int)i;
+				objectQueue.push(packet);
+			}
+			if (sortDraws)
+				objectQueue.sort();
 
-			modelMatrix = glm::mat4(1.0f);
-			modelMatrix = glm::translate(modelMatrix, glm::vec3(-6.0f, 2.75f, -2.5f));
-			modelMatrix = glm::rotate(modelMatrix, glm::radians(i * 15.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-			modelMatrix = glm::scale(modelMatrix, glm::vec3(0.4f, 0.2f, 0.4f));
-			glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
+			sceneDrawList.clear();
+			for (size_t i = 0; i < objectQueue.size(); i++) {
+				const SceneObjectRecord& object = sceneDescription.objects[objectQueue[i].object];
+				sceneDrawList.add(object.mesh, object.material, scene.world(object.node), scene.normalMatrix(object.node));
+			}
 
-			// Draw plane
-			draw(12);
+			sceneDrawList.submit(1, drawStream);
+			frameStats.drawCalls++;
 
-			glBindTexture(GL_TEXTURE_2D, 0); // Unbind Texture
+			// The draw list binds and unbinds its own VAO and textures
+			renderState.invalidate();
 		}
 
 		/*
-			Draw Nut Tin
+			Queue Static Scene
 		*/
 
-		for (GLuint i = 0; i < 24; i++) {
-			glUniform3f(objectColorLoc, nutsEditColor.x, nutsEditColor.y, nutsEditColor.z); // Set object color
-			glBindTexture(GL_TEXTURE_2D, nutTexList[i]); // Bind Texture
-
-			modelMatrix = glm::mat4(1.0f);
-			modelMatrix = glm::translate(modelMatrix, glm::vec3(-7.0f, 0.0f, 1.0f));
-			modelMatrix = glm::rotate(modelMatrix, glm::radians(i * 15.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-			glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
+		renderQueue.clear();
+		queueObjects.clear();
+
+		if (!useIndirectDraws) {
+			// Moving objects are drawn with their own transforms; the indirect path draws them already
+			for (size_t i = 0; i < movingObjects.size(); i++) {
+				if (!visible[movingObjects[i]])
+					continue;
+
+				const SceneObjectRecord& sceneObject = sceneDescription.objects[movingObjects[i]];
+				const BatchMaterial& material = sceneMaterials[sceneObject.material];
+				const Mesh& mesh = casterMeshes[sceneObject.mesh];
+				const MeshBounds& bounds = objectBounds[movingObjects[i]];
+				QueueObject object;
+				object.model = scene.world(sceneObject.node);
+				object.normalMatrix = scene.normalMatrix(sceneObject.node);
+				object.decode = mesh.decode;
+
+				RenderPacket packet;
+				uint32_t textureRank = (uint32_t)(find(sceneTextures.begin(), sceneTextures.end(), material.texture) - sceneTextures.begin()) + 1;
+				packet.key = makeSortKey(0, 2, textureRank, (uint32_t)(firstSceneMaterial + sceneObject.material), viewDepth((bounds.min + bounds.max) * 0.5f));
+				packet.program = deferredShading ? gBufferShaderProgram.id() : shaderProgram.id();
+				packet.vertexArray = mesh.vao;
+				packet.textureTarget = material.textureArray ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+				packet.texture = material.texture;
+				packet.material = firstSceneMaterial + (int)sceneObject.material;
+				packet.object = (int)queueObjects.size();
+				packet.indexType = mesh.indexType;
+				packet.indexCount = mesh.indexCount;
+				packet.indexOffset = 0;
+				queueObjects.push_back(object);
+				renderQueue.push(packet);
+			}
 
-			// Draw plane
-			draw(12);
+			for (size_t i = 0; i < sceneBatch.ranges.size(); i++) {
+				if (!visible[firstRangeVolume + i])
+					continue;
+
+				const BatchRange& range = sceneBatch.ranges[i];
+				RenderPacket packet;
+				packet.key = makeSortKey(0, 0, rangeTextureRanks[i], (uint32_t)i, viewDepth((range.bounds.min + range.bounds.max) * 0.5f));
+				packet.program = deferredShading ? gBufferShaderProgram.id() : shaderProgram.id();
+				packet.vertexArray = sceneBatch.mesh.vao;
+				packet.textureTarget = range.material.textureArray ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+				packet.texture = range.material.texture;
+				packet.material = (int)i;
+				packet.object = -1;
+				packet.indexType = sceneBatch.mesh.indexType;
+				packet.indexCount = range.indexCount;
+				packet.indexOffset = range.indexOffset;
+				renderQueue.push(packet);
+			}
+		}
 
-			glBindTexture(GL_TEXTURE_2D, 0); // Unbind Texture
+		// Model primitives draw from their own buffers with a transform per packet, in either mode
+		for (size_t i = 0; i < modelDraws.size(); i++) {
+			if (!visible[firstModelVolume + i])
+				continue;
+
+			const ModelDraw& modelDraw = modelDraws[i];
+			const MeshBounds& bounds = objectBounds[firstModelCaster + i];
+			QueueObject object;
+			object.model = scene.world(modelDraw.node);
+			object.normalMatrix = scene.normalMatrix(modelDraw.node);
+			object.decode = modelDecode;
+
+			RenderPacket packet;
+			packet.key = makeSortKey(0, 1, modelDraw.textureRank, (uint32_t)modelDraw.material, viewDepth((bounds.min + bounds.max) * 0.5f));
+			packet.program = deferredShading ? gBufferShaderProgram.id() : shaderProgram.id();
+			packet.vertexArray = modelDraw.primitive->vao;
+			packet.textureTarget = GL_TEXTURE_2D;
+			packet.texture = modelDraw.texture;
+			packet.material = modelDraw.material;
+			packet.object = (int)queueObjects.size();
+			packet.indexType = modelDraw.primitive->indexType;
+			packet.indexCount = modelDraw.primitive->indexCount;
+			packet.indexOffset = modelDraw.primitive->indexOffset;
+			queueObjects.push_back(object);
+			renderQueue.push(packet);
 		}
 
-		for (GLuint i = 0; i < 24; i++) {
-			glUniform3f(objectColorLoc, lidColor.x, lidColor.y, lidColor.z); // Set object color
-			glBindTexture(GL_TEXTURE_2D, lidTexture); // Bind Texture
+		if (sortDraws)
+			renderQueue.sort();
 
-			modelMatrix = glm::mat4(1.0f);
-			modelMatrix = glm::translate(modelMatrix, glm::vec3(-7.0f, 1.0f, 1.0f));
-			modelMatrix = glm::rotate(modelMatrix, glm::radians(i * 15.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-			modelMatrix = glm::scale(modelMatrix, glm::vec3(1.05f, 0.2f, 1.05f));
-			glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
+		draw(renderQueue, renderState, queueMaterials, queueObjects, sceneBatch.mesh.decode, drawStream, uniformAlignment);
+		profiler.end(profileCounters(renderState));
 
-			// Draw plane
-			draw(12);
+		if (deferredShading) {
+			/*
+				Light G-Buffer
+			*/
 
-			glBindTexture(GL_TEXTURE_2D, 0); // Unbind Texture
-		}
+			profiler.begin("Deferred lighting", profileCounters(renderState));
 
-		glBindVertexArray(0);
+			glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
 
-		// Unbind shader program
-		glUseProgram(0);
+			renderState.useProgram(deferredShaderProgram.id());
+			gBuffer.bindTextures(0);
+
+			// The pass writes the G-buffer depth itself, so every pixel must pass
+			glDepthFunc(GL_ALWAYS);
+			gBuffer.drawFullscreen();
+			glDepthFunc(GL_LESS);
+
+			gBuffer.unbindTextures(0);
+			frameStats.drawCalls++;
+			profiler.end(profileCounters(renderState));
+			renderState.invalidate();
+		}
 
 		/*
 			Draw Light Sources
 		*/
 
-		glUseProgram(lampShaderProgram);
+		// One instance per light, placed and colored straight from the light buffer
+		profiler.begin("Lamps", profileCounters(renderState));
+		if (lightCount > 0) {
+			renderState.useProgram(lampShaderProgram.id());
+			renderState.bindVertexArray(lampMesh.vao);
 
-		GLuint lampModelLoc = glGetUniformLocation(lampShaderProgram, "model");
-		GLuint lampViewLoc = glGetUniformLocation(lampShaderProgram, "view");
-		GLuint lampProjectionLoc = glGetUniformLocation(lampShaderProgram, "projection");
+			// Draw primitive(s)
+			glDrawElementsInstanced(GL_TRIANGLES, lampMesh.indexCount, lampMesh.indexType, nullptr, lightCount);
+			frameStats.drawCalls++;
+		}
+		profiler.end(profileCounters(renderState));
 
-		glUniformMatrix4fv(lampViewLoc, 1, GL_FALSE, glm::value_ptr(viewMatrix));
-		glUniformMatrix4fv(lampProjectionLoc, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+		/*
+			Draw Profiler Overlay
+		*/
 
-		GLuint lampColorLoc = glGetUniformLocation(lampShaderProgram, "lampColor");
+		if (showProfiler) {
+			profiler.begin("Overlay", profileCounters(renderState));
+			renderState.useProgram(textShaderProgram.id());
+			glDisable(GL_DEPTH_TEST);
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-		glBindVertexArray(lampVAO); // Bind VAO
+			profileOverlay.draw();
+			frameStats.drawCalls++;
 
-		glUniform3f(lampColorLoc, 1.0f, 1.0f, 1.0f); // Set Lamp Color
+			glDisable(GL_BLEND);
+			glEnable(GL_DEPTH_TEST);
+			renderState.invalidate();
+			profiler.end(profileCounters(renderState));
+		}
 
-		for (GLuint i = 0; i < 6; i++) {
-			glm::mat4 modelMatrix = glm::mat4(1.0f);
+		// Unbind Textures
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, 0);
 
-			modelMatrix = glm::translate(modelMatrix, lampPositions[i] / glm::vec3(8.0f, 8.0f, 8.0f) + lightPosition1);
-			modelMatrix = glm::rotate(modelMatrix, glm::radians(lampRotations[i]), glm::vec3(0.0f, 1.0f, 0.0f));
-			if (i >= 4)
-				modelMatrix = glm::rotate(modelMatrix, glm::radians(lampRotations[i]), glm::vec3(1.0f, 0.0f, 0.0f));
-			modelMatrix = glm::scale(modelMatrix, glm::vec3(0.125f, 0.125f, 0.125f));
+		glBindVertexArray(0); // Unbind VAO
 
-			glUniformMatrix4fv(lampModelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
+		glUseProgram(0);
 
-			// Draw primitive(s)
-			draw(6);
-		}
+		// Every draw reading this frame's region has been issued
+		drawStream.endFrame();
 
-		glUniform3f(lampColorLoc, 1.0f, 0.0f, 0.0f); // Set Lamp Color
+		frameStats.stateChanges = renderState.stats().total();
 
-		for (GLuint i = 0; i < 6; i++) {
-			glm::mat4 modelMatrix = glm::mat4(1.0f);
+		frameStats.submitMs = (secondsSinceStart() - submitStart) * 1000.0;
+		profiler.end(profileCounters(renderState));
 
-			modelMatrix = glm::translate(modelMatrix, lampPositions[i] / glm::vec3(8.0f, 8.0f, 8.0f) + lightPosition2);
-			modelMatrix = glm::rotate(modelMatrix, glm::radians(lampRotations[i]), glm::vec3(0.0f, 1.0f, 0.0f));
-			if (i >= 4)
-				modelMatrix = glm::rotate(modelMatrix, glm::radians(lampRotations[i]), glm::vec3(1.0f, 0.0f, 0.0f));
-			modelMatrix = glm::scale(modelMatrix, glm::vec3(0.125f, 0.125f, 0.125f));
+		if (traceRequested) {
+			if (profiler.exportTrace(traceFile))
+				cout << "Wrote " << traceFile << endl;
+			traceRequested = false;
+		}
 
-			glUniformMatrix4fv(lampModelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
+		// Refresh the stats twice a second so they stay readable
+		if (currentFrame - lastStatsUpdate >= 0.5) {
+			if (showProfiler)
+				printProfile(profileOverlay, profiler.latest());
+
+			// Show draw calls and CPU submit time in the title bar
+			if (window != nullptr) {
+				ostringstream title;
+				title << fixed << setprecision(3) << "Main Window | " << (deferredShading ? "deferred" : "forward") << ", "
+					<< (useIndirectDraws ? "indirect" : "batched") << " | "
+					<< frameStats.drawCalls << " draws | " << frameStats.stateChanges << " state changes | "
+					<< frameStats.culled << " culled in " << frameStats.cullMs << " ms | "
+					<< frameStats.shadowMapsRendered << " shadow maps in " << frameStats.shadowMs << " ms, "
+					<< frameStats.shadowMsTotal / frameStats.frames << " ms/frame amortized | "
+					<< frameStats.submitMs << " ms CPU submit | "
+					<< textureLoader.residentBytes() / (1024.0 * 1024.0) << " MB textures";
+				if (textureLoader.budget() > 0)
+					title << " of " << textureLoader.budget() / (1024 * 1024);
+				glfwSetWindowTitle(window, title.str().c_str());
+			}
 
-			// Draw primitive(s)
-			draw(6);
+			lastStatsUpdate = currentFrame;
 		}
 
-		glUniform3f(lampColorLoc, 0.0f, 0.0f, 1.0f); // Set Lamp Color
+		if (window != nullptr)
+			glfwSwapBuffers(window);
 
-		for (GLuint i = 0; i < 6; i++) {
-			glm::mat4 modelMatrix = glm::mat4(1.0f);
+		if (benchmarkFrames > 0) {
+			// Nothing throttles an offscreen frame, so wait for it to keep the CPU from running ahead
+			if (window == nullptr)
+				glFinish();
 
-			modelMatrix = glm::translate(modelMatrix, lampPositions[i] / glm::vec3(8.0f, 8.0f, 8.0f) + lightPosition3);
-			modelMatrix = glm::rotate(modelMatrix, glm::radians(lampRotations[i]), glm::vec3(0.0f, 1.0f, 0.0f));
-			if (i >= 4)
-				modelMatrix = glm::rotate(modelMatrix, glm::radians(lampRotations[i]), glm::vec3(1.0f, 0.0f, 0.0f));
-			modelMatrix = glm::scale(modelMatrix, glm::vec3(0.125f, 0.125f, 0.125f));
+			// Time from the end of the last frame to the end of this one
+			double frameEnd = secondsSinceStart();
+			if (playbackFrame >= (size_t)BENCHMARK_WARMUP_FRAMES) {
+				benchmark.addFrame((frameEnd - lastFrameEnd) * 1000.0, frameStats.shadowMapsRendered);
+				if (profiler.latest().index > (unsigned long long)BENCHMARK_WARMUP_FRAMES)
+					benchmark.addProfile(profiler.latest());
+			}
+			lastFrameEnd = frameEnd;
+		}
+		else if (window == nullptr) {
+			string path = headlessOutput;
+			size_t number = path.find("%d");
+			if (number != string::npos)
+				path.replace(number, 2, to_string(playbackFrame));
+
+			if (offscreenTarget->save(path))
+				cout << "Wrote " << path << " (" << frameStats.drawCalls << " draws, " << frameStats.submitMs << " ms CPU submit)" << endl;
+		}
 
-			glUniformMatrix4fv(lampModelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
+		if (playback)
+			playbackFrame++;
 
-			// Draw primitive(s)
-			draw(6);
+		// Report time-to-first-frame measured from startup
+		if (firstFrame) {
+			glFinish();
+			cout << "Time to first frame: " << secondsSinceStart() * 1000.0 << " ms" << endl;
+			firstFrame = false;
 		}
 
-		glBindVertexArray(0); // Unbind VAO
+		if (window != nullptr)
+			glfwPollEvents();
+	}
 
-		glUseProgram(0);
+	if (benchmarkFrames > 0) {
+		benchmark.print(cout);
+
+		ostringstream size;
+		size << width << "x" << height;
+
+		vector<pair<string, string> > settings;
+		settings.push_back(make_pair("scene", sceneFile));
+		settings.push_back(make_pair("cameraPath", cameraPathFile));
+		settings.push_back(make_pair("renderer", reinterpret_cast<const char*>(glGetString(GL_RENDERER))));
+		settings.push_back(make_pair("size", size.str()));
+		settings.push_back(make_pair("shading", deferredShading ? "deferred" : "forward"));
+		settings.push_back(make_pair("draws", useIndirectDraws ? "indirect" : "batched"));
+		settings.push_back(make_pair("lights", to_string(lightCount)));
+		settings.push_back(make_pair("culling", frustumCulling ? "on" : "off"));
+		settings.push_back(make_pair("sorting", sortDraws ? "on" : "off"));
+
+		if (benchmark.write(benchmarkResults, settings))
+			cout << "Wrote " << benchmarkResults << endl;
+	}
+
+	if (!recordPathFile.empty() && saveCameraPath(recordPathFile, recordedPoses))
+		cout << "Wrote " << recordedPoses.size() << " camera poses to " << recordPathFile << endl;
 
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+	// Collect the frames still in flight before writing the trace
+	if (traceOnExit) {
+		profiler.finish();
+		if (profiler.exportTrace(traceFile))
+			cout << "Wrote " << traceFile << endl;
 	}
 
 	//Clear GPU resources
-	glDeleteVertexArrays(1, &squareVAO);
-	glDeleteBuffers(1, &squareVBO);
-	glDeleteBuffers(1, &squareEBO);
-	glDeleteVertexArrays(1, &pyramidVAO);
-	glDeleteBuffers(1, &pyramidVBO);
-	glDeleteBuffers(1, &pyramidEBO);
-	glDeleteVertexArrays(1, &cylinderVAO);
-	glDeleteBuffers(1, &cylinderVBO);
-	glDeleteBuffers(1, &cylinderEBO);
-	glDeleteVertexArrays(1, &lampVAO);
-	glDeleteBuffers(1, &lampVBO);
-	glDeleteBuffers(1, &lampEBO);
-
-	glfwDestroyWindow(window);
+	deleteStaticBatch(sceneBatch);
+	textureLoader.deleteTextures();
+	deleteMesh(lampMesh);
+	for (size_t i = 0; i < casterMeshes.size(); i++)
+		deleteMesh(casterMeshes[i]);
+	for (size_t i = 0; i < models.size(); i++)
+		deleteGltfModel(models[i]);
+	glDeleteTextures(1, &whiteTexture);
+
+	if (window != nullptr)
+		glfwDestroyWindow(window);
 	glfwTerminate();
 	exit(EXIT_SUCCESS);
 }
@@ -1636,6 +2075,10 @@ void cursor_position_callback(GLFWwindow* window, double xpos, double ypos) {
 	rawYaw += xOffset * sensitivity;
 	rawPitch += yOffset * sensitivity;
 
+	aimCamera();
+}
+
+void aimCamera() {
 	degYaw = glm::radians(rawYaw);
 	degPitch = glm::clamp(glm::radians(rawPitch), glm::radians(-89.0f), glm::radians(89.0f));
 
@@ -1653,6 +2096,26 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 	//Flip the view
 	if (key == GLFW_KEY_P && action == GLFW_PRESS)
 		is3D = !is3D;
+
+	// Switch between forward and deferred shading
+	if (key == GLFW_KEY_G && action == GLFW_PRESS)
+		deferredShading = !deferredShading;
+
+	// Show or hide the profiler overlay
+	if (key == GLFW_KEY_O && action == GLFW_PRESS)
+		showProfiler = !showProfiler;
+
+	// Write the profiler's recent frames as a Chrome trace
+	if (key == GLFW_KEY_T && action == GLFW_PRESS)
+		traceRequested = true;
+
+	// Print the texture residency report
+	if (key == GLFW_KEY_R && action == GLFW_PRESS)
+		textureReportRequested = true;
+
+	// Switch between the batched and indirect renderers
+	if (key == GLFW_KEY_M && action == GLFW_PRESS && indirectDrawsSupported)
+		useIndirectDraws = !useIndirectDraws;
 }
 
 // Define Reset Camera Function
@@ -1669,7 +2132,14 @@ void resetCamera() {
 // Define 2d / 3d view swap prototype
 glm::mat4 getProjection() {
 	if (is3D)
-		return glm::perspective(45.0f, (GLfloat)width / (GLfloat)height, 0.1f, 100.0f);
+		return glm::perspective(45.0f, (GLfloat)width / (GLfloat)height, NEAR_PLANE, FAR_PLANE);
 	else
-		return glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 0.1f, 100.0f);
-}
\ No newline at end of file
+		return glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, NEAR_PLANE, FAR_PLANE);
+}
+
+// Startup time, set before main runs
+const chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+
+double secondsSinceStart() {
+	return chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+}
@@ -0,0 +1,73 @@
+#include "StaticBatch.h"
+
+using namespace std;
+
+namespace {
+	bool sameMaterial(const BatchMaterial& a, const BatchMaterial& b) {
+		return a.texture == b.texture && a.textureArray == b.textureArray && a.color == b.color;
+	}
+}
+
+void StaticBatchBuilder::add(const MeshData& mesh, const glm::mat4& model, const glm::mat3& normalMatrix, const BatchMaterial& material) {
+	Group* group = nullptr;
+	for (size_t i = 0; i < groups.size(); i++) {
+		if (sameMaterial(groups[i].material, material)) {
+			group = &groups[i];
+			break;
+		}
+	}
+
+	if (group == nullptr) {
+		groups.push_back(Group());
+		group = &groups.back();
+		group->material = material;
+	}
+
+	// Bake the model transform into the vertices
+	GLuint firstVertex = (GLuint)group->data.vertices.size();
+
+	for (size_t i = 0; i < mesh.vertices.size(); i++) {
+		MeshVertex vertex = mesh.vertices[i];
+		vertex.position = glm::vec3(model * glm::vec4(vertex.position, 1.0f));
+		vertex.normal = glm::normalize(normalMatrix * vertex.normal);
+		group->data.vertices.push_back(vertex);
+	}
+
+	for (size_t i = 0; i < mesh.indices.size(); i++)
+		group->data.indices.push_back(firstVertex + mesh.indices[i]);
+}
+
+StaticBatch StaticBatchBuilder::build() const {
+	StaticBatch batch;
+	MeshData merged;
+
+	// Lay the groups out back to back so each material is one contiguous index range
+	vector<size_t> firstIndices;
+	for (size_t i = 0; i < groups.size(); i++) {
+		GLuint firstVertex = (GLuint)merged.vertices.size();
+		firstIndices.push_back(merged.indices.size());
+
+		merged.vertices.insert(merged.vertices.end(), groups[i].data.vertices.begin(), groups[i].data.vertices.end());
+		for (size_t j = 0; j < groups[i].data.indices.size(); j++)
+			merged.indices.push_back(firstVertex + groups[i].data.indices[j]);
+	}
+
+	batch.mesh = uploadMesh(merged);
+
+	size_t indexSize = batch.mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+	for (size_t i = 0; i < groups.size(); i++) {
+		BatchRange range;
+		range.material = groups[i].material;
+		range.indexCount = (GLsizei)groups[i].data.indices.size();
+		range.indexOffset = firstIndices[i] * indexSize;
+		range.bounds = computeBounds(groups[i].data);
+		batch.ranges.push_back(range);
+	}
+
+	return batch;
+}
+
+void deleteStaticBatch(StaticBatch& batch) {
+	deleteMesh(batch.mesh);
+	batch.ranges.clear();
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "MeshGenerator.h"
+
+#include <GLEW/glew.h>
+
+#include <glm/glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+// Texture and color shared by every triangle drawn with one call
+struct BatchMaterial {
+	GLuint texture;
+	glm::vec3 color;
+	bool textureArray; // Texture is a GL_TEXTURE_2D_ARRAY with one layer per repeat of u
+};
+
+// Contiguous run of indices in a batch that share one material
+struct BatchRange {
+	BatchMaterial material;
+	GLsizei indexCount;
+	size_t indexOffset; // Byte offset into the index buffer
+	MeshBounds bounds; // World-space bounding box, for culling and depth sorting
+};
+
+// Static geometry pre-transformed to world space and merged into one vertex/index buffer
+struct StaticBatch {
+	Mesh mesh;
+	std::vector<BatchRange> ranges;
+};
+
+// Collects static meshes at load time and groups them by material
+class StaticBatchBuilder {
+public:
+	// Transform the mesh into world space and append it to its material's group
+	// normalMatrix is the inverse transpose of the model matrix's upper 3x3
+	void add(const MeshData& mesh, const glm::mat4& model, const glm::mat3& normalMatrix, const BatchMaterial& material);
+
+	// Upload the merged buffers with one index range per material
+	StaticBatch build() const;
+
+private:
+	struct Group {
+		BatchMaterial material;
+		MeshData data;
+	};
+
+	std::vector<Group> groups;
+};
+
+// Release the batch's GL objects
+void deleteStaticBatch(StaticBatch& batch);
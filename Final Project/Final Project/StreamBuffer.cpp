@@ -0,0 +1,90 @@
+#include "StreamBuffer.h"
+
+using namespace std;
+
+namespace {
+	// Nanoseconds to block on a fence before checking again
+	const GLuint64 FENCE_TIMEOUT = 1000000000;
+}
+
+StreamBuffer::StreamBuffer(GLsizeiptr size) : name(0), mapped(nullptr), regionSize(0), region(0), used(0) {
+	for (int i = 0; i < STREAM_BUFFER_FRAMES; i++)
+		fences[i] = 0;
+
+	create(size);
+}
+
+StreamBuffer::~StreamBuffer() {
+	release();
+}
+
+void StreamBuffer::create(GLsizeiptr size) {
+	regionSize = size;
+
+	// Immutable storage stays mapped for the buffer's lifetime; coherent writes need no flush before the GPU reads them
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	glGenBuffers(1, &name);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, name);
+	glBufferStorage(GL_COPY_WRITE_BUFFER, regionSize * STREAM_BUFFER_FRAMES, nullptr, flags);
+	mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, regionSize * STREAM_BUFFER_FRAMES, flags);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void StreamBuffer::release() {
+	for (int i = 0; i < STREAM_BUFFER_FRAMES; i++) {
+		if (fences[i] != 0)
+			glDeleteSync(fences[i]);
+		fences[i] = 0;
+	}
+
+	// Deleting a mapped buffer unmaps it; draws already issued keep its storage alive until they finish
+	glDeleteBuffers(1, &name);
+	name = 0;
+	mapped = nullptr;
+}
+
+void StreamBuffer::beginFrame() {
+	region = (region + 1) % STREAM_BUFFER_FRAMES;
+	used = 0;
+
+	GLsync fence = fences[region];
+	if (fence == 0)
+		return;
+
+	// With three regions the fence has almost always signaled; block only when the GPU is that far behind
+	GLenum status;
+	do {
+		status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+	} while (status == GL_TIMEOUT_EXPIRED);
+
+	glDeleteSync(fence);
+	fences[region] = 0;
+}
+
+void StreamBuffer::endFrame() {
+	if (fences[region] != 0)
+		glDeleteSync(fences[region]);
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+GLintptr StreamBuffer::allocate(GLsizeiptr size, GLint alignment, void** data) {
+	GLsizeiptr offset = (used + alignment - 1) / alignment * alignment;
+
+	// Out of room: replace the buffer with one twice the size, which keeps every region start aligned, and start the region over
+	if (offset + size > regionSize) {
+		GLsizeiptr grown = regionSize * 2;
+		while (grown < size)
+			grown *= 2;
+
+		release();
+		create(grown);
+		offset = 0;
+	}
+
+	used = offset + size;
+
+	GLintptr start = region * regionSize + offset;
+	*data = mapped + start;
+	return start;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <GLEW/glew.h>
+
+#include <cstddef>
+
+// Frames the CPU may write ahead of the GPU; each has its own region of the buffer
+const int STREAM_BUFFER_FRAMES = 3;
+
+// Persistently mapped buffer for data written every frame and bound by offset
+// The CPU writes one region while the GPU reads the others; a fence per region keeps it from overwriting data still in use
+class StreamBuffer {
+public:
+	// Bytes each frame's region starts with, a power of two so region starts meet any offset alignment
+	// A region that overflows grows the whole buffer
+	explicit StreamBuffer(GLsizeiptr size);
+	~StreamBuffer();
+
+	// Move to the next region, waiting for the GPU to finish the frame that last used it
+	void beginFrame();
+
+	// Fence the region once every command reading it has been issued
+	void endFrame();
+
+	// Reserve size bytes at a multiple of alignment and return the offset to bind; data points at where to write them
+	// Growing replaces buffer(), so bind each allocation before making the next
+	GLintptr allocate(GLsizeiptr size, GLint alignment, void** data);
+
+	GLuint buffer() const { return name; }
+
+private:
+	StreamBuffer(const StreamBuffer&);
+	StreamBuffer& operator=(const StreamBuffer&);
+
+	void create(GLsizeiptr size);
+	void release();
+
+	GLuint name;
+	unsigned char* mapped;
+	GLsizeiptr regionSize;
+	int region;
+	GLsizeiptr used; // Bytes written to the current region this frame
+	GLsync fences[STREAM_BUFFER_FRAMES];
+};
@@ -0,0 +1,154 @@
+#include "TextOverlay.h"
+
+#include <cctype>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+	const int FONT_GLYPH_WIDTH = 5;
+	const int FONT_GLYPH_HEIGHT = 7;
+
+	// Characters in the order of their glyphs; anything else is drawn as a space
+	const char FONT_CHARACTERS[] = " 0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ.,:-_/%|()";
+
+	// 5x7 glyphs, one byte per row from the top, bit 4 the leftmost pixel
+	const unsigned char FONT_GLYPHS[][FONT_GLYPH_HEIGHT] = {
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ' '
+		{ 0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e }, // '0'
+		{ 0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e }, // '1'
+		{ 0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f }, // '2'
+		{ 0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e }, // '3'
+		{ 0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02 }, // '4'
+		{ 0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e }, // '5'
+		{ 0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e }, // '6'
+		{ 0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 }, // '7'
+		{ 0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e }, // '8'
+		{ 0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c }, // '9'
+		{ 0x0e, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11 }, // 'A'
+		{ 0x1e, 0x11, 0x11, 0x1e, 0x11, 0x11, 0x1e }, // 'B'
+		{ 0x0e, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0e }, // 'C'
+		{ 0x1c, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1c }, // 'D'
+		{ 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f }, // 'E'
+		{ 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x10 }, // 'F'
+		{ 0x0e, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0f }, // 'G'
+		{ 0x11, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11 }, // 'H'
+		{ 0x0e, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e }, // 'I'
+		{ 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0c }, // 'J'
+		{ 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 }, // 'K'
+		{ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1f }, // 'L'
+		{ 0x11, 0x1b, 0x15, 0x15, 0x11, 0x11, 0x11 }, // 'M'
+		{ 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 }, // 'N'
+		{ 0x0e, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e }, // 'O'
+		{ 0x1e, 0x11, 0x11, 0x1e, 0x10, 0x10, 0x10 }, // 'P'
+		{ 0x0e, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0d }, // 'Q'
+		{ 0x1e, 0x11, 0x11, 0x1e, 0x14, 0x12, 0x11 }, // 'R'
+		{ 0x0f, 0x10, 0x10, 0x0e, 0x01, 0x01, 0x1e }, // 'S'
+		{ 0x1f, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 }, // 'T'
+		{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e }, // 'U'
+		{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x0a, 0x04 }, // 'V'
+		{ 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0a }, // 'W'
+		{ 0x11, 0x11, 0x0a, 0x04, 0x0a, 0x11, 0x11 }, // 'X'
+		{ 0x11, 0x11, 0x0a, 0x04, 0x04, 0x04, 0x04 }, // 'Y'
+		{ 0x1f, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1f }, // 'Z'
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0c }, // '.'
+		{ 0x00, 0x00, 0x00, 0x00, 0x0c, 0x04, 0x08 }, // ','
+		{ 0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x0c, 0x00 }, // ':'
+		{ 0x00, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x00 }, // '-'
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1f }, // '_'
+		{ 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 }, // '/'
+		{ 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 }, // '%'
+		{ 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 }, // '|'
+		{ 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 }, // '('
+		{ 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 }  // ')'
+	};
+
+
+	const int FONT_GLYPH_COUNT = (int)(sizeof(FONT_GLYPHS) / sizeof(FONT_GLYPHS[0]));
+
+	GLshort glyphIndex(char character) {
+		const char* found = strchr(FONT_CHARACTERS, toupper((unsigned char)character));
+		return found != nullptr && *found != '\0' ? (GLshort)(found - FONT_CHARACTERS) : 0;
+	}
+}
+
+TextOverlay::TextOverlay() : changed(false) {
+	// Unpack the glyph bits into one texel per font pixel
+	vector<unsigned char> pixels(FONT_GLYPH_COUNT * FONT_GLYPH_WIDTH * FONT_GLYPH_HEIGHT, 0);
+	for (int glyph = 0; glyph < FONT_GLYPH_COUNT; glyph++) {
+		for (int y = 0; y < FONT_GLYPH_HEIGHT; y++) {
+			for (int x = 0; x < FONT_GLYPH_WIDTH; x++) {
+				if (FONT_GLYPHS[glyph][y] & (1 << (FONT_GLYPH_WIDTH - 1 - x)))
+					pixels[y * FONT_GLYPH_COUNT * FONT_GLYPH_WIDTH + glyph * FONT_GLYPH_WIDTH + x] = 255;
+			}
+		}
+	}
+
+	glGenTextures(1, &font);
+	glBindTexture(GL_TEXTURE_2D, font);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, FONT_GLYPH_COUNT * FONT_GLYPH_WIDTH, FONT_GLYPH_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &vbo);
+
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+	// Column, row and glyph of each cell; the quad's corners come from gl_VertexID
+	glVertexAttribIPointer(0, 3, GL_SHORT, sizeof(Cell), (GLvoid*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribDivisor(0, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+TextOverlay::~TextOverlay() {
+	glDeleteVertexArrays(1, &vao);
+	glDeleteBuffers(1, &vbo);
+	glDeleteTextures(1, &font);
+}
+
+void TextOverlay::clear() {
+	cells.clear();
+	changed = true;
+}
+
+void TextOverlay::print(int column, int row, const string& text) {
+	// Spaces get a cell too, so each line has an unbroken background
+	for (size_t i = 0; i < text.size(); i++) {
+		Cell cell = { (GLshort)(column + i), (GLshort)row, glyphIndex(text[i]), 0 };
+		cells.push_back(cell);
+	}
+	changed = true;
+}
+
+void TextOverlay::draw() {
+	if (cells.empty())
+		return;
+
+	// Text only changes a few times a second, so re-upload it whole
+	if (changed) {
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(cells.size() * sizeof(Cell)), cells.data(), GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		changed = false;
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, font);
+
+	glBindVertexArray(vao); // Bind VAO
+
+	// Draw primitive(s)
+	glDrawArraysInstanced(GL_TRIANGLES, 0, 6, (GLsizei)cells.size());
+
+	glBindVertexArray(0); // Unbind VAO
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
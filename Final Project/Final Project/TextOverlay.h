@@ -0,0 +1,42 @@
+#pragma once
+
+#include <GLEW/glew.h>
+
+#include <string>
+#include <vector>
+
+// Size of a character cell in font pixels: a 5x7 glyph with one pixel of spacing around it
+const int TEXT_CELL_WIDTH = 6;
+const int TEXT_CELL_HEIGHT = 9;
+
+// Fixed-width text drawn over the frame from a built-in 5x7 font
+// Lowercase letters are drawn as uppercase; characters the font lacks are drawn as spaces
+class TextOverlay {
+public:
+	TextOverlay();
+	~TextOverlay();
+
+	void clear();
+
+	// Add text starting at a character cell counted from the top-left corner
+	void print(int column, int row, const std::string& text);
+
+	// Draw every cell as one instanced quad with the font on unit 0; the caller sets the program and blending
+	void draw();
+
+private:
+	TextOverlay(const TextOverlay&);
+	TextOverlay& operator=(const TextOverlay&);
+
+	// Per-instance vertex attribute
+	struct Cell {
+		GLshort column, row;
+		GLshort glyph;
+		GLshort padding;
+	};
+
+	std::vector<Cell> cells;
+	bool changed;
+	GLuint vao, vbo;
+	GLuint font; // GL_R8 texture with the glyphs side by side
+};
@@ -0,0 +1,333 @@
+#include "TextureBake.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+
+// DDS container layout (little-endian)
+static const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+static const uint32_t DDSD_CAPS = 0x1, DDSD_HEIGHT = 0x2, DDSD_WIDTH = 0x4, DDSD_PIXELFORMAT = 0x1000;
+static const uint32_t DDSD_MIPMAPCOUNT = 0x20000, DDSD_LINEARSIZE = 0x80000;
+static const uint32_t DDPF_FOURCC = 0x4;
+static const uint32_t DDSCAPS_COMPLEX = 0x8, DDSCAPS_TEXTURE = 0x1000, DDSCAPS_MIPMAP = 0x400000;
+static const uint32_t FOURCC_DXT1 = 0x31545844, FOURCC_DXT5 = 0x35545844;
+
+struct DDSPixelFormat {
+	uint32_t size, flags, fourCC, rgbBitCount, rMask, gMask, bMask, aMask;
+};
+
+struct DDSHeader {
+	uint32_t size, flags, height, width, pitchOrLinearSize, depth, mipMapCount;
+	uint32_t reserved1[11];
+	DDSPixelFormat pixelFormat;
+	uint32_t caps, caps2, caps3, caps4, reserved2;
+};
+
+static_assert(sizeof(DDSHeader) == 124, "DDS header must be 124 bytes");
+
+// Bytes used by one level of a block-compressed image
+static size_t levelSize(int width, int height, size_t blockBytes) {
+	return static_cast<size_t>((width + 3) / 4) * static_cast<size_t>((height + 3) / 4) * blockBytes;
+}
+
+string bakedTexturePath(const string& source) {
+	size_t dot = source.find_last_of('.');
+	return (dot == string::npos ? source : source.substr(0, dot)) + ".dds";
+}
+
+bool bakedTextureIsCurrent(const string& source, const string& baked) {
+	struct stat sourceInfo, bakedInfo;
+	if (stat(baked.c_str(), &bakedInfo) != 0)
+		return false;
+
+	// A baked file without its source is still usable
+	if (stat(source.c_str(), &sourceInfo) != 0)
+		return true;
+
+	return bakedInfo.st_mtime >= sourceInfo.st_mtime;
+}
+
+void downsampleImage(const unsigned char* source, int width, int height, int channels, vector<unsigned char>& destination) {
+	int halfWidth = max(1, width / 2);
+	int halfHeight = max(1, height / 2);
+	destination.resize(static_cast<size_t>(halfWidth) * halfHeight * channels);
+
+	for (int y = 0; y < halfHeight; y++) {
+		int y0 = min(y * 2, height - 1), y1 = min(y * 2 + 1, height - 1);
+		for (int x = 0; x < halfWidth; x++) {
+			int x0 = min(x * 2, width - 1), x1 = min(x * 2 + 1, width - 1);
+			for (int c = 0; c < channels; c++) {
+				int sum = source[(y0 * width + x0) * channels + c] + source[(y0 * width + x1) * channels + c]
+					+ source[(y1 * width + x0) * channels + c] + source[(y1 * width + x1) * channels + c];
+				destination[(static_cast<size_t>(y) * halfWidth + x) * channels + c] = static_cast<unsigned char>((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+// Quantize an RGB color to 5:6:5
+static uint16_t pack565(const float color[3]) {
+	int r = static_cast<int>(lroundf(min(max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f));
+	int g = static_cast<int>(lroundf(min(max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f));
+	int b = static_cast<int>(lroundf(min(max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f));
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+// Expand a 5:6:5 color back to 8 bits per channel
+static void unpack565(uint16_t packed, int color[3]) {
+	int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+// Encode 16 RGBA pixels as a BC1 color block, fitting endpoints along the principal axis
+static void encodeColorBlock(const unsigned char block[16][4], unsigned char* out) {
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+		for (int c = 0; c < 3; c++)
+			mean[c] += block[i][c] / 16.0f;
+
+	float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++) {
+		float r = block[i][0] - mean[0], g = block[i][1] - mean[1], b = block[i][2] - mean[2];
+		covariance[0] += r * r; covariance[1] += r * g; covariance[2] += r * b;
+		covariance[3] += g * g; covariance[4] += g * b; covariance[5] += b * b;
+	}
+
+	// Power iteration for the dominant color axis
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+	for (int iteration = 0; iteration < 8; iteration++) {
+		float next[3] = {
+			covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+			covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+			covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]
+		};
+		float length = sqrtf(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+		if (length < 1e-6f)
+			break;
+		for (int c = 0; c < 3; c++)
+			axis[c] = next[c] / length;
+	}
+
+	float minProjection = 0.0f, maxProjection = 0.0f;
+	for (int i = 0; i < 16; i++) {
+		float projection = (block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] + (block[i][2] - mean[2]) * axis[2];
+		minProjection = min(minProjection, projection);
+		maxProjection = max(maxProjection, projection);
+	}
+
+	// Inset the endpoints slightly to reduce the error of the interpolated colors
+	float inset = (maxProjection - minProjection) / 16.0f;
+	minProjection += inset;
+	maxProjection -= inset;
+
+	float endpoint0[3], endpoint1[3];
+	for (int c = 0; c < 3; c++) {
+		endpoint0[c] = mean[c] + axis[c] * maxProjection;
+		endpoint1[c] = mean[c] + axis[c] * minProjection;
+	}
+
+	uint16_t color0 = pack565(endpoint0);
+	uint16_t color1 = pack565(endpoint1);
+
+	// color0 > color1 selects four-color mode
+	if (color0 < color1)
+		swap(color0, color1);
+
+	uint32_t indices = 0;
+	if (color0 != color1) {
+		int palette[4][3];
+		unpack565(color0, palette[0]);
+		unpack565(color1, palette[1]);
+		for (int c = 0; c < 3; c++) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		for (int i = 0; i < 16; i++) {
+			int best = 0, bestError = INT32_MAX;
+			for (int p = 0; p < 4; p++) {
+				int dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1], db = block[i][2] - palette[p][2];
+				int error = dr * dr + dg * dg + db * db;
+				if (error < bestError) {
+					bestError = error;
+					best = p;
+				}
+			}
+			indices |= static_cast<uint32_t>(best) << (i * 2);
+		}
+	}
+
+	out[0] = color0 & 0xFF;
+	out[1] = color0 >> 8;
+	out[2] = color1 & 0xFF;
+	out[3] = color1 >> 8;
+	for (int i = 0; i < 4; i++)
+		out[4 + i] = (indices >> (i * 8)) & 0xFF;
+}
+
+// Encode the alpha channel of 16 pixels as a BC3 alpha block
+static void encodeAlphaBlock(const unsigned char block[16][4], unsigned char* out) {
+	int alpha0 = 0, alpha1 = 255;
+	for (int i = 0; i < 16; i++) {
+		alpha0 = max(alpha0, static_cast<int>(block[i][3]));
+		alpha1 = min(alpha1, static_cast<int>(block[i][3]));
+	}
+
+	uint64_t indices = 0;
+	if (alpha0 != alpha1) {
+		// alpha0 > alpha1 selects eight interpolated values
+		int palette[8] = { alpha0, alpha1 };
+		for (int p = 1; p < 7; p++)
+			palette[p + 1] = ((7 - p) * alpha0 + p * alpha1) / 7;
+
+		for (int i = 0; i < 16; i++) {
+			int best = 0, bestError = 256;
+			for (int p = 0; p < 8; p++) {
+				int error = abs(block[i][3] - palette[p]);
+				if (error < bestError) {
+					bestError = error;
+					best = p;
+				}
+			}
+			indices |= static_cast<uint64_t>(best) << (i * 3);
+		}
+	}
+
+	out[0] = static_cast<unsigned char>(alpha0);
+	out[1] = static_cast<unsigned char>(alpha1);
+	for (int i = 0; i < 6; i++)
+		out[2 + i] = (indices >> (i * 8)) & 0xFF;
+}
+
+// Block-compress one RGBA8 level, replicating edge pixels for partial blocks
+static void compressLevel(const unsigned char* rgba, int width, int height, bool hasAlpha, unsigned char* out) {
+	size_t blockBytes = hasAlpha ? 16 : 8;
+
+	for (int by = 0; by < height; by += 4) {
+		for (int bx = 0; bx < width; bx += 4) {
+			unsigned char block[16][4];
+			for (int y = 0; y < 4; y++) {
+				for (int x = 0; x < 4; x++) {
+					int sx = min(bx + x, width - 1), sy = min(by + y, height - 1);
+					memcpy(block[y * 4 + x], rgba + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+				}
+			}
+
+			if (hasAlpha) {
+				encodeAlphaBlock(block, out);
+				encodeColorBlock(block, out + 8);
+			}
+			else {
+				encodeColorBlock(block, out);
+			}
+			out += blockBytes;
+		}
+	}
+}
+
+size_t bakeTexture(const unsigned char* rgba, int width, int height, bool hasAlpha, const string& destination) {
+	if (rgba == nullptr || width <= 0 || height <= 0)
+		return 0;
+
+	size_t blockBytes = hasAlpha ? 16 : 8;
+	int levelCount = 1 + static_cast<int>(floor(log2(static_cast<double>(max(width, height)))));
+
+	DDSHeader header = {};
+	header.size = sizeof(DDSHeader);
+	header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+	header.height = height;
+	header.width = width;
+	header.pitchOrLinearSize = static_cast<uint32_t>(levelSize(width, height, blockBytes));
+	header.mipMapCount = levelCount;
+	header.pixelFormat.size = sizeof(DDSPixelFormat);
+	header.pixelFormat.flags = DDPF_FOURCC;
+	header.pixelFormat.fourCC = hasAlpha ? FOURCC_DXT5 : FOURCC_DXT1;
+	header.caps = DDSCAPS_TEXTURE | DDSCAPS_MIPMAP | DDSCAPS_COMPLEX;
+
+	ofstream file(destination, ios::binary | ios::trunc);
+	if (!file)
+		return 0;
+
+	file.write(reinterpret_cast<const char*>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	// Compress each level, then box-filter it down for the next one
+	vector<unsigned char> level(rgba, rgba + static_cast<size_t>(width) * height * 4);
+	vector<unsigned char> nextLevel, compressed;
+	int levelWidth = width, levelHeight = height;
+
+	for (int i = 0; i < levelCount; i++) {
+		compressed.resize(levelSize(levelWidth, levelHeight, blockBytes));
+		compressLevel(level.data(), levelWidth, levelHeight, hasAlpha, compressed.data());
+		file.write(reinterpret_cast<const char*>(compressed.data()), compressed.size());
+
+		if (i + 1 < levelCount) {
+			downsampleImage(level.data(), levelWidth, levelHeight, 4, nextLevel);
+			level.swap(nextLevel);
+			levelWidth = max(1, levelWidth / 2);
+			levelHeight = max(1, levelHeight / 2);
+		}
+	}
+
+	if (!file)
+		return 0;
+	return static_cast<size_t>(file.tellp());
+}
+
+bool parseBakedTexture(const unsigned char* data, size_t size, BakedTexture& texture) {
+	if (data == nullptr || size < sizeof(DDS_MAGIC) + sizeof(DDSHeader))
+		return false;
+
+	uint32_t magic;
+	DDSHeader header;
+	memcpy(&magic, data, sizeof(magic));
+	memcpy(&header, data + sizeof(magic), sizeof(header));
+
+	if (magic != DDS_MAGIC || header.size != sizeof(DDSHeader) || !(header.pixelFormat.flags & DDPF_FOURCC))
+		return false;
+
+	size_t blockBytes;
+	if (header.pixelFormat.fourCC == FOURCC_DXT1) {
+		texture.format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		blockBytes = 8;
+	}
+	else if (header.pixelFormat.fourCC == FOURCC_DXT5) {
+		texture.format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		blockBytes = 16;
+	}
+	else {
+		return false;
+	}
+
+	texture.width = static_cast<int>(header.width);
+	texture.height = static_cast<int>(header.height);
+	texture.levels.clear();
+
+	int levelCount = (header.flags & DDSD_MIPMAPCOUNT) && header.mipMapCount > 0 ? static_cast<int>(header.mipMapCount) : 1;
+	size_t offset = sizeof(magic) + sizeof(header);
+	int levelWidth = texture.width, levelHeight = texture.height;
+
+	for (int i = 0; i < levelCount; i++) {
+		size_t bytes = levelSize(levelWidth, levelHeight, blockBytes);
+		if (offset + bytes > size)
+			return false;
+
+		BakedLevel level = { levelWidth, levelHeight, data + offset, static_cast<GLsizei>(bytes) };
+		texture.levels.push_back(level);
+
+		offset += bytes;
+		levelWidth = max(1, levelWidth / 2);
+		levelHeight = max(1, levelHeight / 2);
+	}
+
+	return true;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <GLEW/glew.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Mip level of a baked texture; data points into the buffer that was parsed
+struct BakedLevel {
+	int width, height;
+	const unsigned char* data;
+	GLsizei size;
+};
+
+// BC1/BC3 texture with a precomputed mip chain
+struct BakedTexture {
+	GLenum format; // GL_COMPRESSED_RGB_S3TC_DXT1_EXT or GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+	int width, height;
+	std::vector<BakedLevel> levels;
+};
+
+// Path of the baked container for a source image (foo.jpg -> foo.dds)
+std::string bakedTexturePath(const std::string& source);
+
+// True if the baked file exists and is not older than its source image
+bool bakedTextureIsCurrent(const std::string& source, const std::string& baked);
+
+// Compress RGBA8 pixels into a DDS file with a full mip chain (BC3 if hasAlpha, otherwise BC1)
+// Returns the number of bytes written, or 0 on failure
+size_t bakeTexture(const unsigned char* rgba, int width, int height, bool hasAlpha, const std::string& destination);
+
+// Parse a DDS file written by bakeTexture
+bool parseBakedTexture(const unsigned char* data, size_t size, BakedTexture& texture);
+
+// Halve an image of 8-bit channels (3 for RGB, 4 for RGBA) with a 2x2 box filter
+void downsampleImage(const unsigned char* source, int width, int height, int channels, std::vector<unsigned char>& destination);
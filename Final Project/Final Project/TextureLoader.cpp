@@ -0,0 +1,699 @@
+#include "TextureLoader.h"
+#include "MappedFile.h"
+#include "TextureBake.h"
+
+#include <SOIL2/SOIL2.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+using namespace std;
+
+// Size of a file on disk, used to schedule the largest decodes first
+static streamoff fileSize(const string& path) {
+	ifstream file(path, ios::binary | ios::ate);
+	return file ? static_cast<streamoff>(file.tellg()) : 0;
+}
+
+// White texels the texture shows before its images arrive, and again if it has to start loading over
+static void specifyPlaceholder(const TextureAsset& asset) {
+	vector<GLubyte> placeholder(asset.files.size() * 3, 255);
+	glBindTexture(asset.target, asset.texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	if (asset.target == GL_TEXTURE_2D_ARRAY)
+		glTexImage3D(asset.target, 0, GL_RGB, 1, 1, static_cast<GLsizei>(asset.files.size()), 0, GL_RGB, GL_UNSIGNED_BYTE, placeholder.data());
+	else
+		glTexImage2D(asset.target, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, placeholder.data());
+	// Only level 0 exists, so without this the default mipmapping min filter leaves the texture incomplete and it samples black
+	glTexParameteri(asset.target, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(asset.target, GL_TEXTURE_MAX_LEVEL, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(asset.target, 0);
+}
+
+TextureLoader::TextureLoader(unsigned workerCount)
+	: workerCount(workerCount), serial(false), useBaked(true), stopping(false), completed(0),
+	budgetBytes(0), residentTotal(0), frame(0), evictions(0), finishMs(0.0) {
+	// Leave one hardware thread for the GL thread
+	if (this->workerCount == 0) {
+		unsigned hardwareThreads = thread::hardware_concurrency();
+		this->workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+}
+
+TextureLoader::~TextureLoader() {
+	// Stop handing out jobs and wait for in-flight decodes
+	{
+		lock_guard<mutex> lock(jobMutex);
+		stopping = true;
+	}
+	jobQueued.notify_all();
+	for (thread& worker : workers)
+		worker.join();
+}
+
+GLuint TextureLoader::add(const string& path, int channels) {
+	return addAsset(path, vector<string>(1, path), GL_TEXTURE_2D, channels);
+}
+
+GLuint TextureLoader::addArray(const vector<string>& paths, int channels) {
+	return addAsset(paths.front() + " [" + to_string(paths.size()) + " layers]", paths, GL_TEXTURE_2D_ARRAY, channels);
+}
+
+GLuint TextureLoader::addAsset(const string& name, const vector<string>& files, GLenum target, int channels) {
+	TextureAsset asset = {};
+	asset.name = name;
+	asset.files = files;
+	asset.target = target;
+	asset.channels = channels;
+
+	// Create texture with the placeholder so it can be bound before the images arrive
+	glGenTextures(1, &asset.texture);
+	specifyPlaceholder(asset);
+
+	assets.push_back(asset);
+
+	AssetStream stream = {};
+	stream.layers.resize(files.size());
+	streams.push_back(stream);
+	return asset.texture;
+}
+
+void TextureLoader::setUseBakedTextures(bool useBaked) {
+	this->useBaked = useBaked;
+}
+
+void TextureLoader::queueJobs() {
+	vector<LayerJob> decodeJobs;
+	bakedJobs.clear();
+
+	// Baked textures need no decoding; an array is only baked if every layer is
+	for (size_t i = 0; i < assets.size(); i++) {
+		TextureAsset& asset = assets[i];
+
+		asset.baked = useBaked;
+		for (const string& file : asset.files)
+			asset.baked = asset.baked && bakedTextureIsCurrent(file, bakedTexturePath(file));
+
+		for (int layer = 0; layer < static_cast<int>(asset.files.size()); layer++) {
+			LayerJob job = { i, layer };
+			if (asset.baked)
+				bakedJobs.push_back(job);
+			else
+				decodeJobs.push_back(job);
+		}
+
+		streams[i].loading = true;
+	}
+
+	// Decode the largest files first so one big image does not finish last
+	vector<streamoff> sizes;
+	for (const LayerJob& job : decodeJobs)
+		sizes.push_back(fileSize(assets[job.asset].files[job.layer]));
+
+	vector<size_t> order(decodeJobs.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+
+	lock_guard<mutex> lock(jobMutex);
+	jobs.clear();
+	for (size_t i : order)
+		jobs.push_back(decodeJobs[i]);
+}
+
+void TextureLoader::requestLoad(size_t index) {
+	TextureAsset& asset = assets[index];
+	AssetStream& stream = streams[index];
+
+	stream.layers.assign(asset.files.size(), LayerLevels());
+	stream.loading = true;
+	asset.layersReady = 0;
+
+	for (int layer = 0; layer < static_cast<int>(asset.files.size()); layer++) {
+		LayerJob job = { index, layer };
+		if (asset.baked) {
+			bakedJobs.push_back(job);
+		}
+		else if (serial || workers.empty()) {
+			// No decode threads when everything started out baked
+			DecodedImage image = decode(job);
+			arrived(image);
+		}
+		else {
+			lock_guard<mutex> lock(jobMutex);
+			jobs.push_back(job);
+		}
+	}
+
+	jobQueued.notify_all();
+}
+
+void TextureLoader::start() {
+	startTime = chrono::steady_clock::now();
+	queueJobs();
+
+	// Workers stay up while the loader exists, to decode textures reloaded after eviction
+	bool anyDecoded = false;
+	for (const TextureAsset& asset : assets)
+		anyDecoded = anyDecoded || !asset.baked;
+
+	if (anyDecoded) {
+		for (unsigned i = 0; i < workerCount; i++)
+			workers.emplace_back(&TextureLoader::workerMain, this);
+	}
+}
+
+void TextureLoader::loadAllSerial() {
+	serial = true;
+	startTime = chrono::steady_clock::now();
+	queueJobs();
+
+	while (!bakedJobs.empty()) {
+		LayerJob job = bakedJobs.front();
+		bakedJobs.pop_front();
+
+		DecodedImage image;
+		if (mapBaked(job, image))
+			arrived(image);
+		else
+			restartDecoded(job.asset);
+	}
+
+	while (!jobs.empty()) {
+		DecodedImage image = decode(jobs.front());
+		jobs.pop_front();
+		arrived(image);
+	}
+
+	while (streamNext()) {
+	}
+}
+
+TextureLoader::DecodedImage TextureLoader::decode(const LayerJob& job) const {
+	const TextureAsset& asset = assets[job.asset];
+	DecodedImage image = {};
+	image.job = job;
+
+	chrono::steady_clock::time_point decodeStart = chrono::steady_clock::now();
+	int width, height;
+	unsigned char* pixels = SOIL_load_image(asset.files[job.layer].c_str(), &width, &height, 0, asset.channels);
+
+	// Box-filter the mip chain here rather than with glGenerateMipmap, so the GL thread can upload it a level at a time
+	if (pixels != nullptr) {
+		LayerLevels& layer = image.layer;
+		layer.pixels.push_back(vector<unsigned char>(pixels, pixels + static_cast<size_t>(width) * height * asset.channels));
+		SOIL_free_image_data(pixels);
+
+		while (true) {
+			BakedLevel level = { width, height, nullptr, static_cast<GLsizei>(layer.pixels.back().size()) };
+			layer.levels.push_back(level);
+			if (width == 1 && height == 1)
+				break;
+
+			vector<unsigned char> next;
+			downsampleImage(layer.pixels.back().data(), width, height, asset.channels, next);
+			layer.pixels.push_back(move(next));
+			width = max(1, width / 2);
+			height = max(1, height / 2);
+		}
+	}
+
+	image.decodeMs = chrono::duration<double, milli>(chrono::steady_clock::now() - decodeStart).count();
+	return image;
+}
+
+void TextureLoader::workerMain() {
+	while (true) {
+		LayerJob job;
+		{
+			unique_lock<mutex> lock(jobMutex);
+			jobQueued.wait(lock, [this] { return stopping || !jobs.empty(); });
+			if (stopping)
+				return;
+			job = jobs.front();
+			jobs.pop_front();
+		}
+
+		DecodedImage image = decode(job);
+
+		lock_guard<mutex> lock(readyMutex);
+		ready.push_back(move(image));
+	}
+}
+
+void TextureLoader::beginFrame() {
+	frame++;
+}
+
+int TextureLoader::uploadReady(double budgetMs) {
+	chrono::steady_clock::time_point frameStart = chrono::steady_clock::now();
+	int uploaded = 0;
+
+	// Reload textures used this frame whose dropped levels now fit
+	for (size_t i = 0; i < assets.size(); i++) {
+		const TextureAsset& asset = assets[i];
+		const AssetStream& stream = streams[i];
+		if (asset.resident && asset.residentLevel > 0 && !stream.loading && asset.layersReady == 0 && stream.lastUsed == frame
+			&& makeRoom(stream.levelBytes[asset.residentLevel - 1], i, false))
+			requestLoad(i);
+	}
+
+	// Baked textures are mapped straight from the file
+	while (!bakedJobs.empty() && (uploaded == 0 || chrono::duration<double, milli>(chrono::steady_clock::now() - frameStart).count() < budgetMs)) {
+		LayerJob job = bakedJobs.front();
+		bakedJobs.pop_front();
+
+		// Fall back to decoding the source images if the baked file is unusable
+		DecodedImage image;
+		if (mapBaked(job, image))
+			arrived(image);
+		else
+			restartDecoded(job.asset);
+		uploaded++;
+	}
+
+	// Always upload at least one image so loading makes progress on slow frames
+	while (uploaded == 0 || chrono::duration<double, milli>(chrono::steady_clock::now() - frameStart).count() < budgetMs) {
+		DecodedImage image;
+		{
+			lock_guard<mutex> lock(readyMutex);
+			if (ready.empty())
+				break;
+			image = move(ready.front());
+			ready.pop_front();
+		}
+
+		arrived(image);
+		uploaded++;
+	}
+
+	// Spend what is left of the budget on finer levels
+	while ((uploaded == 0 || chrono::duration<double, milli>(chrono::steady_clock::now() - frameStart).count() < budgetMs) && streamNext())
+		uploaded++;
+
+	// Coarse levels of new arrivals are always uploaded, so they can push the total over
+	makeRoom(0, assets.size(), true);
+
+	return uploaded;
+}
+
+void TextureLoader::setPriority(GLuint texture, float priority) {
+	for (size_t i = 0; i < assets.size(); i++) {
+		if (assets[i].texture != texture)
+			continue;
+
+		streams[i].priority = priority;
+		if (priority > 0.0f)
+			streams[i].lastUsed = frame;
+	}
+}
+
+unsigned TextureLoader::version(GLuint texture) const {
+	for (size_t i = 0; i < assets.size(); i++) {
+		if (assets[i].texture == texture)
+			return assets[i].version;
+	}
+	return 0;
+}
+
+void TextureLoader::setBudget(size_t bytes) {
+	budgetBytes = bytes;
+	makeRoom(0, assets.size(), true);
+}
+
+bool TextureLoader::mapBaked(const LayerJob& job, DecodedImage& image) {
+	TextureAsset& asset = assets[job.asset];
+	string path = bakedTexturePath(asset.files[job.layer]);
+
+	// The driver copies the compressed levels directly out of the mapping, which stays open until they are uploaded
+	shared_ptr<MappedFile> file(new MappedFile());
+	BakedTexture baked;
+	if (!file->open(path) || !parseBakedTexture(file->data(), file->size(), baked)) {
+		cout << "Failed to load baked texture " << path << ", decoding " << asset.name << endl;
+		return false;
+	}
+
+	image = DecodedImage();
+	image.job = job;
+	image.layer.format = baked.format;
+	image.layer.levels = baked.levels;
+	image.layer.file = file;
+	return true;
+}
+
+void TextureLoader::restartDecoded(size_t index) {
+	TextureAsset& asset = assets[index];
+	AssetStream& stream = streams[index];
+
+	// Every layer of an asset shares one format, so no other baked layer of this load may arrive
+	bakedJobs.erase(remove_if(bakedJobs.begin(), bakedJobs.end(), [index](const LayerJob& job) { return job.asset == index; }), bakedJobs.end());
+	asset.baked = false;
+
+	// Levels allocated in the compressed format give way to the placeholder until the decoded levels are resident
+	if (asset.resident) {
+		specifyPlaceholder(asset);
+		residentTotal -= asset.bytes;
+		asset.bytes = 0;
+		asset.resident = false;
+		asset.version++;
+	}
+
+	asset.width = 0;
+	asset.height = 0;
+	asset.levels = 0;
+	asset.residentLevel = 0;
+	stream.format = 0;
+	stream.levelBytes.clear();
+
+	requestLoad(index);
+}
+
+void TextureLoader::arrived(DecodedImage& image) {
+	TextureAsset& asset = assets[image.job.asset];
+	AssetStream& stream = streams[image.job.asset];
+	const string& file = asset.files[image.job.layer];
+	LayerLevels& layer = image.layer;
+	asset.decodeMs += image.decodeMs;
+
+	if (layer.levels.empty()) {
+		cout << "Failed to load texture " << file << endl;
+	}
+	else if (asset.width == 0) {
+		// The first layer to arrive sets the size and format every other layer must match
+		asset.width = layer.levels[0].width;
+		asset.height = layer.levels[0].height;
+		asset.levels = static_cast<int>(layer.levels.size());
+		stream.format = layer.format;
+	}
+	else if (layer.levels[0].width != asset.width || layer.levels[0].height != asset.height || layer.format != stream.format
+		|| static_cast<int>(layer.levels.size()) != asset.levels) {
+		cout << "Texture " << file << " is " << layer.levels[0].width << "x" << layer.levels[0].height << (layer.format != 0 ? " dds" : " jpg")
+			<< ", expected " << asset.width << "x" << asset.height << (stream.format != 0 ? " dds" : " jpg") << endl;
+		layer = LayerLevels();
+	}
+
+	stream.layers[image.job.layer] = move(layer);
+
+	if (++asset.layersReady < static_cast<int>(asset.files.size()))
+		return;
+
+	stream.loading = false;
+	stream.reference = -1;
+	for (size_t i = 0; i < stream.layers.size() && stream.reference < 0; i++) {
+		if (!stream.layers[i].levels.empty())
+			stream.reference = static_cast<int>(i);
+	}
+
+	// A reload goes on from the level it stopped at
+	if (!asset.resident)
+		makeResident(image.job.asset);
+	else if (stream.reference < 0)
+		releaseSources(image.job.asset);
+}
+
+void TextureLoader::makeResident(size_t index) {
+	TextureAsset& asset = assets[index];
+	AssetStream& stream = streams[index];
+
+	// Nothing loaded, so the placeholder stays
+	if (stream.reference < 0) {
+		releaseSources(index);
+		return;
+	}
+
+	chrono::steady_clock::time_point uploadStart = chrono::steady_clock::now();
+
+	// Uncompressed levels are padded to four bytes per texel by most drivers
+	const vector<BakedLevel>& levels = stream.layers[stream.reference].levels;
+	for (const BakedLevel& level : levels) {
+		size_t bytes = stream.format != 0 ? static_cast<size_t>(level.size) : static_cast<size_t>(level.width) * level.height * 4;
+		stream.levelBytes.push_back(bytes * asset.files.size());
+	}
+
+	// Upload the small levels at once so the texture shows more than the placeholder right away
+	int tail = asset.levels - 1;
+	while (tail > 0 && max(levels[tail - 1].width, levels[tail - 1].height) <= TEXTURE_STREAM_TAIL_SIZE)
+		tail--;
+
+	stream.allocatedLevel = asset.levels;
+	for (int level = asset.levels - 1; level >= tail; level--) {
+		for (int layer = 0; layer < static_cast<int>(stream.layers.size()); layer++)
+			uploadLevel(index, layer, level);
+	}
+
+	// Sampling is clamped to the levels uploaded so far
+	glBindTexture(asset.target, asset.texture);
+	glTexParameteri(asset.target, GL_TEXTURE_BASE_LEVEL, tail);
+	glTexParameteri(asset.target, GL_TEXTURE_MAX_LEVEL, asset.levels - 1);
+	glBindTexture(asset.target, 0);
+
+	asset.uploadMs += chrono::duration<double, milli>(chrono::steady_clock::now() - uploadStart).count();
+	asset.residentLevel = tail;
+	asset.resident = true;
+	asset.version++;
+	asset.readyMs = elapsedMs();
+	stream.tailLevel = tail;
+	stream.nextLayer = 0;
+
+	if (tail == 0)
+		releaseSources(index);
+}
+
+void TextureLoader::uploadLevel(size_t index, int layer, int level) {
+	TextureAsset& asset = assets[index];
+	AssetStream& stream = streams[index];
+	const LayerLevels& source = stream.layers[layer];
+
+	// Layers that failed to load are left undefined
+	if (level >= static_cast<int>(source.levels.size()))
+		return;
+
+	const BakedLevel& data = source.levels[level];
+	const unsigned char* pixels = source.pixels.empty() ? data.data : source.pixels[level].data();
+	GLenum format = asset.channels == SOIL_LOAD_RGBA ? GL_RGBA : GL_RGB;
+	GLsizei layers = static_cast<GLsizei>(asset.files.size());
+
+	glBindTexture(asset.target, asset.texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	if (asset.target == GL_TEXTURE_2D_ARRAY) {
+		// Allocate the level for every layer before its first layer is written
+		if (layer == stream.reference) {
+			if (stream.format != 0)
+				glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, stream.format, data.width, data.height, layers, 0, data.size * layers, nullptr);
+			else
+				glTexImage3D(GL_TEXTURE_2D_ARRAY, level, format, data.width, data.height, layers, 0, format, GL_UNSIGNED_BYTE, nullptr);
+		}
+
+		if (stream.format != 0)
+			glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, data.width, data.height, 1, stream.format, data.size, pixels);
+		else
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, data.width, data.height, 1, format, GL_UNSIGNED_BYTE, pixels);
+	}
+	else {
+		if (stream.format != 0)
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, stream.format, data.width, data.height, 0, data.size, pixels);
+		else
+			glTexImage2D(GL_TEXTURE_2D, level, format, data.width, data.height, 0, format, GL_UNSIGNED_BYTE, pixels);
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(asset.target, 0);
+
+	if (layer == stream.reference) {
+		stream.allocatedLevel = level;
+		asset.bytes += stream.levelBytes[level];
+		residentTotal += stream.levelBytes[level];
+	}
+}
+
+bool TextureLoader::streamNext() {
+	// Texture with source levels still to upload and the highest priority
+	size_t best = assets.size();
+	for (size_t i = 0; i < assets.size(); i++) {
+		if (!assets[i].resident || assets[i].residentLevel == 0 || streams[i].loading || assets[i].layersReady == 0)
+			continue;
+		if (best == assets.size() || streams[i].priority > streams[best].priority)
+			best = i;
+	}
+
+	if (best == assets.size())
+		return false;
+
+	TextureAsset& asset = assets[best];
+	AssetStream& stream = streams[best];
+
+	// Stop at the current level if the next one does not fit, even after evicting textures used less recently
+	if (stream.nextLayer == 0 && !makeRoom(stream.levelBytes[asset.residentLevel - 1], best, true)) {
+		releaseSources(best);
+		return true;
+	}
+
+	chrono::steady_clock::time_point uploadStart = chrono::steady_clock::now();
+
+	// One layer of the next finer level; arrays switch to it once every layer has it
+	uploadLevel(best, stream.nextLayer, asset.residentLevel - 1);
+
+	if (++stream.nextLayer == static_cast<int>(stream.layers.size())) {
+		stream.nextLayer = 0;
+		asset.residentLevel--;
+		asset.version++;
+
+		glBindTexture(asset.target, asset.texture);
+		glTexParameteri(asset.target, GL_TEXTURE_BASE_LEVEL, asset.residentLevel);
+		glBindTexture(asset.target, 0);
+	}
+
+	asset.uploadMs += chrono::duration<double, milli>(chrono::steady_clock::now() - uploadStart).count();
+
+	if (asset.residentLevel == 0)
+		releaseSources(best);
+	return true;
+}
+
+bool TextureLoader::evictable(size_t index, size_t forAsset) const {
+	const AssetStream& stream = streams[index];
+	if (index == forAsset || !assets[index].resident || stream.allocatedLevel >= stream.tailLevel || stream.lastUsed == frame)
+		return false;
+
+	// Only textures used less recently, or as recently with a lower priority, give way
+	if (forAsset == assets.size())
+		return true;
+
+	const AssetStream& other = streams[forAsset];
+	return stream.lastUsed < other.lastUsed || (stream.lastUsed == other.lastUsed && stream.priority < other.priority);
+}
+
+bool TextureLoader::makeRoom(size_t bytes, size_t forAsset, bool evict) {
+	if (budgetBytes == 0 || residentTotal + bytes <= budgetBytes)
+		return true;
+
+	// Memory that evicting every level above the coarse ones of the textures that give way would free
+	size_t freeable = 0;
+	for (size_t i = 0; i < assets.size(); i++) {
+		if (!evictable(i, forAsset))
+			continue;
+		for (int level = streams[i].allocatedLevel; level < streams[i].tailLevel; level++)
+			freeable += streams[i].levelBytes[level];
+	}
+
+	bool fits = residentTotal - freeable + bytes <= budgetBytes;
+	if (!evict || (!fits && forAsset != assets.size()))
+		return fits;
+
+	// Drop one level at a time from the least recently used
+	while (residentTotal + bytes > budgetBytes) {
+		size_t victim = assets.size();
+		for (size_t i = 0; i < assets.size(); i++) {
+			if (!evictable(i, forAsset))
+				continue;
+			if (victim == assets.size() || streams[i].lastUsed < streams[victim].lastUsed
+				|| (streams[i].lastUsed == streams[victim].lastUsed && streams[i].priority < streams[victim].priority))
+				victim = i;
+		}
+
+		if (victim == assets.size())
+			return false;
+		evictLevel(victim);
+	}
+
+	return true;
+}
+
+void TextureLoader::evictLevel(size_t index) {
+	TextureAsset& asset = assets[index];
+	AssetStream& stream = streams[index];
+	int level = stream.allocatedLevel;
+
+	// Respecify the level as empty to release its storage; a partly streamed level goes first
+	glBindTexture(asset.target, asset.texture);
+	if (asset.target == GL_TEXTURE_2D_ARRAY)
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGB, 0, 0, 0, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+	else
+		glTexImage2D(GL_TEXTURE_2D, level, GL_RGB, 0, 0, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+
+	stream.allocatedLevel++;
+	stream.nextLayer = 0;
+	if (asset.residentLevel < stream.allocatedLevel) {
+		asset.residentLevel = stream.allocatedLevel;
+		asset.version++;
+		glTexParameteri(asset.target, GL_TEXTURE_BASE_LEVEL, asset.residentLevel);
+	}
+	glBindTexture(asset.target, 0);
+
+	asset.bytes -= stream.levelBytes[level];
+	residentTotal -= stream.levelBytes[level];
+	evictions++;
+
+	// Its sources are reloaded when it is used again
+	if (asset.layersReady > 0 && !stream.loading)
+		releaseSources(index);
+}
+
+void TextureLoader::releaseSources(size_t index) {
+	TextureAsset& asset = assets[index];
+	AssetStream& stream = streams[index];
+
+	// Free the decoded pixels and unmap the baked files
+	stream.layers.clear();
+	stream.nextLayer = 0;
+	asset.layersReady = 0;
+
+	if (stream.complete)
+		return;
+
+	stream.complete = true;
+	asset.fullMs = elapsedMs();
+	if (++completed == assets.size())
+		finishMs = asset.fullMs;
+}
+
+bool TextureLoader::finished() const {
+	return completed == assets.size();
+}
+
+void TextureLoader::deleteTextures() {
+	for (TextureAsset& asset : assets) {
+		glDeleteTextures(1, &asset.texture);
+		asset.texture = 0;
+		asset.resident = false;
+		asset.bytes = 0;
+	}
+	residentTotal = 0;
+}
+
+double TextureLoader::elapsedMs() const {
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+}
+
+void TextureLoader::printReport() const {
+	double totalDecodeMs = 0.0, totalUploadMs = 0.0, lastReadyMs = 0.0;
+
+	cout << fixed << setprecision(2);
+	cout << "Texture loading (" << (serial ? "serial" : to_string(workers.size()) + " decode threads") << ")" << endl;
+	cout << left << setw(36) << "  Asset" << right << setw(12) << "Size" << setw(8) << "Source" << setw(12) << "Decode ms"
+		<< setw(12) << "Upload ms" << setw(12) << "Ready ms" << setw(12) << "Full ms" << setw(8) << "Level" << setw(12) << "VRAM KB" << endl;
+
+	for (const TextureAsset& asset : assets) {
+		string size = to_string(asset.width) + "x" + to_string(asset.height);
+		cout << "  " << left << setw(34) << asset.name << right << setw(12) << size << setw(8) << (asset.baked ? "dds" : "jpg")
+			<< setw(12) << asset.decodeMs << setw(12) << asset.uploadMs << setw(12) << asset.readyMs << setw(12) << asset.fullMs
+			<< setw(8) << asset.residentLevel << setw(12) << asset.bytes / 1024 << endl;
+
+		totalDecodeMs += asset.decodeMs;
+		totalUploadMs += asset.uploadMs;
+		lastReadyMs = max(lastReadyMs, asset.readyMs);
+	}
+
+	cout << "  Total decode " << totalDecodeMs << " ms, total upload " << totalUploadMs << " ms, all showing after " << lastReadyMs
+		<< " ms, first load finished after " << finishMs << " ms" << endl;
+	cout << "  " << residentTotal / (1024.0 * 1024.0) << " MB VRAM resident";
+	if (budgetBytes > 0)
+		cout << " of a " << budgetBytes / (1024.0 * 1024.0) << " MB budget, " << evictions << " levels evicted";
+	cout << endl;
+	cout.unsetf(ios::floatfield);
+	cout << setprecision(6);
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "TextureBake.h"
+
+#include <GLEW/glew.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Mip levels this size and smaller are uploaded together as soon as a texture arrives; finer levels stream in afterwards
+const int TEXTURE_STREAM_TAIL_SIZE = 64;
+
+// Texture tracked by the loader; array textures have one file per layer
+struct TextureAsset {
+	std::string name;
+	std::vector<std::string> files;
+	GLenum target;     // GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY
+	int channels;      // SOIL_LOAD_RGB or SOIL_LOAD_RGBA
+	GLuint texture;    // Holds a 1x1 placeholder until every layer has arrived
+	int width, height;
+	int layersReady;   // Layers decoded or mapped
+	int levels;        // Mip levels in the full chain
+	int residentLevel; // Finest level uploaded for every layer; sampling starts there, and it rises when levels are evicted
+	double decodeMs;   // Time spent in SOIL_load_image and building the mip chain, summed over layers
+	double uploadMs;   // Time spent uploading
+	double readyMs;    // Time from loader start until the coarse levels were resident
+	double fullMs;     // Time from loader start until the first load finished, at full resolution unless the budget ran out
+	size_t bytes;      // Estimated video memory of the resident levels
+	bool baked;        // Loaded from precompressed .dds files instead of decoding the source images, decided for every layer and reload together
+	bool resident;     // Coarse levels uploaded; full resolution once residentLevel reaches 0
+	unsigned version;  // Bumped whenever the levels sampling can reach change
+};
+
+// Decodes images on a worker thread pool and hands them to the GL thread for upload
+// Keeps the resident levels of every texture within a memory budget, dropping the finest levels of the least recently used
+class TextureLoader {
+public:
+	explicit TextureLoader(unsigned workerCount = 0);
+	~TextureLoader();
+
+	// Register an image file and return its texture name (GL thread only)
+	GLuint add(const std::string& path, int channels);
+
+	// Register same-sized image files as the layers of a 2D array texture (GL thread only)
+	GLuint addArray(const std::vector<std::string>& paths, int channels);
+
+	// Load precompressed .dds files next to the source images when they are up to date
+	void setUseBakedTextures(bool useBaked);
+
+	// Begin decoding every registered image on the worker threads
+	void start();
+
+	// Decode and upload every registered image on the calling thread
+	void loadAllSerial();
+
+	// Upload newly decoded images, then finer levels of resident textures, until the time budget is spent (GL thread only)
+	int uploadReady(double budgetMs);
+
+	// Count the frame; textures given a priority above zero after this are the ones used this frame (GL thread only)
+	void beginFrame();
+
+	// Textures with a higher priority, such as a larger projected size on screen, get their finer levels first
+	void setPriority(GLuint texture, float priority);
+
+	// Changes whenever the texture's resident levels do, so copies made from it can tell they are stale
+	unsigned version(GLuint texture) const;
+
+	// Bytes of texture memory to keep resident, 0 for no limit (GL thread only)
+	// Levels dropped to stay within it are reloaded when their texture is used again and there is room
+	void setBudget(size_t bytes);
+
+	size_t budget() const { return budgetBytes; }
+	size_t residentBytes() const { return residentTotal; }
+
+	// True once the first load of every registered image has finished or failed
+	bool finished() const;
+
+	// Delete every texture (GL thread only)
+	void deleteTextures();
+
+	// Print per-asset decode/upload timings, resident levels and memory, and totals
+	void printReport() const;
+
+private:
+	struct LayerJob {
+		size_t asset;
+		int layer;
+	};
+
+	// Mip chain of one layer, finest level first; baked levels point into the mapped file, decoded levels are in pixels
+	struct LayerLevels {
+		GLenum format; // Compressed format of baked levels, 0 for decoded pixels
+		std::vector<BakedLevel> levels;
+		std::shared_ptr<MappedFile> file;
+		std::vector<std::vector<unsigned char> > pixels;
+	};
+
+	// Layer ready for upload; no levels if it failed to load
+	struct DecodedImage {
+		LayerJob job;
+		LayerLevels layer;
+		double decodeMs;
+	};
+
+	// Source levels of an asset and what is allocated from them
+	struct AssetStream {
+		std::vector<LayerLevels> layers; // Held only while levels are being uploaded
+		GLenum format;
+		int reference;      // First layer that loaded, which allocates each level of an array
+		int nextLayer;      // Next layer to receive level residentLevel - 1
+		int allocatedLevel; // Finest level with storage, at most residentLevel
+		int tailLevel;      // Finest of the levels uploaded on arrival, which are never evicted
+		std::vector<size_t> levelBytes; // Estimated memory of each level over every layer
+		float priority;
+		unsigned long long lastUsed; // Frame the texture was last given a priority above zero
+		bool loading;  // Layers requested and not all arrived
+		bool complete; // First load finished
+	};
+
+	GLuint addAsset(const std::string& name, const std::vector<std::string>& files, GLenum target, int channels);
+	void queueJobs();
+	void requestLoad(size_t asset);
+	void workerMain();
+	DecodedImage decode(const LayerJob& job) const;
+	bool mapBaked(const LayerJob& job, DecodedImage& image);
+	void restartDecoded(size_t asset);
+	void arrived(DecodedImage& image);
+	void makeResident(size_t asset);
+	void uploadLevel(size_t asset, int layer, int level);
+	bool streamNext();
+	bool makeRoom(size_t bytes, size_t forAsset, bool evict);
+	bool evictable(size_t asset, size_t forAsset) const;
+	void evictLevel(size_t asset);
+	void releaseSources(size_t asset);
+	double elapsedMs() const;
+
+	std::vector<TextureAsset> assets;
+	std::vector<AssetStream> streams;
+	std::deque<LayerJob> bakedJobs;
+	std::vector<std::thread> workers;
+	unsigned workerCount;
+	bool serial;
+	bool useBaked;
+
+	// Decode jobs, largest file first for the initial load; workers wait here for reloads
+	std::mutex jobMutex;
+	std::condition_variable jobQueued;
+	std::deque<LayerJob> jobs;
+	bool stopping;
+
+	mutable std::mutex readyMutex;
+	std::deque<DecodedImage> ready;
+	size_t completed;
+
+	size_t budgetBytes;
+	size_t residentTotal;
+	unsigned long long frame;
+	unsigned evictions;
+
+	std::chrono::steady_clock::time_point startTime;
+	double finishMs;
+};
@@ -0,0 +1,131 @@
+#include "VertexFormat.h"
+
+#include <glm/glm/gtc/matrix_transform.hpp>
+#include <glm/glm/gtc/packing.hpp>
+
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+	// Bytes an attribute takes in the vertex, rounded up to keep the next one four-byte aligned
+	GLuint attributeBytes(GLenum type, GLint size) {
+		GLuint component = type == GL_FLOAT ? 4 : 2;
+		return type == GL_INT_2_10_10_10_REV ? 4 : (component * size + 3) / 4 * 4;
+	}
+
+	void addAttribute(VertexFormat& format, GLuint location, GLint size, GLenum type) {
+		// snorm16 positions and 10-bit normals are normalized; texture coordinates stay whole steps the decode scales
+		VertexAttribute attribute;
+		attribute.location = location;
+		attribute.size = type == GL_INT_2_10_10_10_REV ? 4 : size;
+		attribute.type = type;
+		attribute.normalized = type == GL_SHORT || type == GL_INT_2_10_10_10_REV ? GL_TRUE : GL_FALSE;
+		attribute.offset = format.stride;
+
+		format.attributes.push_back(attribute);
+		format.stride += attributeBytes(type, size);
+	}
+
+	void write(vector<unsigned char>& packed, size_t offset, const void* value, size_t size) {
+		memcpy(packed.data() + offset, value, size);
+	}
+
+	// Store v at offset as the attribute's type; snorm16 takes v already scaled to [-1, 1], unsigned shorts to [0, 65535]
+	void writeAttribute(vector<unsigned char>& packed, size_t offset, GLenum type, const float* v, int size) {
+		for (int i = 0; i < size; i++) {
+			if (type == GL_FLOAT) {
+				write(packed, offset + i * 4, &v[i], 4);
+			}
+			else {
+				GLushort value = type == GL_HALF_FLOAT ? glm::packHalf1x16(v[i]) : type == GL_SHORT ? glm::packSnorm1x16(v[i]) : (GLushort)(v[i] + 0.5f);
+				write(packed, offset + i * 2, &value, 2);
+			}
+		}
+	}
+}
+
+VertexFormat vertexFormat(const VertexLayout& layout) {
+	VertexFormat format;
+	format.stride = 0;
+
+	addAttribute(format, POSITION_LOCATION, 3, layout.position);
+	addAttribute(format, TEX_COORD_LOCATION, 2, layout.texCoord);
+	addAttribute(format, NORMAL_LOCATION, 3, layout.normal);
+
+	return format;
+}
+
+VertexDecode packVertices(const vector<MeshVertex>& vertices, const VertexLayout& layout, vector<unsigned char>& packed) {
+	VertexFormat format = vertexFormat(layout);
+	packed.assign(vertices.size() * format.stride, 0);
+
+	VertexDecode decode;
+	decode.position = glm::mat4(1.0f);
+	decode.texCoord = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+
+	// Quantize over the range actually used so every bit carries precision
+	glm::vec3 positionMin(0.0f), positionMax(0.0f);
+	glm::vec2 texCoordMin(0.0f), texCoordMax(0.0f);
+	if (!vertices.empty()) {
+		positionMin = positionMax = vertices[0].position;
+		texCoordMin = texCoordMax = vertices[0].texCoord;
+	}
+	for (size_t i = 1; i < vertices.size(); i++) {
+		positionMin = glm::min(positionMin, vertices[i].position);
+		positionMax = glm::max(positionMax, vertices[i].position);
+		texCoordMin = glm::min(texCoordMin, vertices[i].texCoord);
+		texCoordMax = glm::max(texCoordMax, vertices[i].texCoord);
+	}
+
+	glm::vec3 center = (positionMin + positionMax) * 0.5f;
+	glm::vec3 extent = glm::max((positionMax - positionMin) * 0.5f, glm::vec3(1e-6f));
+
+	// Texture coordinates count steps of a power-of-two fraction up from a whole number, so whole and
+	// half coordinates (tiling seams, atlas edges) decode exactly rather than drifting off by a step
+	glm::vec2 texCoordBase, texCoordSteps;
+	for (int i = 0; i < 2; i++) {
+		texCoordBase[i] = floor(texCoordMin[i]);
+		float range = texCoordMax[i] - texCoordBase[i];
+		texCoordSteps[i] = ldexp(1.0f, (int)floor(log2(65535.0f / (range > 1e-6f ? range : 1e-6f))));
+	}
+
+	if (layout.position == GL_SHORT)
+		decode.position = glm::scale(glm::translate(glm::mat4(1.0f), center), extent);
+	if (layout.texCoord == GL_UNSIGNED_SHORT)
+		decode.texCoord = glm::vec4(1.0f / texCoordSteps.x, 1.0f / texCoordSteps.y, texCoordBase);
+
+	const VertexAttribute& position = format.attributes[0];
+	const VertexAttribute& texCoord = format.attributes[1];
+	const VertexAttribute& normal = format.attributes[2];
+
+	for (size_t i = 0; i < vertices.size(); i++) {
+		const MeshVertex& vertex = vertices[i];
+		size_t base = i * format.stride;
+
+		glm::vec3 p = layout.position == GL_SHORT ? (vertex.position - center) / extent : vertex.position;
+		writeAttribute(packed, base + position.offset, layout.position, &p.x, 3);
+
+		glm::vec2 t = layout.texCoord == GL_UNSIGNED_SHORT ? (vertex.texCoord - texCoordBase) * texCoordSteps : vertex.texCoord;
+		writeAttribute(packed, base + texCoord.offset, layout.texCoord, &t.x, 2);
+
+		if (layout.normal == GL_INT_2_10_10_10_REV) {
+			GLuint value = glm::packSnorm3x10_1x2(glm::vec4(vertex.normal, 0.0f));
+			write(packed, base + normal.offset, &value, 4);
+		}
+		else {
+			writeAttribute(packed, base + normal.offset, layout.normal, &vertex.normal.x, 3);
+		}
+	}
+
+	return decode;
+}
+
+void setVertexAttributes(const VertexFormat& format) {
+	for (size_t i = 0; i < format.attributes.size(); i++) {
+		const VertexAttribute& attribute = format.attributes[i];
+		glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized, format.stride, (GLvoid*)(size_t)attribute.offset);
+		glEnableVertexAttribArray(attribute.location);
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <GLEW/glew.h>
+
+#include <glm/glm/glm.hpp>
+
+#include <vector>
+
+// Full-precision vertex the mesh builders emit; packed into a VertexLayout when uploaded
+struct MeshVertex {
+	glm::vec3 position;
+	glm::vec2 texCoord;
+	glm::vec3 normal;
+};
+
+// Attribute locations shared by every mesh shader
+const GLuint POSITION_LOCATION = 0;
+const GLuint TEX_COORD_LOCATION = 1;
+const GLuint NORMAL_LOCATION = 2;
+
+// Storage type of each attribute in the vertex buffer
+struct VertexLayout {
+	GLenum position; // GL_FLOAT, GL_HALF_FLOAT, or GL_SHORT as snorm16 over the mesh bounds
+	GLenum texCoord; // GL_FLOAT, GL_HALF_FLOAT, or GL_UNSIGNED_SHORT as power-of-two fractions above a whole number
+	GLenum normal;   // GL_FLOAT or GL_INT_2_10_10_10_REV
+};
+
+// 32 bytes per vertex as floats, 16 packed
+const VertexLayout FLOAT_VERTEX_LAYOUT = { GL_FLOAT, GL_FLOAT, GL_FLOAT };
+const VertexLayout PACKED_VERTEX_LAYOUT = { GL_SHORT, GL_UNSIGNED_SHORT, GL_INT_2_10_10_10_REV };
+
+// One attribute as passed to glVertexAttribPointer
+struct VertexAttribute {
+	GLuint location;
+	GLint size;
+	GLenum type;
+	GLboolean normalized;
+	GLuint offset;
+};
+
+// Byte layout of a vertex in a given VertexLayout
+struct VertexFormat {
+	std::vector<VertexAttribute> attributes;
+	GLsizei stride;
+};
+
+// Maps quantized attributes back to the mesh's own units
+struct VertexDecode {
+	glm::mat4 position; // Applied before the model matrix
+	glm::vec4 texCoord; // Scale in xy and offset in zw, applied in the vertex shader
+};
+
+VertexFormat vertexFormat(const VertexLayout& layout);
+
+// Encode the vertices for upload; the returned decode undoes the quantization
+VertexDecode packVertices(const std::vector<MeshVertex>& vertices, const VertexLayout& layout, std::vector<unsigned char>& packed);
+
+// Point the bound VAO's attributes at the bound GL_ARRAY_BUFFER
+void setVertexAttributes(const VertexFormat& format);
@@ -0,0 +1,66 @@
+#include "../Final Project/TextureBake.h"
+
+#include <SOIL2/SOIL2.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+// Bake each image on the command line into a BC1/BC3 .dds with a full mip chain next to the source
+int main(int argc, char* argv[]) {
+	bool force = false;
+	int baked = 0, skipped = 0, failed = 0;
+
+	if (argc < 2) {
+		cout << "Usage: \"Texture Baker\" [--force] image.jpg..." << endl;
+		return EXIT_FAILURE;
+	}
+
+	for (int i = 1; i < argc; i++) {
+		string source = argv[i];
+		if (source == "--force") {
+			force = true;
+			continue;
+		}
+
+		// Skip files whose .dds is newer than the source image
+		string destination = bakedTexturePath(source);
+		if (!force && bakedTextureIsCurrent(source, destination)) {
+			skipped++;
+			continue;
+		}
+
+		chrono::steady_clock::time_point bakeStart = chrono::steady_clock::now();
+
+		int width, height, channels;
+		unsigned char* pixels = SOIL_load_image(source.c_str(), &width, &height, &channels, SOIL_LOAD_RGBA);
+		if (pixels == nullptr) {
+			cout << "Failed to load " << source << endl;
+			failed++;
+			continue;
+		}
+
+		// Only sources with an alpha channel need BC3
+		bool hasAlpha = channels == 2 || channels == 4;
+		size_t bytes = bakeTexture(pixels, width, height, hasAlpha, destination);
+		SOIL_free_image_data(pixels);
+
+		if (bytes == 0) {
+			cout << "Failed to write " << destination << endl;
+			failed++;
+			continue;
+		}
+
+		double bakeMs = chrono::duration<double, milli>(chrono::steady_clock::now() - bakeStart).count();
+		double uncompressed = width * height * 4.0 * 4.0 / 3.0;
+		cout << destination << ": " << width << "x" << height << (hasAlpha ? " BC3 " : " BC1 ") << bytes / 1024 << " KB ("
+			<< uncompressed / bytes << "x smaller than RGBA8 with mipmaps) in " << bakeMs << " ms" << endl;
+		baked++;
+	}
+
+	cout << baked << " baked, " << skipped << " up to date, " << failed << " failed" << endl;
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}